@@ -63,6 +63,9 @@ public:
 void AngularCorrelationSelector::InitializeBranches(TTree* tree)
 {
    if(tree == nullptr) return;
+   // only read the detectors we use, all other branches are disabled
+   UseBranch("TGriffin");
+   UseBranch("TSceptar");
    tree->SetBranchAddress("TGriffin", &fGrif);
    if(tree->SetBranchAddress("TSceptar", &fScep) == TTree::kMissingBranch) {
 		fScep = new TSceptar;
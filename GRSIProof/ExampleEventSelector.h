@@ -47,6 +47,9 @@ class ExampleEventSelector : public TGRSISelector { //Must be same name as .C an
 void ExampleEventSelector::InitializeBranches(TTree* tree)
 {
    if(!tree) return;
+   // only read the detectors we use, all other branches are disabled
+   UseBranch("TGriffin");
+   UseBranch("TSceptar");
    if(tree->SetBranchAddress("TGriffin", &fGrif) == TTree::kMissingBranch) {
 		fGrif = new TGriffin;
 	}
@@ -9,6 +9,8 @@
 #include "TProfile.h"
 #include "TF1.h"
 
+#include <vector>
+
 class GCube : public TH1 {
 public:
    GCube();
@@ -30,6 +32,10 @@ public:
    virtual Int_t Fill(Double_t x, Double_t y, Double_t z);
    virtual Int_t Fill(Double_t x, Double_t y, Double_t z, Double_t w);
    virtual Int_t Fill(const char* namex, const char* namey, const char* namez, Double_t w);
+   void FillN(Int_t, const Double_t*, const Double_t*, Int_t) override { ; }                   // MayNotUse
+   void FillN(Int_t, const Double_t*, const Double_t*, const Double_t*, Int_t) override { ; } // MayNotUse
+   virtual void FillN(Int_t ntimes, const Double_t* x, const Double_t* y, const Double_t* z, const Double_t* w,
+                      Int_t stride = 1);
    void FillRandom(const char* fname, Int_t ntimes = 5000) override;
    void FillRandom(TH1* h, Int_t ntimes = 5000) override;
    Int_t FindFirstBinAbove(Double_t threshold = 0, Int_t axis = 1) const override;
@@ -80,6 +86,9 @@ protected:
    TH2*     fMatrix{0};  //!<! Transient pointer to the 2D-Matrix used in Draw() or GetMatrix()
 
 private:
+   bool ProjectLines(Int_t firstBiny, Int_t lastBiny, Int_t firstBinz, Int_t lastBinz, bool computeErrors,
+                     std::vector<Double_t>& content, std::vector<Double_t>& error2) const;
+
    GCube(const GCube&);
    GCube& operator=(const GCube&);
 
@@ -3,11 +3,14 @@
 
 #include "TH1.h"
 #include "TH2.h"
+#include "TArrayI.h"
 #include "TArrayF.h"
 #include "TArrayD.h"
 #include "TProfile.h"
 #include "TF1.h"
 
+#include <vector>
+
 class GHSym : public TH1 {
 public:
    GHSym();
@@ -80,12 +83,61 @@ protected:
    TH2*     fMatrix{nullptr};  //!<! Transient pointer to the 2D-Matrix used in Draw() or GetMatrix()
 
 private:
+   bool ProjectLines(Int_t firstBin, Int_t lastBin, bool computeErrors, std::vector<Double_t>& content,
+                     std::vector<Double_t>& error2) const;
+
    GHSym(const GHSym&);
    GHSym& operator=(const GHSym&);
 
    ClassDefOverride(GHSym, 1);
 };
 
+/// integer bins, for large symmetric matrices where memory matters (e.g. on PROOF workers)
+class GHSymI : public GHSym, public TArrayI {
+public:
+   GHSymI();
+   GHSymI(const char* name, const char* title, Int_t nbins, Double_t low, Double_t up);
+   GHSymI(const char* name, const char* title, Int_t nbins, const Double_t* bins);
+   GHSymI(const char* name, const char* title, Int_t nbins, const Float_t* bins);
+   GHSymI(const GHSymI&);
+   ~GHSymI() override;
+
+   TH2I* GetMatrix(bool force = false);
+
+   void AddBinContent(Int_t bin) override
+   {
+      if(fArray[bin] < 2147483647) {
+         ++fArray[bin];
+      }
+   }
+   void AddBinContent(Int_t bin, Double_t w) override;
+   void Copy(TObject& rh) const override;
+   void Draw(Option_t* option = "") override { GetMatrix()->Draw(option); }
+   TH1* DrawCopy(Option_t* option = "", const char* name_postfix = "_copy") const override;
+   Double_t GetBinContent(Int_t bin) const override;
+   Double_t GetBinContent(Int_t binx, Int_t biny) const override { return GetBinContent(GetBin(binx, biny)); }
+   Double_t GetBinContent(Int_t binx, Int_t biny, Int_t) const override { return GetBinContent(GetBin(binx, biny)); }
+   void Reset(Option_t* option = "") override;
+   Double_t RetrieveBinContent(Int_t bin) const override { return Double_t(fArray[bin]); }
+   void SetBinContent(Int_t bin, Double_t content) override;
+   void SetBinContent(Int_t binx, Int_t biny, Double_t content) override { SetBinContent(GetBin(binx, biny), content); }
+   void SetBinContent(Int_t binx, Int_t biny, Int_t, Double_t content) override
+   {
+      SetBinContent(GetBin(binx, biny), content);
+   }
+   void SetBinsLength(Int_t n = -1) override;
+   void UpdateBinContent(Int_t bin, Double_t content) override { fArray[bin] = static_cast<Int_t>(content); }
+   GHSymI& operator=(const GHSymI& h1);
+   friend GHSymI operator*(Float_t c1, GHSymI& h1);
+   friend GHSymI operator*(GHSymI& h1, Float_t c1) { return operator*(c1, h1); }
+   friend GHSymI operator+(GHSymI& h1, GHSymI& h2);
+   friend GHSymI operator-(GHSymI& h1, GHSymI& h2);
+   friend GHSymI operator*(GHSymI& h1, GHSymI& h2);
+   friend GHSymI operator/(GHSymI& h1, GHSymI& h2);
+
+   ClassDefOverride(GHSymI, 1);
+};
+
 class GHSymF : public GHSym, public TArrayF {
 public:
    GHSymF();
@@ -0,0 +1,185 @@
+#ifndef _RINGBUFFER_H_
+#define _RINGBUFFER_H_
+
+////////////////////////////////////////////////////////////////////////////////
+///
+/// \class SPSCRingBuffer
+/// \class MPMCRingBuffer
+///
+/// Bounded lock-free ring buffers used as backends of ThreadsafeQueue.
+/// The capacity is rounded up to the next power of two and all slots are
+/// allocated when the buffer is created.
+///
+/// SPSCRingBuffer may only be used by exactly one producer and one consumer
+/// thread (e.g. TDataLoop->TUnpackingLoop), MPMCRingBuffer (D. Vyukov's bounded
+/// queue) allows any number of producers and consumers.
+///
+/// TryPush/TryPop never block, they return false if the buffer is full/empty.
+///
+////////////////////////////////////////////////////////////////////////////////
+
+#ifndef __CINT__
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+#include <vector>
+#endif
+
+#ifndef __CINT__
+namespace RingBuffer {
+/// cache line size used to pad the producer and consumer indices apart (avoids false sharing)
+static const size_t kCacheLineSize = 64;
+
+inline size_t RoundUpToPowerOfTwo(size_t size)
+{
+   size_t result = 2;
+   while(result < size) {
+      result <<= 1;
+   }
+   return result;
+}
+} // namespace RingBuffer
+
+template <typename T>
+class SPSCRingBuffer {
+public:
+   explicit SPSCRingBuffer(size_t capacity)
+      : fCapacity(RingBuffer::RoundUpToPowerOfTwo(capacity)), fMask(fCapacity - 1), fSlots(fCapacity)
+   {
+   }
+   SPSCRingBuffer(const SPSCRingBuffer&) = delete;
+   SPSCRingBuffer& operator=(const SPSCRingBuffer&) = delete;
+
+   bool TryPush(T& obj)
+   {
+      /// only ever called from the producer thread, moves obj into the buffer on success
+      size_t head = fHead.load(std::memory_order_relaxed);
+      if(head - fCachedTail >= fCapacity) {
+         fCachedTail = fTail.load(std::memory_order_acquire);
+         if(head - fCachedTail >= fCapacity) {
+            return false;
+         }
+      }
+      fSlots[head & fMask] = std::move(obj);
+      fHead.store(head + 1, std::memory_order_release);
+      return true;
+   }
+
+   bool TryPop(T& output)
+   {
+      /// only ever called from the consumer thread
+      size_t tail = fTail.load(std::memory_order_relaxed);
+      if(tail == fCachedHead) {
+         fCachedHead = fHead.load(std::memory_order_acquire);
+         if(tail == fCachedHead) {
+            return false;
+         }
+      }
+      // move out of the slot, this also releases whatever the slot was holding (e.g. a shared_ptr)
+      output = std::move(fSlots[tail & fMask]);
+      fSlots[tail & fMask] = T();
+      fTail.store(tail + 1, std::memory_order_release);
+      return true;
+   }
+
+   size_t Capacity() const { return fCapacity; }
+
+private:
+   const size_t   fCapacity;
+   const size_t   fMask;
+   std::vector<T> fSlots;
+
+   char               fPad0[RingBuffer::kCacheLineSize];
+   std::atomic_size_t fHead{0};       ///< written by producer only
+   size_t             fCachedTail{0}; ///< producer's copy of fTail
+   char               fPad1[RingBuffer::kCacheLineSize];
+   std::atomic_size_t fTail{0};       ///< written by consumer only
+   size_t             fCachedHead{0}; ///< consumer's copy of fHead
+   char               fPad2[RingBuffer::kCacheLineSize];
+};
+
+template <typename T>
+class MPMCRingBuffer {
+public:
+   explicit MPMCRingBuffer(size_t capacity)
+      : fCapacity(RingBuffer::RoundUpToPowerOfTwo(capacity)), fMask(fCapacity - 1), fSlots(fCapacity)
+   {
+      for(size_t i = 0; i < fCapacity; ++i) {
+         fSlots[i].fSequence.store(i, std::memory_order_relaxed);
+      }
+   }
+   MPMCRingBuffer(const MPMCRingBuffer&) = delete;
+   MPMCRingBuffer& operator=(const MPMCRingBuffer&) = delete;
+
+   bool TryPush(T& obj)
+   {
+      /// moves obj into the buffer on success
+      Slot*  slot;
+      size_t pos = fEnqueuePos.load(std::memory_order_relaxed);
+      while(true) {
+         slot              = &fSlots[pos & fMask];
+         size_t   sequence = slot->fSequence.load(std::memory_order_acquire);
+         intptr_t diff     = static_cast<intptr_t>(sequence) - static_cast<intptr_t>(pos);
+         if(diff == 0) {
+            if(fEnqueuePos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+               break;
+            }
+         } else if(diff < 0) {
+            // full
+            return false;
+         } else {
+            pos = fEnqueuePos.load(std::memory_order_relaxed);
+         }
+      }
+      slot->fData = std::move(obj);
+      slot->fSequence.store(pos + 1, std::memory_order_release);
+      return true;
+   }
+
+   bool TryPop(T& output)
+   {
+      Slot*  slot;
+      size_t pos = fDequeuePos.load(std::memory_order_relaxed);
+      while(true) {
+         slot              = &fSlots[pos & fMask];
+         size_t   sequence = slot->fSequence.load(std::memory_order_acquire);
+         intptr_t diff     = static_cast<intptr_t>(sequence) - static_cast<intptr_t>(pos + 1);
+         if(diff == 0) {
+            if(fDequeuePos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+               break;
+            }
+         } else if(diff < 0) {
+            // empty
+            return false;
+         } else {
+            pos = fDequeuePos.load(std::memory_order_relaxed);
+         }
+      }
+      output      = std::move(slot->fData);
+      slot->fData = T();
+      slot->fSequence.store(pos + fMask + 1, std::memory_order_release);
+      return true;
+   }
+
+   size_t Capacity() const { return fCapacity; }
+
+private:
+   struct Slot {
+      std::atomic_size_t fSequence{0};
+      T                  fData;
+   };
+
+   const size_t      fCapacity;
+   const size_t      fMask;
+   std::vector<Slot> fSlots;
+
+   char               fPad0[RingBuffer::kCacheLineSize];
+   std::atomic_size_t fEnqueuePos{0};
+   char               fPad1[RingBuffer::kCacheLineSize];
+   std::atomic_size_t fDequeuePos{0};
+   char               fPad2[RingBuffer::kCacheLineSize];
+};
+#endif /* __CINT__ */
+
+#endif /* _RINGBUFFER_H_ */
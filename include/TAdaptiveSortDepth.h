@@ -0,0 +1,175 @@
+#ifndef TADAPTIVESORTDEPTH_H
+#define TADAPTIVESORTDEPTH_H
+
+/** \addtogroup Loops
+ *  @{
+ */
+
+////////////////////////////////////////////////////////////////////////////////
+///
+/// \class TAdaptiveSortDepth
+///
+/// Chooses the sort depth of the event building loop from the disorder of
+/// the keys (timestamps or trigger ids) of the fragments read.
+///
+/// The lateness of a fragment is the number of fragments read since the
+/// first fragment with a larger key was read, which is the sort depth that
+/// would have been needed to sort it correctly. The running maximum of the
+/// keys is monotonic, so it is kept (every kStride fragments) in a ring
+/// buffer and the lateness is found with a binary search.
+///
+/// Lateness is histogrammed in powers of two and the histogram is halved
+/// every kUpdatePeriod fragments, so old disorder is slowly forgotten. At
+/// the same time the depth is set to twice the smallest power of two that
+/// leaves at most the requested fraction of fragments late (it is lowered
+/// by at most a factor two at a time). A fragment later than the current
+/// depth increases the depth immediately.
+///
+////////////////////////////////////////////////////////////////////////////////
+
+#ifndef __CINT__
+#include <algorithm>
+#include <cstddef>
+#include <vector>
+#endif
+
+#ifndef __CINT__
+class TAdaptiveSortDepth {
+public:
+   TAdaptiveSortDepth(size_t initialDepth, size_t maxDepth, double outOfOrderRate)
+      : fMaxDepth(std::max<size_t>(maxDepth, kMinDepth)), fOutOfOrderRate(outOfOrderRate),
+        fRunningMax((fMaxDepth + kStride - 1) / kStride + 1), fNofSamples(0), fNofKeys(0), fMaxKey(0), fEntries(0.),
+        fHistogram(kNofBins, 0.), fSinceUpdate(0)
+   {
+      fDepth        = Clamp(initialDepth);
+      fLargestDepth = fDepth;
+   }
+
+   /// records the key of the next fragment read, returns true if the depth was changed
+   bool Add(long key)
+   {
+      size_t lateness = 0;
+      if(fNofKeys == 0 || key > fMaxKey) {
+         fMaxKey = key;
+      } else if(key < fMaxKey) {
+         lateness = Lateness(key);
+      }
+      if(fNofKeys % kStride == 0) {
+         fRunningMax[fNofSamples % fRunningMax.size()] = fMaxKey;
+         ++fNofSamples;
+      }
+      ++fNofKeys;
+
+      fEntries += 1.;
+      if(lateness > 0) {
+         fHistogram[Bin(lateness)] += 1.;
+      }
+
+      bool changed = false;
+      if(lateness >= fDepth && fDepth < fMaxDepth) {
+         SetDepth(2 * (static_cast<size_t>(1) << Bin(lateness)));
+         changed = true;
+      }
+      if(++fSinceUpdate >= kUpdatePeriod) {
+         changed = Update() || changed;
+      }
+      return changed;
+   }
+
+   size_t Depth() const { return fDepth; }
+   size_t LargestDepth() const { return fLargestDepth; } ///< the largest depth chosen so far
+   size_t MaxDepth() const { return fMaxDepth; }
+
+   enum : size_t {
+      kMinDepth     = 1024,
+      kStride       = 16,      ///< the running maximum is sampled every kStride keys
+      kNofBins      = 64,
+      kUpdatePeriod = 1 << 16  ///< number of keys between updates of the depth
+   };
+
+private:
+   size_t Lateness(long key) const
+   {
+      /// Returns the number of keys added since the running maximum first exceeded key (key has to be smaller than
+      /// the running maximum). Samples that were overwritten in the ring buffer count as late as the oldest sample.
+      size_t oldest = fNofSamples > fRunningMax.size() ? fNofSamples - fRunningMax.size() : 0;
+      // binary search for the first sample larger than key, samples are non-decreasing
+      size_t low  = oldest;
+      size_t high = fNofSamples;
+      while(low < high) {
+         size_t mid = low + (high - low) / 2;
+         if(fRunningMax[mid % fRunningMax.size()] > key) {
+            high = mid;
+         } else {
+            low = mid + 1;
+         }
+      }
+      if(low == fNofSamples) {
+         // the maximum exceeded key after the last sample
+         return fNofKeys - (fNofSamples - 1) * kStride;
+      }
+      return fNofKeys - low * kStride;
+   }
+
+   bool Update()
+   {
+      /// Sets the depth from the histogram of the lateness and halves the histogram.
+      fSinceUpdate = 0;
+      double allowed = fOutOfOrderRate * fEntries;
+      double late    = 0.;
+      size_t bin     = kNofBins;
+      while(bin > 0 && late + fHistogram[bin - 1] <= allowed) {
+         late += fHistogram[--bin];
+      }
+      // the lateness in the bins below bin is smaller than 1 << (bin - 1), twice that is kept as margin
+      size_t needed   = static_cast<size_t>(1) << bin;
+      size_t oldDepth = fDepth;
+      if(needed > fDepth) {
+         SetDepth(needed);
+      } else if(needed < fDepth) {
+         SetDepth(std::max(needed, fDepth / 2));
+      }
+
+      fEntries /= 2.;
+      for(auto& count : fHistogram) {
+         count /= 2.;
+      }
+      return fDepth != oldDepth;
+   }
+
+   void SetDepth(size_t depth)
+   {
+      fDepth = Clamp(depth);
+      if(fDepth > fLargestDepth) {
+         fLargestDepth = fDepth;
+      }
+   }
+
+   size_t Clamp(size_t depth) const { return std::min<size_t>(std::max<size_t>(depth, kMinDepth), fMaxDepth); }
+
+   static size_t Bin(size_t lateness)
+   {
+      /// bin b holds lateness in [2^(b-1), 2^b)
+      size_t bin = 0;
+      while(lateness > 0 && bin < kNofBins - 1) {
+         lateness >>= 1;
+         ++bin;
+      }
+      return bin;
+   }
+
+   size_t              fMaxDepth;
+   double              fOutOfOrderRate; ///< fraction of fragments that may be later than the depth
+   std::vector<long>   fRunningMax;     ///< ring buffer of the running maximum of the keys, sampled every kStride keys
+   size_t              fNofSamples;     ///< number of samples written to fRunningMax
+   size_t              fNofKeys;        ///< number of keys added
+   long                fMaxKey;
+   double              fEntries;        ///< (decayed) number of keys in the histogram
+   std::vector<double> fHistogram;      ///< (decayed) histogram of the lateness in powers of two
+   size_t              fSinceUpdate;    ///< number of keys added since the last update of the depth
+   size_t              fDepth;
+   size_t              fLargestDepth;
+};
+#endif
+/*! @} */
+#endif
@@ -52,6 +52,8 @@ public:
    }
 
    bool StaticWindow() const { return fStaticWindow; }
+   bool DeterministicDither() const { return fDeterministicDither; }
+   bool CompactMatrices() const { return fCompactMatrices; }
 
 private:
    // sorting options
@@ -61,9 +63,11 @@ private:
    bool fIsCorrectingCrossTalk; ///< True if we are correcting for cross-talk in GRIFFIN at analysis-level
    bool fWaveformFitting;       ///< If true, waveform fitting with SFU algorithm will be performed
    bool fStaticWindow;          ///< Flag to use static window (default moving)
+   bool fDeterministicDither;   ///< Flag to derive dithers from address and timestamp instead of random numbers
+   bool fCompactMatrices;       ///< Flag to create large selector matrices with integer bins (TH2I/GHSymI)
 
    /// \cond CLASSIMP
-   ClassDefOverride(TAnalysisOptions, 2); ///< Class for storing options in GRSISort
+   ClassDefOverride(TAnalysisOptions, 4); ///< Class for storing options in GRSISort
                                           /// \endcond
 };
 /*! @} */
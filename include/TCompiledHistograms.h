@@ -2,10 +2,13 @@
 #define _TCOMPILEDHISTOGRAMS_H_
 
 #ifndef __CINT__
+#include <atomic>
 #include <mutex>
 #include <memory>
+#include <thread>
 #endif
 #include <string>
+#include <vector>
 
 #include "TObject.h"
 #include "TList.h"
@@ -15,12 +18,27 @@
 
 #include "TFragment.h"
 #include "TUnpackedEvent.h"
+#include "ThreadsafeQueue.h"
 
 class TFile;
 
+////////////////////////////////////////////////////////////////////////////////
+///
+/// \class TCompiledHistograms
+///
+/// Runs the histogram function of a user library for each fragment or event.
+///
+/// With more than one thread (see SetNumberOfThreads), Fill only queues the
+/// fragment/event, and each thread runs the user function on its own copy
+/// (shard) of the histograms. The shards are added up into GetObjects() by
+/// MergeShards, which is called when writing the histograms.
+///
+////////////////////////////////////////////////////////////////////////////////
+
 class TCompiledHistograms : public TObject {
 public:
    TCompiledHistograms();
+   ~TCompiledHistograms() override;
    TCompiledHistograms(std::string input_lib, std::string func_name);
 
    void Load(std::string libname, std::string func_name);
@@ -37,6 +55,11 @@ public:
 
    void ClearHistograms();
 
+   void SetNumberOfThreads(int nofThreads) { fNumberOfThreads = nofThreads; }
+   int  GetNumberOfThreads() const { return fNumberOfThreads; }
+   void MergeShards();
+   void StopWorkers();
+
    TList* GetObjects() { return &fObjects; }
    TList* GetGates() { return &fGates; }
 
@@ -45,6 +68,27 @@ public:
    Int_t Write(const char* name = nullptr, Int_t option = 0, Int_t bufsize = 0) override;
 
 private:
+#ifndef __CINT__
+   /// a fragment or an event waiting to be histogrammed by one of the filling threads
+   struct TFillJob {
+      std::shared_ptr<const TFragment> fFragment;
+      std::shared_ptr<TUnpackedEvent>  fDetectors;
+   };
+
+   /// histograms filled by one of the filling threads
+   struct THistogramShard {
+      THistogramShard(const std::string& name, TList* gates, std::vector<TFile*>& cutFiles);
+      TList           fObjects;
+      TDirectory*     fDirectory; ///< in-memory directory the histograms of this shard are attached to
+      TRuntimeObjects fObj;
+      std::mutex      fMutex; ///< held while filling, so that the shard can be merged or cleared
+   };
+
+   void QueueJob(TFillJob job);
+   void StartWorkers();
+   void FillingThread(THistogramShard* shard);
+   static void MergeObjects(TList* target, const std::vector<TList*>& sources, TDirectory* directory);
+#endif
    void swap_lib(TCompiledHistograms& other);
    time_t get_timestamp();
    bool   file_exists();
@@ -69,6 +113,14 @@ private:
 
    TRuntimeObjects fObj;
 
+   int fNumberOfThreads; ///< number of filling threads (1 = fill in the calling thread)
+#ifndef __CINT__
+   std::vector<std::thread>                       fWorkers;  ///< filling threads (empty for a single thread)
+   std::vector<std::unique_ptr<THistogramShard>>  fShards;   ///< histograms of each filling thread
+   std::shared_ptr<ThreadsafeQueue<TFillJob>>     fJobQueue; ///< fragments/events waiting to be histogrammed
+   std::atomic<size_t>                            fLibraryGeneration; ///< incremented each time the library is swapped
+#endif
+
    ClassDefOverride(TCompiledHistograms, 0);
 };
 
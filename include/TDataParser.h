@@ -27,6 +27,7 @@
 
 #ifndef __CINT__
 #include <memory>
+#include <functional>
 #endif
 
 #include "TChannel.h"
@@ -34,16 +35,21 @@
 #include "TPPG.h"
 #include "TScaler.h"
 #include "TFragmentMap.h"
+#include "TFragmentPool.h"
 #include "ThreadsafeQueue.h"
 #include "TEpicsFrag.h"
 #include "TGRSIOptions.h"
 
+class TParsingDiagnostics;
+
 class TDataParser {
 public:
    TDataParser();
    ~TDataParser();
    void SetNoWaveForms(bool temp = true) { fNoWaveforms = temp; }
    void SetRecordDiag(bool temp = true) { fRecordDiag = temp; }
+   void SetDiagnostics(TParsingDiagnostics* diagnostics) { fDiagnostics = diagnostics; }
+   void SetDeferOutput(bool temp = true) { fDeferOutput = temp; }
 
    // ENUM(EBank, char, kWFDN,kGRF1,kGRF2,kGRF3,kFME0,kFME1,kFME2,kFME3);
    enum class EBank { kWFDN = 0, kGRF1 = 1, kGRF2 = 2, kGRF3 = 3, kGRF4 = 4, kFME0 = 5, kFME1 = 6, kFME2 = 7, kFME3 = 8 };
@@ -79,8 +85,8 @@ public:
    {
       std::stringstream name;
       name<<"good_frag_queue_"<<fGoodOutputQueues.size();
-      fGoodOutputQueues.push_back(
-         std::make_shared<ThreadsafeQueue<std::shared_ptr<const TFragment>>>(name.str(), maxSize));
+      fGoodOutputQueues.push_back(std::make_shared<ThreadsafeQueue<std::shared_ptr<const TFragment>>>(
+         name.str(), maxSize, TGRSIOptions::Get()->LockFreeQueues() ? EQueueType::kSPSC : EQueueType::kMutex));
       return fGoodOutputQueues.back();
    }
 
@@ -89,6 +95,7 @@ public:
    std::shared_ptr<ThreadsafeQueue<std::shared_ptr<TEpicsFrag>>>& ScalerOutputQueue() { return fScalerOutputQueue; }
 #endif
    void   ClearQueue();
+   void   FlushGoodOutput();
    size_t ItemsPushed()
    {
       if(fGoodOutputQueues.size() > 0) {
@@ -99,19 +106,35 @@ public:
    void        SetFinished();
    std::string OutputQueueStatus();
 
+   TFragmentPool& FragmentPool() { return fFragmentPool; }
+
 #ifndef __CINT__
    void SetStatusVariables(std::atomic_size_t* itemsPopped, std::atomic_long* inputSize)
    {
       fItemsPopped = itemsPopped;
       fInputSize   = inputSize;
    }
+
+   /// Output recorded by a parser in deferred mode, each action pushes one fragment/scaler/PPG event when called
+   /// with the parser that owns the output queues.
+   typedef std::vector<std::function<void(TDataParser&)>> DeferredOutput;
+   void TakeDeferredOutput(DeferredOutput& output);
+   void ReplayDeferredOutput(DeferredOutput& output);
 #endif
 private:
 #ifndef __CINT__
    std::vector<std::shared_ptr<ThreadsafeQueue<std::shared_ptr<const TFragment>>>> fGoodOutputQueues;
    std::shared_ptr<ThreadsafeQueue<std::shared_ptr<const TBadFragment>>>           fBadOutputQueue;
    std::shared_ptr<ThreadsafeQueue<std::shared_ptr<TEpicsFrag>>>                   fScalerOutputQueue;
+   std::vector<std::shared_ptr<const TFragment>> fGoodOutputBuffer; ///< good fragments waiting to be pushed as one batch
+#endif
+   size_t fBatchSize; ///< number of good fragments pushed to the output queues at once
+
+   bool fDeferOutput; ///< The flag to record all output instead of pushing it (used by parallel unpacking)
+#ifndef __CINT__
+   DeferredOutput fDeferredOutput; ///< output recorded in deferred mode
 #endif
+   TParsingDiagnostics* fDiagnostics; ///< diagnostics filled by this parser (TParsingDiagnostics::Get() by default)
 
    bool      fNoWaveforms; ///< The flag to turn wave_forms on or off
    bool      fRecordDiag;  ///< The flag to turn on diagnostics recording
@@ -126,6 +149,7 @@ private:
    bool fFragmentHasWaveform;
 
    TFragmentMap fFragmentMap;              ///< Class that holds a map of fragments per address, takes care of calculating charges for GRF4 banks
+   TFragmentPool fFragmentPool;            ///< Pool of fragments that are recycled once all users have released them
 
    EDataParserState fState;
    std::map<UInt_t, Long64_t> fLastTimeStampMap;
@@ -139,9 +163,11 @@ private:
 
 public:
 #ifndef __CINT__
-   void Push(std::vector<std::shared_ptr<ThreadsafeQueue<std::shared_ptr<const TFragment>>>>& queues,
-             const std::shared_ptr<TFragment>&                                                frag);
+   void Push(const std::shared_ptr<TFragment>& frag);
+   void PushGoodFragment(const std::shared_ptr<const TFragment>& frag);
    void Push(ThreadsafeQueue<std::shared_ptr<const TBadFragment>>& queue, const std::shared_ptr<TBadFragment>& frag);
+   void PushMappedFragment(const std::shared_ptr<TFragment>& frag);
+   void PushDroppedFragment(const std::shared_ptr<TBadFragment>& frag);
 #endif
 
    int TigressDataToFragment(uint32_t* data, int size, unsigned int midasSerialNumber = 0, time_t midasTime = 0);
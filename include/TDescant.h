@@ -40,6 +40,7 @@ public:
 
 #ifndef __CINT__
    void              AddFragment(const std::shared_ptr<const TFragment>&, TChannel*) override; //!<!
+   void              BuildHits() override;                                                    //!<!
    TGRSIDetectorHit* CreateHit(const std::shared_ptr<const TFragment>& frag, TChannel*)
    {
       return new TDescantHit(*frag);
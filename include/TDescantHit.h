@@ -15,13 +15,14 @@
 #include "TChannel.h"
 
 #include "TGRSIDetectorHit.h"
+#include "TWaveformKernels.h"
 
 class TDescantHit : public TGRSIDetectorHit {
 public:
    TDescantHit();
    ~TDescantHit() override;
    TDescantHit(const TDescantHit&);
-   TDescantHit(const TFragment& frag);
+   TDescantHit(const TFragment& frag, bool analyzeWaveform = true);
 
 private:
    Int_t              fFilter;
@@ -74,7 +75,8 @@ public:
 
    bool InFilter(Int_t); //!<!
 
-   bool AnalyzeWaveform(); //!<!
+   bool AnalyzeWaveform();                                       //!<!
+   bool AnalyzeWaveform(TWaveformKernels::TWorkspace& workspace); //!<!
 
    TVector3 GetPosition(Double_t dist) const override; //!<!
    TVector3 GetPosition() const override;              //!<!
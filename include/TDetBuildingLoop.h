@@ -11,23 +11,33 @@
 ///
 /// This loop builds detectors from vectors of fragments.
 ///
+/// With --detector-building-threads N (N > 1) the events are built by N
+/// threads. Built events are passed on in the order they were read, so the
+/// output is the same as with a single thread.
+///
+/// With --waveform-fitting-threads N (N > 0) the waveform fits of the hits
+/// are done for blocks of built events by a TWaveformFitter before the
+/// events are passed on.
+///
 ////////////////////////////////////////////////////////////////////////////////
 
 #ifndef __CINT__
-#include <condition_variable>
-#include <mutex>
-#include <queue>
+#include <memory>
+#include <vector>
+#include "TOrderedWorkerPool.h"
 #endif
 
 #include "StoppableThread.h"
 #include "ThreadsafeQueue.h"
 #include "TFragment.h"
+#include "TGRSIOptions.h"
 
 class TNSCLEvent;
 class TGEBEvent;
 class TUnpackedEvent;
 
 class TDetector;
+class TWaveformFitter;
 
 class TDetBuildingLoop : public StoppableThread {
 public:
@@ -40,7 +50,8 @@ public:
    {
       std::stringstream name;
       name<<"event_queue_"<<fOutputQueues.size();
-      fOutputQueues.push_back(std::make_shared<ThreadsafeQueue<std::shared_ptr<TUnpackedEvent>>>(name.str(), maxSize));
+      fOutputQueues.push_back(std::make_shared<ThreadsafeQueue<std::shared_ptr<TUnpackedEvent>>>(
+         name.str(), maxSize, TGRSIOptions::Get()->LockFreeQueues() ? EQueueType::kSPSC : EQueueType::kMutex));
       return fOutputQueues.back();
    }
 #endif
@@ -60,6 +71,22 @@ public:
    size_t GetRate() override { return 0; }
 
 private:
+#ifndef __CINT__
+   /// an event handed to one of the building threads, and the event built from it
+   struct TDetBuildingJob {
+      size_t                                        fNumber; ///< position of the event in the input queue
+      std::vector<std::shared_ptr<const TFragment>> fFragments;
+      std::shared_ptr<TUnpackedEvent>               fEvent;
+   };
+
+   void StartWorkers();
+   void StopWorkers();
+   void CollectJobs(bool wait);
+   void BuildingThread();
+   void PushEvent(const std::shared_ptr<TUnpackedEvent>& event);
+   void FitEvents();
+#endif
+
    TDetBuildingLoop(std::string name);
    TDetBuildingLoop(const TDetBuildingLoop& other);
    TDetBuildingLoop& operator=(const TDetBuildingLoop& other);
@@ -67,6 +94,13 @@ private:
 #ifndef __CINT__
    std::shared_ptr<ThreadsafeQueue<std::vector<std::shared_ptr<const TFragment>>>> fInputQueue;
    std::vector<std::shared_ptr<ThreadsafeQueue<std::shared_ptr<TUnpackedEvent>>>>  fOutputQueues;
+
+   bool                                               fStartWorkers; ///< building threads haven't been started yet
+   TOrderedWorkerPool<TDetBuildingJob>                fWorkerPool;   ///< building threads (if more than one)
+
+   std::unique_ptr<TWaveformFitter>             fFitter;    ///< fits the waveforms of blocks of events (if requested)
+   std::vector<std::shared_ptr<TUnpackedEvent>> fFitEvents; ///< built events waiting for their waveform fits
+   static const size_t                          fFitBlockSize = 512; ///< number of events whose waveforms are fitted together
 #endif
 
    ClassDefOverride(TDetBuildingLoop, 0);
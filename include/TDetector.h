@@ -19,6 +19,8 @@
 #include "TFragment.h"
 #include "TChannel.h"
 
+class TWaveformFitter;
+
 /////////////////////////////////////////////////////////////////
 ///
 /// \class TDetector
@@ -50,6 +52,7 @@ public:
    {
       AbstractMethod("AddFragment()");
    } //!<!
+   virtual void AddWaveformFits(TWaveformFitter&) {} //!<!
 #endif
 
    void Copy(TObject&) const override;            //!<!
@@ -12,6 +12,14 @@
 /// This loop builds events (vectors of fragments) based on timestamps and a
 /// build windows.
 ///
+/// Fragments are sorted by merging sorted runs (TMergeSorter), the old
+/// std::multiset can still be selected with --multiset-sorting. Both give
+/// the same order, fragments with equal timestamps (trigger ids) are kept
+/// in the order they arrived in.
+///
+/// With --adaptive-sort-depth the sort depth starts at --sort-depth and is
+/// adapted to the disorder of the fragments read (see TAdaptiveSortDepth).
+///
 ////////////////////////////////////////////////////////////////////////////////
 
 #ifndef __CINT__
@@ -23,6 +31,8 @@
 #include "StoppableThread.h"
 #include "ThreadsafeQueue.h"
 #include "TFragment.h"
+#include "TMergeSorter.h"
+#include "TAdaptiveSortDepth.h"
 
 class TEventBuildingLoop : public StoppableThread {
 public:
@@ -52,8 +62,8 @@ public:
    void SetBuildWindow(long clock_ticks) { fBuildWindow = clock_ticks; }
    unsigned long            GetBuildWindow() const { return fBuildWindow; }
 
-   void SetSortDepth(int num_events) { fSortingDepth = num_events; }
-   unsigned int          GetSortDepth() const { return fSortingDepth; }
+   void         SetSortDepth(int num_events);
+   unsigned int GetSortDepth() const { return fSortingDepth; }
 
    std::string EndStatus() override;
 
@@ -67,6 +77,13 @@ private:
    bool CheckTimestampCondition(const std::shared_ptr<const TFragment>&);
    bool CheckTriggerIdCondition(const std::shared_ptr<const TFragment>&);
 
+   long                             SortingKey(const std::shared_ptr<const TFragment>& frag) const;
+   size_t                           SortedSize() const;
+   void                             InsertSorted(std::shared_ptr<const TFragment> frag);
+   std::shared_ptr<const TFragment> PopSorted();
+   void                             BuildNextFragment();
+   std::string                      SortDepthAdvice() const;
+
    std::shared_ptr<ThreadsafeQueue<std::shared_ptr<const TFragment>>>              fInputQueue;
    std::shared_ptr<ThreadsafeQueue<std::vector<std::shared_ptr<const TFragment>>>> fOutputQueue;
    std::shared_ptr<ThreadsafeQueue<std::shared_ptr<const TFragment>>>              fOutOfOrderQueue;
@@ -76,13 +93,20 @@ private:
    unsigned int fSortingDepth;
    long         fBuildWindow;
    bool         fPreviousSortingDepthError;
+   size_t       fBatchSize;       ///< maximum number of fragments popped from the input queue at once
+   bool         fMultisetSorting; ///< use fOrdered instead of fSorter
 
 #ifndef __CINT__
    std::vector<std::shared_ptr<const TFragment>> fNextEvent;
+   std::vector<std::shared_ptr<const TFragment>> fInputBatch;         ///< fragments popped from the input queue
+   size_t                                        fInputBatchPosition; ///< next fragment of fInputBatch to be sorted
 
+   TMergeSorter<std::shared_ptr<const TFragment>> fSorter;
    std::multiset<std::shared_ptr<const TFragment>,
-                 std::function<bool(std::shared_ptr<const TFragment>, std::shared_ptr<const TFragment>)>>
+                 std::function<bool(const std::shared_ptr<const TFragment>&, const std::shared_ptr<const TFragment>&)>>
       fOrdered;
+
+   std::unique_ptr<TAdaptiveSortDepth> fAdaptiveDepth; ///< adapts fSortingDepth (with --adaptive-sort-depth)
 #endif
 
    ClassDefOverride(TEventBuildingLoop, 0);
@@ -15,6 +15,7 @@
 ////////////////////////////////////////////////////////////////////////////////
 
 #include <string>
+#include <vector>
 
 #include "StoppableThread.h"
 #include "TCompiledHistograms.h"
@@ -69,7 +70,9 @@ private:
 
 #ifndef __CINT__
    std::shared_ptr<ThreadsafeQueue<std::shared_ptr<const TFragment>>> fInputQueue;
+   std::vector<std::shared_ptr<const TFragment>>                      fInputBatch; ///< fragments popped at once
 #endif
+   size_t fBatchSize; ///< maximum number of fragments popped at once
 
    ClassDefOverride(TFragHistLoop, 0);
 };
@@ -14,6 +14,7 @@
 ////////////////////////////////////////////////////////////////////////////////
 
 #include <map>
+#include <vector>
 
 #include "TClass.h"
 #include "TTree.h"
@@ -23,6 +24,7 @@
 #include "TFragment.h"
 #include "TBadFragment.h"
 #include "TEpicsFrag.h"
+#include "TScaler.h"
 
 class TFragWriteLoop : public StoppableThread {
 public:
@@ -60,23 +62,28 @@ private:
    void WriteBadEvent(const std::shared_ptr<const TBadFragment>& event);
    void WriteScaler(const std::shared_ptr<TEpicsFrag>& scaler);
 #endif
+   bool WriteDeadtimeScalers();
 
    TFile* fOutputFile;
 
    TTree* fEventTree;
    TTree* fBadEventTree;
    TTree* fScalerTree;
+   TTree* fDeadtimeScalerTree;
 
    TFragment*    fEventAddress;
    TBadFragment* fBadEventAddress;
    TEpicsFrag*   fScalerAddress;
+   TScalerData*  fDeadtimeScalerAddress;
 
 #ifndef __CINT__
    std::shared_ptr<ThreadsafeQueue<std::shared_ptr<const TFragment>>> fInputQueue;
    std::shared_ptr<ThreadsafeQueue<std::shared_ptr<const TBadFragment>>> fBadInputQueue;
    std::shared_ptr<ThreadsafeQueue<std::shared_ptr<TEpicsFrag>>>      fScalerInputQueue;
    std::shared_ptr<ThreadsafeQueue<std::shared_ptr<const TFragment>>> fOutputQueue;
+   std::vector<std::shared_ptr<const TFragment>>                      fInputBatch; ///< fragments popped at once
 #endif
+   size_t fBatchSize; ///< maximum number of fragments popped at once
 
    ClassDefOverride(TFragWriteLoop, 0);
 };
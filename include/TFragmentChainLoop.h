@@ -11,11 +11,17 @@
 ///
 /// This loop reads fragments from a root-file with a FragmentTree.
 ///
+/// Fragments are read through a tree cache and passed on in batches of
+/// --fragment-batch-size. With --reading-threads N (N > 1) chunks of entries
+/// are read by N threads, each with its own chain, so the baskets are read
+/// and decompressed in parallel. The chunks are passed on in the order of the
+/// chain, so the output is the same as with a single thread.
+///
 ////////////////////////////////////////////////////////////////////////////////
 
 #ifndef __CINT__
-#include <atomic>
 #include <memory>
+#include "TOrderedWorkerPool.h"
 #endif
 
 #include <map>
@@ -27,6 +33,7 @@
 #include "StoppableThread.h"
 #include "ThreadsafeQueue.h"
 #include "TFragment.h"
+#include "TGRSIOptions.h"
 
 class TFragmentChainLoop : public StoppableThread {
 public:
@@ -36,7 +43,10 @@ public:
 #ifndef __CINT__
    std::shared_ptr<ThreadsafeQueue<std::shared_ptr<const TFragment>>>& AddOutputQueue()
    {
-      fOutputQueues.push_back(std::make_shared<ThreadsafeQueue<std::shared_ptr<const TFragment>>>());
+      std::stringstream name;
+      name<<"fragment_queue_"<<fOutputQueues.size();
+      fOutputQueues.push_back(std::make_shared<ThreadsafeQueue<std::shared_ptr<const TFragment>>>(
+         name.str(), 50000, TGRSIOptions::Get()->LockFreeQueues() ? EQueueType::kSPSC : EQueueType::kMutex));
       return fOutputQueues.back();
    }
 #endif
@@ -60,12 +70,37 @@ protected:
 private:
    TFragmentChainLoop(std::string name, TChain* chain);
 
+#ifndef __CINT__
+   /// a chunk of consecutive entries read by one of the reading threads
+   struct TFragmentChainJob {
+      size_t                                  fNumber; ///< number of the chunk, starting at 0 for the first entry
+      std::vector<std::shared_ptr<TFragment>> fFragments;
+   };
+
+   void StartWorkers();
+   void StopWorkers();
+   bool ThreadedIteration();
+   void CollectJobs(bool wait);
+   void PassOn(TFragmentChainJob& job);
+   void ReadingThread();
+   void PushFragment(const std::shared_ptr<TFragment>& frag);
+   void FlushOutput();
+#endif
+
    long fEntriesTotal;
 
    TChain* fInputChain;
 #ifndef __CINT__
    TFragment*                                                                      fFragment;
    std::vector<std::shared_ptr<ThreadsafeQueue<std::shared_ptr<const TFragment>>>> fOutputQueues;
+
+   size_t                                        fBatchSize;    ///< number of fragments pushed to the output queues at once
+   std::vector<std::shared_ptr<const TFragment>> fOutputBuffer; ///< fragments waiting to be pushed as one batch
+
+   bool                                  fStartWorkers; ///< reading threads haven't been started yet
+   std::vector<std::string>              fFileNames;    ///< files of the input chain, opened by each reading thread
+   long                                  fChunkSize;    ///< number of entries read by a reading thread at once
+   TOrderedWorkerPool<TFragmentChainJob> fWorkerPool;   ///< reading threads (if more than one)
 #endif
 
    bool fSelfStopping;
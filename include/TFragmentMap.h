@@ -18,6 +18,7 @@
 #include <map>
 #include <vector>
 #ifndef __CINT__
+#include <functional>
 #include <tuple>
 #include <memory>
 #endif
@@ -28,8 +29,8 @@
 class TFragmentMap {
 public:
 #ifndef __CINT__
-   TFragmentMap(std::vector<std::shared_ptr<ThreadsafeQueue<std::shared_ptr<const TFragment>>>>& good_output_queue,
-                std::shared_ptr<ThreadsafeQueue<std::shared_ptr<const TBadFragment>>>&           bad_output_queue);
+   TFragmentMap(std::function<void(const std::shared_ptr<TFragment>&)>    good_output,
+                std::function<void(const std::shared_ptr<TBadFragment>&)> bad_output);
 #endif
 
    ~TFragmentMap() = default;
@@ -47,8 +48,8 @@ private:
                                                                  std::vector<Short_t>>>::iterator>& range);
 
    std::multimap<UInt_t, std::tuple<std::shared_ptr<TFragment>, std::vector<Int_t>, std::vector<Short_t>>> fMap;
-   std::vector<std::shared_ptr<ThreadsafeQueue<std::shared_ptr<const TFragment>>>>& fGoodOutputQueue;
-   std::shared_ptr<ThreadsafeQueue<std::shared_ptr<const TBadFragment>>>&           fBadOutputQueue;
+   std::function<void(const std::shared_ptr<TFragment>&)>    fGoodOutput; ///< passes good fragments on to the output queue(s)
+   std::function<void(const std::shared_ptr<TBadFragment>&)> fBadOutput;  ///< passes dropped fragments on to the bad output queue
 #endif
 };
 /*! @} */
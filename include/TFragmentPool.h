@@ -0,0 +1,81 @@
+#ifndef TFRAGMENTPOOL_H
+#define TFRAGMENTPOOL_H
+
+/** \addtogroup Sorting
+ *  @{
+ */
+
+/////////////////////////////////////////////////////////////////
+///
+/// \class TFragmentPool
+///
+/// Pool of fragments that are handed out again once all users
+/// (output queues, event building, writing, ...) have released
+/// them. Reusing a fragment avoids allocating a new fragment and
+/// keeps the memory of the trigger id and waveform vectors.
+///
+/// The shared pointers handed out by the pool have a deleter that
+/// puts the fragment back on the free list of the pool instead of
+/// deleting it, so Get() never has to look for a free fragment.
+/// The free list is shared by the pool and its fragments, so the
+/// fragments can outlive the pool. Get() must only be called from
+/// one thread (each TDataParser has its own pool), releasing the
+/// fragments can happen in any thread.
+///
+/////////////////////////////////////////////////////////////////
+
+#include <string>
+#include <vector>
+
+#ifndef __CINT__
+#include <memory>
+#include <mutex>
+#endif
+
+#include "TFragment.h"
+
+class TFragmentPool {
+public:
+   explicit TFragmentPool(size_t maxSize = 100000);
+   TFragmentPool(const TFragmentPool&) = delete;
+   TFragmentPool& operator=(const TFragmentPool&) = delete;
+   ~TFragmentPool();
+
+#ifndef __CINT__
+   std::shared_ptr<TFragment> Get();                     ///< returns a cleared fragment
+   std::shared_ptr<TFragment> Get(const TFragment& rhs); ///< returns a copy of rhs
+#endif
+
+   void        AddStatistics(const TFragmentPool& rhs);
+   std::string Status() const;
+
+   size_t Size() const { return fSize; }
+   size_t MaxSize() const { return fMaxSize; }
+
+private:
+#ifndef __CINT__
+   /// fragments that have been released by their last user, shared by the pool and the deleters of its fragments
+   struct TFreeList {
+      std::mutex              fMutex;
+      std::vector<TFragment*> fFragments;
+      bool                    fClosed{false}; ///< set once the pool is gone, released fragments are deleted then
+   };
+
+   /// deleter of the fragments of the pool, returns the fragment to the free list
+   struct TRecycler {
+      std::shared_ptr<TFreeList> fFreeList;
+      void                       operator()(TFragment* frag) const;
+   };
+
+   std::shared_ptr<TFreeList> fFreeList;
+   std::vector<TFragment*>    fAvailable; ///< fragments taken from the free list, only used by the thread calling Get
+#endif
+   size_t fSize;    ///< number of fragments created by this pool
+   size_t fMaxSize; ///< maximum number of fragments in the pool (0 = pool disabled)
+
+   size_t fRecycled; ///< number of fragments handed out again
+   size_t fCreated;  ///< number of fragments created for the pool
+   size_t fUnpooled; ///< number of fragments created outside of the pool because it was full
+};
+/*! @} */
+#endif
@@ -19,6 +19,7 @@
 
 #include "TPPG.h"
 #include "TTransientBits.h"
+#include "TGRSIRandom.h"
 
 class TGRSIDetector;
 
@@ -106,7 +107,10 @@ public:
    void SetAddress(const UInt_t& temp_address) { fAddress = temp_address; }                 //!<!
    void SetKValue(const Short_t& temp_kval) { fKValue = temp_kval; }                        //!<!
    void SetCharge(const Float_t& temp_charge) { fCharge = temp_charge; }                    //!<!
-   void SetCharge(const Int_t& temp_charge) { fCharge = temp_charge + gRandom->Uniform(); } //!<!
+   void SetCharge(const Int_t& temp_charge)
+   {
+      fCharge = temp_charge + TGRSIRandom::Dither(fAddress, fTimeStamp, temp_charge, TGRSIRandom::kCharge);
+   } //!<!
    virtual void SetCfd(const Int_t& x) { fCfd = x; }                                        //!<!
    void SetWaveform(const std::vector<Short_t>& x) { fWaveform = x; }                       //!<!
    void AddWaveformSample(const Short_t& x) { fWaveform.push_back(x); }                     //!<!
@@ -186,6 +190,8 @@ protected:
    Bool_t IsChannelSet() const { return (fBitflags.TestBit(EBitFlag::kIsChannelSet)); }
    Bool_t IsTimeSet() const { return (fBitflags.TestBit(EBitFlag::kIsTimeSet)); }
    Bool_t IsPPGSet() const { return (fBitflags.TestBit(EBitFlag::kIsPPGSet)); }
+   /// dither in [0, 1) for the time/cfd of this hit (see TGRSIRandom)
+   Double_t Dither(UInt_t use) const { return TGRSIRandom::Dither(fAddress, fTimeStamp, fCfd, use); }
 
 public:
    void SetHitBit(EBitFlag, Bool_t set = true) const; // const here is dirty
@@ -106,9 +106,21 @@ public:
 
 	size_t FragmentWriteQueueSize() const { return fFragmentWriteQueueSize; }
 	size_t AnalysisWriteQueueSize() const { return fAnalysisWriteQueueSize; }
-
-	bool TimeSortInput() const { return fTimeSortInput; }
-	int  SortDepth() const { return fSortDepth; }
+	bool   LockFreeQueues() const { return fLockFreeQueues; }
+	size_t FragmentBatchSize() const { return fFragmentBatchSize; }
+	int    UnpackingThreads() const { return fUnpackingThreads; }
+	size_t FragmentPoolSize() const { return fFragmentPoolSize; }
+	int    DetBuildingThreads() const { return fDetBuildingThreads; }
+	int    HistogramThreads() const { return fHistogramThreads; }
+	int    ReadingThreads() const { return fReadingThreads; }
+	int    WaveformFittingThreads() const { return fWaveformFittingThreads; }
+
+	bool   TimeSortInput() const { return fTimeSortInput; }
+	int    SortDepth() const { return fSortDepth; }
+	bool   MultisetSorting() const { return fMultisetSorting; }
+	bool   AdaptiveSortDepth() const { return fAdaptiveSortDepth; }
+	int    MaxSortDepth() const { return fMaxSortDepth; }
+	double OutOfOrderRate() const { return fOutOfOrderRate; }
 
 	bool ShouldExitImmediately() const { return fShouldExit; }
 
@@ -194,9 +206,21 @@ private:
 
 	size_t fFragmentWriteQueueSize; ///< Size of the Fragment write Q
 	size_t fAnalysisWriteQueueSize; ///< Size of the analysis write Q
-
-	bool fTimeSortInput; ///< Flag to sort on time or triggers
-	int  fSortDepth;     ///< Size of Q that stores fragments to be built into events
+	bool   fLockFreeQueues;         ///< Flag to use lock-free ring buffers for the queues between loops
+	size_t fFragmentBatchSize;      ///< Number of fragments passed between loops at once (1 = no batching)
+	int    fUnpackingThreads;       ///< Number of threads used to unpack midas events (1 = serial unpacking)
+	size_t fFragmentPoolSize;       ///< Maximum number of fragments recycled by each data parser (0 = no recycling)
+	int    fDetBuildingThreads;     ///< Number of threads used to build detectors from events (1 = single thread)
+	int    fHistogramThreads;       ///< Number of threads used to fill the online histograms (1 = single thread)
+	int    fReadingThreads;         ///< Number of threads used to read fragment trees (1 = single thread)
+	int    fWaveformFittingThreads; ///< Number of threads used to fit the waveforms of blocks of events (0 = fit each hit when it is built)
+
+	bool   fTimeSortInput;     ///< Flag to sort on time or triggers
+	int    fSortDepth;         ///< Size of Q that stores fragments to be built into events
+	bool   fMultisetSorting;   ///< Flag to sort fragments with a std::multiset instead of merging sorted runs
+	bool   fAdaptiveSortDepth; ///< Flag to adapt the sort depth to the disorder of the fragments
+	int    fMaxSortDepth;      ///< Maximum sort depth with fAdaptiveSortDepth
+	double fOutOfOrderRate;    ///< Fraction of fragments the adaptive sort depth may leave out of order
 
 	static TAnalysisOptions* fAnalysisOptions; ///< contains all options for analysis
 
@@ -216,7 +240,7 @@ private:
 	bool fSelectorOnly; ///< Flag to turn PROOF off in grsiproof
 
 	/// \cond CLASSIMP
-	ClassDefOverride(TGRSIOptions, 3); ///< Class for storing options in GRSISort
+	ClassDefOverride(TGRSIOptions, 13); ///< Class for storing options in GRSISort
 	/// \endcond
 };
 /*! @} */
@@ -0,0 +1,41 @@
+#ifndef TGRSIRANDOM_H
+#define TGRSIRANDOM_H
+
+/** \addtogroup Sorting
+ *  @{
+ */
+
+////////////////////////////////////////////////////////////////////////////////
+///
+/// \class TGRSIRandom
+///
+/// Random numbers used to dither charges and times of hits and to smear
+/// positions. Each thread has its own xoshiro256+ generator, so unpacking,
+/// detector building, and PROOF workers can draw random numbers without
+/// locking, and without touching gRandom.
+///
+/// With --deterministic-dither (see TAnalysisOptions) the dither of a hit is
+/// derived from a hash of its address, timestamp, and the dithered value
+/// instead, which makes the output bit-identical independent of the number
+/// of threads used.
+///
+////////////////////////////////////////////////////////////////////////////////
+
+#include "Rtypes.h"
+
+class TGRSIRandom {
+public:
+   /// what a dither is used for, so that dithers of different quantities of the same hit are independent
+   enum EDither : UInt_t { kCharge = 0, kCfd = 1, kTime = 2 };
+
+   static Double_t Uniform();                                ///< uniform in [0, 1) from this thread's generator
+   static Double_t Uniform(Double_t low, Double_t high);     ///< uniform in [low, high) from this thread's generator
+   static void     Circle(Double_t& x, Double_t& y, Double_t r); ///< random point on a circle of radius r
+
+   static Double_t Dither(UInt_t address, Long64_t timeStamp, Long64_t value, UInt_t use);
+
+   static void      SetSeed(ULong64_t seed); ///< re-seeds the generators of all threads (on their next use)
+   static ULong64_t GetSeed();
+};
+/*! @} */
+#endif
@@ -19,7 +19,11 @@
 #include "GCube.h"
 #include "TAnalysisOptions.h"
 
+#include <map>
 #include <string>
+#include <vector>
+
+class TBranch;
 
 // Fixed size dimensions of array or collections stored in the TTree if any.
 
@@ -56,6 +60,13 @@ public:
    void SetOutputPrefix(const char* prefix) { fOutputPrefix = prefix; }
 
 protected:
+   void UseBranch(const std::string& name, const std::vector<std::string>& members = {}, bool lazy = false);
+   bool LoadBranch(const std::string& name);
+
+   TH2* CreateMatrix(const char* name, const char* title, Int_t nbinsx, Double_t xlow, Double_t xup, Int_t nbinsy,
+                     Double_t ylow, Double_t yup);
+   GHSym* CreateSymMatrix(const char* name, const char* title, Int_t nbins, Double_t low, Double_t up);
+
    std::map<std::string, TH1*>        fH1;
    std::map<std::string, TH2*>        fH2;
    std::map<std::string, GHSym*>      fSym;
@@ -63,9 +74,22 @@ protected:
    std::map<std::string, THnSparseF*> fHSparse;
 
 private:
+   /// a branch the selector declared with UseBranch
+   struct TBranchRequest {
+      std::vector<std::string> fMembers;            ///< members to read (empty = all)
+      bool                     fLazy{false};        ///< only read when LoadBranch is called
+      TBranch*                 fBranch{nullptr};    ///< branch in the current tree
+      Long64_t                 fLoadedEntry{-1};    ///< entry the branch was last read for
+   };
+
+   void ApplyBranchRequests();
+
    std::string       fOutputPrefix;
    TAnalysisOptions* fAnalysisOptions{nullptr};
 
+   std::map<std::string, TBranchRequest> fBranchRequests; //! branches to read, if empty all branches are read
+   Long64_t                              fCurrentEntry{-1}; //! entry currently processed
+
    ClassDefOverride(TGRSISelector, 2);
 };
 
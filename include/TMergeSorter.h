@@ -0,0 +1,152 @@
+#ifndef TMERGESORTER_H
+#define TMERGESORTER_H
+
+/** \addtogroup Loops
+ *  @{
+ */
+
+////////////////////////////////////////////////////////////////////////////////
+///
+/// \class TMergeSorter
+///
+/// Sorting window for items that arrive nearly ordered by a key (e.g. the
+/// timestamps of fragments). Inserted items are appended to sorted runs
+/// (the run with the largest last key that is not larger than the new key,
+/// or a new run), and Pop() does a k-way merge over the first items of all
+/// runs. For nearly ordered data there are only a few runs, so inserting and
+/// popping is cheap, and no allocation is needed per item.
+///
+/// Items are popped in order of their key, items with equal keys in the
+/// order they were inserted. This is the same order a std::multiset with
+/// the same key would give.
+///
+////////////////////////////////////////////////////////////////////////////////
+
+#ifndef __CINT__
+#include <algorithm>
+#include <functional>
+#include <utility>
+#include <vector>
+#endif
+
+#ifndef __CINT__
+template <typename T>
+class TMergeSorter {
+public:
+   TMergeSorter() : fSequence(0), fSize(0) {}
+
+   void Insert(long key, T item)
+   {
+      /// adds item to the run with the largest last key that is smaller than or equal to key
+      Entry entry{key, fSequence++, std::move(item)};
+      auto  it = std::upper_bound(fRunOrder.begin(), fRunOrder.end(), key,
+                                 [this](long k, size_t run) { return k < fRuns[run].fEntries.back().fKey; });
+      if(it == fRunOrder.begin()) {
+         // the key is smaller than the last key of all runs, so we start a new run
+         size_t run = NewRun();
+         fRuns[run].fEntries.push_back(std::move(entry));
+         fRunOrder.insert(fRunOrder.begin(), run);
+         PushHead(run);
+      } else {
+         fRuns[*(it - 1)].fEntries.push_back(std::move(entry));
+      }
+      ++fSize;
+   }
+
+   T Pop()
+   {
+      /// removes and returns the item with the smallest key, must not be called if the sorter is empty
+      std::pop_heap(fHeads.begin(), fHeads.end(), std::greater<Head>());
+      size_t runIndex = fHeads.back().fRun;
+      fHeads.pop_back();
+
+      Run& run  = fRuns[runIndex];
+      T    item = std::move(run.fEntries[run.fHead].fItem);
+      ++run.fHead;
+      if(run.fHead < run.fEntries.size()) {
+         // drop the used up entries once they make up the larger part of the run
+         if(run.fHead >= kCompactSize && 2 * run.fHead > run.fEntries.size()) {
+            run.fEntries.erase(run.fEntries.begin(), run.fEntries.begin() + run.fHead);
+            run.fHead = 0;
+         }
+         PushHead(runIndex);
+      } else {
+         fRunOrder.erase(std::find(fRunOrder.begin(), fRunOrder.end(), runIndex));
+         run.fEntries.clear();
+         run.fHead = 0;
+         fFreeRuns.push_back(runIndex);
+      }
+      --fSize;
+
+      return item;
+   }
+
+   void Clear()
+   {
+      fRuns.clear();
+      fFreeRuns.clear();
+      fRunOrder.clear();
+      fHeads.clear();
+      fSize = 0;
+   }
+
+   size_t Size() const { return fSize; }
+   bool   Empty() const { return fSize == 0; }
+   size_t NumberOfRuns() const { return fRunOrder.size(); }
+
+private:
+   static const size_t kCompactSize = 1024; ///< minimum number of used up entries before a run is compacted
+
+   struct Entry {
+      long   fKey;
+      size_t fSequence; ///< insertion order, used for items with equal keys
+      T      fItem;
+   };
+
+   struct Run {
+      std::vector<Entry> fEntries;
+      size_t             fHead{0}; ///< first entry that hasn't been popped yet
+   };
+
+   struct Head {
+      long   fKey;
+      size_t fSequence;
+      size_t fRun;
+      bool   operator>(const Head& rhs) const
+      {
+         return fKey > rhs.fKey || (fKey == rhs.fKey && fSequence > rhs.fSequence);
+      }
+   };
+
+   size_t NewRun()
+   {
+      if(!fFreeRuns.empty()) {
+         size_t run = fFreeRuns.back();
+         fFreeRuns.pop_back();
+         return run;
+      }
+      fRuns.emplace_back();
+      return fRuns.size() - 1;
+   }
+
+   void PushHead(size_t runIndex)
+   {
+      const Entry& first = fRuns[runIndex].fEntries[fRuns[runIndex].fHead];
+      fHeads.push_back(Head{first.fKey, first.fSequence, runIndex});
+      std::push_heap(fHeads.begin(), fHeads.end(), std::greater<Head>());
+   }
+
+   std::vector<Run>    fRuns;     ///< all runs, including unused ones
+   std::vector<size_t> fFreeRuns; ///< unused runs
+   std::vector<size_t> fRunOrder; ///< runs in use, ordered by their last key
+   std::vector<Head>   fHeads;    ///< heap of the first entries of all runs in use
+   size_t              fSequence;
+   size_t              fSize;
+};
+
+template <typename T>
+const size_t TMergeSorter<T>::kCompactSize;
+#endif
+
+/*! @} */
+#endif /* TMERGESORTER_H */
@@ -5,6 +5,10 @@
  *  @{
  */
 
+#ifndef __CINT__
+#include <memory>
+#endif
+
 #include "Globals.h"
 #include "TMidasEventHeader.h"
 #include "TDataParser.h"
@@ -71,6 +75,9 @@ public:
 
    void AllocateData();                     ///< allocate data buffer using the existing event header
    void SetData(uint32_t size, char* data); ///< set an externally allocated data buffer
+#ifndef __CINT__
+   void SetData(uint32_t size, char* data, std::shared_ptr<void> keepAlive); ///< set an external data buffer and keep it alive
+#endif
 
    int  SetBankList();      ///< create the list of data banks, return number of banks
    bool IsGoodSize() const; ///< validate the event length
@@ -90,6 +97,9 @@ protected:
    int                 fBanksN;        ///< number of banks in this event
    char*               fBankList;      ///< list of bank names in this event
    bool                fAllocatedByUs; ///< "true" if we own the data buffer
+#ifndef __CINT__
+   std::shared_ptr<void> fKeepAlive; ///< keeps an external data buffer (e.g. a memory-mapped file) alive
+#endif
 
    /// \cond CLASSIMP
    ClassDefOverride(TMidasEvent, 0) // All of the data contained in a Midas Event
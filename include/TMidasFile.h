@@ -15,6 +15,10 @@
 /////////////////////////////////////////////////////////////////
 
 #include <string>
+#ifndef __CINT__
+#include <memory>
+#include "TReadAheadBuffer.h"
+#endif
 
 #ifdef __APPLE__
 #include <_types/_uint32_t.h>
@@ -75,6 +79,12 @@ public:
 
 protected:
    void ReadMoreBytes(size_t bytes);
+#ifndef __CINT__
+   int ReadMapped(const std::shared_ptr<TMidasEvent>& midasEvent);
+#endif
+   bool MapFile();
+   void ReadAhead();
+   void StartReadAheadBuffer();
 
 #ifndef __CINT__
    std::shared_ptr<TMidasEvent> fFirstEvent;
@@ -99,6 +109,17 @@ protected:
    int   fOutFile;   ///< open output file descriptor
    void* fOutGzFile; ///< zlib compressed output file reader
 
+#ifndef __CINT__
+   std::shared_ptr<char> fMapping; ///< memory-mapped input file (nullptr if we read via read()/gzread()), shared with the events
+#endif
+   size_t fMappedSize;        ///< size of the mapped input file
+   size_t fMappedPosition;    ///< position of the next event in the mapped input file
+   size_t fReadAheadPosition; ///< end of the range of the mapped input file the kernel was asked to read ahead
+
+#ifndef __CINT__
+   std::unique_ptr<TReadAheadBuffer> fReadAheadBuffer; ///< reads compressed files and pipes in a background thread
+#endif
+
    /// \cond CLASSIMP
    ClassDefOverride(TMidasFile, 0) // Used to open and write Midas Files
    /// \endcond
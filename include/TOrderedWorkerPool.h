@@ -0,0 +1,163 @@
+#ifndef TORDEREDWORKERPOOL_H
+#define TORDEREDWORKERPOOL_H
+
+/** \addtogroup Loops
+ *  @{
+ */
+
+////////////////////////////////////////////////////////////////////////////////
+///
+/// \class TOrderedWorkerPool
+///
+/// Pool of worker threads used by the loops that process their input with
+/// several threads (TUnpackingLoop, TDetBuildingLoop, TFragmentChainLoop).
+///
+/// The loop dispatches jobs (numbered in the order they are dispatched) to the
+/// job queue, the worker threads get them with NextJob and hand them back with
+/// JobDone. Collect moves the finished jobs to a reorder buffer and passes all
+/// jobs that are next in line on to the loop, so the jobs leave the pool in the
+/// order they were dispatched, independent of the number of threads. At most
+/// the maximum number of jobs in flight are dispatched but not collected yet.
+///
+/// The job type needs a size_t member fNumber, which is set by Dispatch.
+///
+////////////////////////////////////////////////////////////////////////////////
+
+#ifndef __CINT__
+#include <functional>
+#include <map>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+#endif
+
+#include "ThreadsafeQueue.h"
+#include "TGRSIOptions.h"
+
+#ifndef __CINT__
+template <class Job>
+class TOrderedWorkerPool {
+public:
+   TOrderedWorkerPool() = default;
+   TOrderedWorkerPool(const TOrderedWorkerPool&) = delete;
+   TOrderedWorkerPool& operator=(const TOrderedWorkerPool&) = delete;
+   ~TOrderedWorkerPool() { Abort(); }
+
+   void Start(const std::string& name, int nofThreads, size_t maxJobsInFlight,
+              const std::function<void(size_t)>& worker);
+   void Stop(const std::function<void(Job&)>& output);
+   void Abort();
+
+   void Dispatch(std::shared_ptr<Job> job, bool toWorkers = true);
+   void Collect(bool wait, const std::function<void(Job&)>& output);
+
+   bool NextJob(std::shared_ptr<Job>& job);
+   void JobDone(std::shared_ptr<Job> job) { fDoneQueue->Push(std::move(job)); }
+
+   bool   Running() const { return !fWorkers.empty(); }
+   bool   Full() const { return fJobsDispatched - fJobsCollected >= fMaxJobsInFlight; }
+   bool   Idle() const { return fJobsCollected == fJobsDispatched; }
+   size_t JobsDispatched() const { return fJobsDispatched; }
+   size_t JobsCollected() const { return fJobsCollected; }
+
+private:
+   std::vector<std::thread>                               fWorkers;
+   std::shared_ptr<ThreadsafeQueue<std::shared_ptr<Job>>> fJobQueue;  ///< jobs waiting for a worker
+   std::shared_ptr<ThreadsafeQueue<std::shared_ptr<Job>>> fDoneQueue; ///< jobs the workers are done with
+   std::map<size_t, std::shared_ptr<Job>>                 fReorderBuffer; ///< finished jobs waiting for earlier jobs
+   size_t fJobsDispatched{0};  ///< number of jobs handed out
+   size_t fJobsCollected{0};   ///< number of jobs passed on
+   size_t fMaxJobsInFlight{0}; ///< maximum number of jobs handed out but not passed on yet
+};
+
+template <class Job>
+void TOrderedWorkerPool<Job>::Start(const std::string& name, int nofThreads, size_t maxJobsInFlight,
+                                    const std::function<void(size_t)>& worker)
+{
+   /// Starts nofThreads threads running worker (with the index of the thread), which should process jobs from NextJob
+   /// until it returns false.
+   // the job queue has one producer and many consumers, the done queue many producers and one consumer
+   EQueueType type  = TGRSIOptions::Get()->LockFreeQueues() ? EQueueType::kMPMC : EQueueType::kMutex;
+   fMaxJobsInFlight = maxJobsInFlight;
+   fJobQueue  = std::make_shared<ThreadsafeQueue<std::shared_ptr<Job>>>(name + "_job_queue", fMaxJobsInFlight, type);
+   fDoneQueue = std::make_shared<ThreadsafeQueue<std::shared_ptr<Job>>>(name + "_done_queue", fMaxJobsInFlight, type);
+
+   for(int i = 0; i < nofThreads; ++i) {
+      fWorkers.emplace_back(worker, static_cast<size_t>(i));
+   }
+}
+
+template <class Job>
+void TOrderedWorkerPool<Job>::Stop(const std::function<void(Job&)>& output)
+{
+   /// Passes on all remaining jobs and stops the worker threads.
+   while(fJobsCollected < fJobsDispatched) {
+      Collect(true, output);
+   }
+   Abort();
+}
+
+template <class Job>
+void TOrderedWorkerPool<Job>::Abort()
+{
+   /// Stops the worker threads and drops all jobs that haven't been passed on yet, e.g. if the loop was stopped before
+   /// its input was finished.
+   if(!fWorkers.empty()) {
+      fJobQueue->SetFinished();
+      for(auto& worker : fWorkers) {
+         worker.join();
+      }
+      fWorkers.clear();
+   }
+   fReorderBuffer.clear();
+   fJobsDispatched = 0;
+   fJobsCollected  = 0;
+}
+
+template <class Job>
+void TOrderedWorkerPool<Job>::Dispatch(std::shared_ptr<Job> job, bool toWorkers)
+{
+   /// Numbers the job and hands it to the worker threads. Jobs that are not handed to the worker threads go straight
+   /// to the reorder buffer, so that they are passed on in order as well.
+   job->fNumber = fJobsDispatched++;
+   if(!toWorkers) {
+      fReorderBuffer[job->fNumber] = std::move(job);
+      return;
+   }
+   fJobQueue->Push(std::move(job));
+}
+
+template <class Job>
+void TOrderedWorkerPool<Job>::Collect(bool wait, const std::function<void(Job&)>& output)
+{
+   /// Moves the jobs the worker threads are done with to the reorder buffer and calls output for all jobs that are next
+   /// in line. If wait is true, we wait up to 10 ms for a job to be finished.
+   std::shared_ptr<Job> job;
+   while(fDoneQueue->Pop(job, wait ? 10 : 0) >= 0) {
+      fReorderBuffer[job->fNumber] = std::move(job);
+      wait                         = false;
+   }
+
+   for(auto it = fReorderBuffer.begin(); it != fReorderBuffer.end() && it->first == fJobsCollected;
+       it      = fReorderBuffer.erase(it)) {
+      output(*(it->second));
+      ++fJobsCollected;
+   }
+}
+
+template <class Job>
+bool TOrderedWorkerPool<Job>::NextJob(std::shared_ptr<Job>& job)
+{
+   /// Called by the worker threads, waits for the next job and returns false once the pool is stopped.
+   while(fJobQueue->Pop(job, 100) < 0) {
+      if(fJobQueue->IsFinished()) {
+         return false;
+      }
+   }
+   return true;
+}
+#endif
+
+/*! @} */
+#endif
@@ -22,11 +22,26 @@
 /// The TPPG is designed to hold all of the information about the
 /// PPG status.
 ///
+/// Lookups (GetStatus, GetLastStatusTime) go through a flat, sorted copy
+/// of the map that is built on first use. Each thread remembers the last
+/// PPG word it found, so lookups with increasing times (hits of the same
+/// event, or time-ordered data) don't need a binary search.
+///
+/// While sorting, AddData appends new words to this copy in place, so
+/// lookups from other threads can continue at the same time. Readers keep
+/// a reference to the copy they use, so replacing it (when it is full, or
+/// a word arrives out of order) doesn't free it under them.
+///
 //////////////////////////////////////////////////////////////////////////
 
 #include <map>
 #include <utility>
 #include <iostream>
+#ifndef __CINT__
+#include <atomic>
+#include <memory>
+#include <mutex>
+#endif
 
 #include "TFile.h"
 #include "TObject.h"
@@ -115,6 +130,8 @@ private:
    /// \endcond
 };
 
+class TPPGTimeline;
+
 class TPPG : public TObject {
 public:
    typedef std::map<ULong_t, TPPGData*> PPGMap_t;
@@ -175,6 +192,15 @@ private:
    PPGMap_t::iterator MapEnd() const { return fPPGStatusMap->end(); }
    PPGMap_t::iterator fCurrIterator; //!<!
 
+   void InvalidateTimeline();
+#ifndef __CINT__
+   std::shared_ptr<const TPPGTimeline> Timeline() const;
+
+   /// flat copy of fPPGStatusMap used by GetStatus and GetLastStatusTime, only accessed with std::atomic_load/store
+   mutable std::shared_ptr<TPPGTimeline> fTimeline; //!<!
+   mutable std::mutex                    fTimelineMutex; //!<! serialises AddData and building the timeline
+#endif
+
    PPGMap_t* fPPGStatusMap;
    ULong64_t fCycleLength;
    std::map<ULong64_t, int> fNumberOfCycleLengths;
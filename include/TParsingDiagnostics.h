@@ -13,6 +13,11 @@
 /// a midas file to a fragment tree and analysis tree and provides convenient
 /// methods of printing and/or visualizing them.
 ///
+/// The per-channel counters of GoodFragment (called for every fragment) are
+/// kept in a dense slot per channel address and the per detector type ones
+/// in an array. They are folded into the maps before these are used, i.e.
+/// by Print, Draw, Write, WriteToFile, Add, Copy, and the getters.
+///
 ////////////////////////////////////////////////////////////////////////////////
 
 #include <iostream>
@@ -20,6 +25,7 @@
 #include <string>
 #include <vector>
 #include <map>
+#include <unordered_map>
 
 #ifndef __CINT__
 #include <memory>
@@ -76,6 +82,28 @@ private:
 
    static TParsingDiagnostics* fParsingDiagnostics;
 
+   /// counters of one channel address, see GoodFragment
+   struct TChannelCounters {
+      UInt_t fAddress;
+      UInt_t fMinChannelId;
+      UInt_t fMaxChannelId;
+      Long_t fNumberOfHits;
+      long   fDeadTime;
+      long   fMinTimeStamp;
+      long   fMaxTimeStamp;
+   };
+
+   static const UInt_t  kDirectAddresses  = 0x10000; ///< addresses below this have their slot looked up directly
+   static const Short_t kMaxDetectorTypes = 256;     ///< detector types with a dense counter of good fragments
+
+   std::vector<TChannelCounters>     fChannelCounters;    //!< counters not folded into the maps yet
+   std::vector<Int_t>                fDirectSlots;        //!< slot in fChannelCounters (or -1) of addresses below kDirectAddresses
+   std::unordered_map<UInt_t, Int_t> fSlots;              //!< slot in fChannelCounters of all other addresses
+   std::vector<Long_t>               fGoodFragmentCounts; //!< good fragments per detector type not folded into the map yet
+
+   TChannelCounters& Counters(UInt_t address);
+   void              FoldCounters() const;
+
 public:
 //"setter" functions
 #ifndef __CINT__
@@ -86,9 +114,12 @@ public:
 
    void ReadPPG(TPPG*);
 
+   void Add(const TParsingDiagnostics&);
+
    // getter functions
    Long_t NumberOfGoodFragments(Short_t detType)
    {
+      FoldCounters();
       if(fNumberOfGoodFragments.find(detType) != fNumberOfGoodFragments.end()) {
          return fNumberOfGoodFragments[detType];
       }
@@ -106,6 +137,8 @@ public:
 
    // other functions
    void WriteToFile(const char*) const;
+   using TObject::Write;
+   Int_t Write(const char* name = nullptr, Int_t option = 0, Int_t bufsize = 0) const override;
 
    void Copy(TObject&) const override;
    void Clear(Option_t* opt = "all") override;
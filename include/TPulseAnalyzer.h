@@ -9,6 +9,9 @@
 #include "TGRSIFunctions.h"
 
 #include <vector>
+#ifndef __CINT__
+#include <atomic>
+#endif
 #include <cstdlib>
 #include <cstdio>
 #include <cstring>
@@ -31,7 +34,7 @@
 ////////////////////////////////////////////////////////////////////////////////
 
 class TPulseAnalyzer {
-private:
+protected:
    struct WaveFormPar {
       // parameters for baseline
       int    baseline_range;
@@ -95,6 +98,13 @@ private:
       double ndf;
    };
 
+   /// sums over the samples 0 to k-1, used to get the normal equations of a fit over any window as a difference
+   struct WindowSums {
+      long double x[5]; // sums of i^0 to i^4
+      long double y[3]; // sums of y_i*i^0 to y_i*i^2
+      long double y2;   // sum of y_i^2
+   };
+
    struct SinPar {
       double A;
       double t0;
@@ -150,7 +160,9 @@ public:
    void       print_WavePar();
    TH1I*      GetWaveHist();
    TGraph*    GetWaveGraph();
-   static int nameiter;
+#ifndef __CINT__
+   static std::atomic<int> nameiter; ///< numbers the names of histograms and functions (fits run in several threads)
+#endif
    void       DrawWave();
    void       DrawT0fit();
    void       DrawRFFit();
@@ -162,12 +174,30 @@ public:
    void   DrawCsIFit();
    int    GetCsIChiSq();
 
+protected:
+   // the linear equation solver and the line and parabola fits can be replaced by derived classes, e.g. to compare
+   // them with other implementations (see util/PulseAnalyzerBenchmark.cxx)
+   virtual int solve_lin_eq();
+   virtual int fit_parabola(int, int, ParPar*);
+   virtual int fit_smooth_parabola(int, int, double, ParPar*);
+   virtual int fit_line(int, int, LinePar*);
+
+   std::vector<Short_t> cWavebuffer;
+
+   // linear equation dataholders
+   int         lineq_dim;
+   long double lineq_matrix[20][20];
+   long double lineq_vector[20];
+   long double lineq_solution[20];
+   long double copy_matrix[20][20];
+
+   const static int BADCHISQ_MAT = -1024 - 5; // matrix for fit is not invertable
+
 private:
    bool         set;
    WaveFormPar* cWpar;
    int          cN;
    // TFragment* frag;
-   std::vector<Short_t> cWavebuffer;
    SinPar*              spar;
    ShapePar*            shpar;
 
@@ -178,12 +208,9 @@ private:
    int    T0RANGE; // tick range over which baseline is calulated
    double LARGECHISQ;
 
-   // linear equation dataholders
-   int         lineq_dim;
-   long double lineq_matrix[20][20];
-   long double lineq_vector[20];
-   long double lineq_solution[20];
-   long double copy_matrix[20][20];
+   // prefix sums of the waveform for the line and parabola fits
+   std::vector<WindowSums> cWindowSums;    //!
+   bool                    cWindowSumsSet; //!
 
    // CsI functions
    void   GetCsIExclusionZone();
@@ -198,12 +225,11 @@ private:
    bool             CsIIsSet() { return CsISet; }
 
    // internal methods
-   int         solve_lin_eq();
-   long double determinant(int);
+   int  solve_cholesky();
+   int  solve_pivot();
+   void set_window_sums();
+   void get_window_sums(int, int, WindowSums&, int = 0);
 
-   int    fit_parabola(int, int, ParPar*);
-   int    fit_smooth_parabola(int, int, double, ParPar*);
-   int    fit_line(int, int, LinePar*);
    double get_linear_T0();
    double get_parabolic_T0();
    double get_smooth_T0();
@@ -226,7 +252,6 @@ private:
    const static int BADCHISQ_SMOOTH_T0 = -1024 - 2; // smooth_t0 gives bad result
    const static int BADCHISQ_PAR_T0    = -1024 - 3; // parabolic_t0 gives bad result
    const static int BADCHISQ_LIN_T0    = -1024 - 4; // linear_t0 gives bad result
-   const static int BADCHISQ_MAT       = -1024 - 5; // matrix for fit is not invertable
    const static int BADCHISQ_EXC       = -1024 - 8; // -1032	bad exclusion zone
    // new definitions for Kris' changes to the waveform analyzer
    const static int PIN_BASELINE_RANGE = 16; // minimum ticks before max for a valid signal
@@ -0,0 +1,80 @@
+#ifndef TREADAHEADBUFFER_H
+#define TREADAHEADBUFFER_H
+
+/** \addtogroup Sorting
+ *  @{
+ */
+
+/////////////////////////////////////////////////////////////////
+///
+/// \class TReadAheadBuffer
+///
+/// Reads a data stream (e.g. the output of a decompressing pipe
+/// or gzread) in large blocks in a background thread, so that
+/// reading and decompressing the data overlaps with framing the
+/// events. The read function is only ever called from the
+/// background thread; it should return the number of bytes read,
+/// 0 if there is no more data (for now), or a negative number on
+/// error. A negative number with errno set to EAGAIN or EINTR means
+/// that no data was available yet, the read is simply repeated.
+///
+/// A block is handed over as soon as a read returns less than was
+/// asked for, so data isn't held back waiting for a full block.
+/// Reaching the end of the data is reported to the caller of Read
+/// once, the next call of Read tries to read again, so files that
+/// are still being written can be followed. The destructor waits
+/// for the read in progress, so the read function mustn't block
+/// indefinitely (e.g. poll pipes with a timeout and return EAGAIN).
+///
+/////////////////////////////////////////////////////////////////
+
+#ifndef __CINT__
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+#endif
+
+class TReadAheadBuffer {
+public:
+#ifndef __CINT__
+   TReadAheadBuffer(std::function<long(char*, size_t)> readFunction, size_t blockSize = 8 * 1024 * 1024,
+                    size_t nofBlocks = 2);
+#endif
+   ~TReadAheadBuffer();
+
+   TReadAheadBuffer(const TReadAheadBuffer&) = delete;
+   TReadAheadBuffer& operator=(const TReadAheadBuffer&) = delete;
+
+   size_t Read(char* buffer, size_t bytes); ///< copies up to bytes into buffer, waits until enough data was read ahead
+   int    LastErrno() const { return fErrno; }
+
+private:
+   void ReadBlocks();
+
+#ifndef __CINT__
+   std::function<long(char*, size_t)> fReadFunction;
+   size_t                             fBlockSize; ///< size of the blocks read in one go
+   size_t                             fNofBlocks; ///< maximum number of blocks read ahead
+
+   std::deque<std::vector<char>>  fFilledBlocks;  ///< blocks that have been read but not used yet
+   std::vector<std::vector<char>> fEmptyBlocks;   ///< used blocks that can be filled again
+   std::vector<char>              fCurrentBlock;  ///< block we are currently copying from
+   size_t                         fBlockPosition; ///< position in the current block
+
+   bool              fFinished; ///< reading failed, nothing more will be read
+   bool              fAtEnd;    ///< a read returned 0, the next call of Read makes the background thread try again
+   std::atomic<bool> fStop;     ///< tells the background thread to stop (checked between reads)
+   int               fErrno;    ///< errno of the failed read
+
+   std::mutex              fMutex;
+   std::condition_variable fCanRead; ///< signals that a block has been filled
+   std::condition_variable fCanFill; ///< signals that a block has been used up
+   std::thread             fThread;
+#endif
+};
+/*! @} */
+#endif
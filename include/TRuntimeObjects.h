@@ -3,8 +3,11 @@
 
 #include <string>
 #include <map>
+#include <vector>
 #ifndef __CINT__
 #include <memory>
+#include <mutex>
+#include <unordered_map>
 #include <utility>
 #endif
 
@@ -24,6 +27,16 @@ class TProfile;
 /**
    For each event, an instance of this type will be passed to the custom histogrammer.
    This class contains all detectors present, and all existing cuts and histograms.
+
+   Histograms are looked up by name in a hash table, so FillHistogram(name, ...) does not have to search the list of
+   objects. Histograms that are filled very often can instead be registered once, and then be filled via the returned
+   handle, e.g.
+   \code
+   static int handle = obj.GetHistogramHandle("energy", 8000, 0, 8000);
+   obj.Fill1D(handle, hit->GetEnergy());
+   \endcode
+   Handles are shared between all TRuntimeObjects, i.e. a handle refers to the histogram of the same name in each of
+   them.
  */
 class TRuntimeObjects : public TNamed {
 public:
@@ -112,6 +125,25 @@ public:
       return FillHistogramSym(dirname.c_str(), name.c_str(), Xbins, Xlow, Xhigh, Xvalue, Ybins, Ylow, Yhigh, Yvalue);
    }
 
+   //---------------------------------------------------------------------
+   int GetHistogramHandle(const char* name, int bins, double low, double high);
+   int GetHistogramHandle(const char* name, int Xbins, double Xlow, double Xhigh, int Ybins, double Ylow, double Yhigh);
+   int GetProfileHistHandle(const char* name, int Xbins, double Xlow, double Xhigh);
+   int GetHistogramSymHandle(const char* name, int Xbins, double Xlow, double Xhigh, int Ybins, double Ylow,
+                             double Yhigh);
+   int GetHistogramHandle(const char* dirname, const char* name, int bins, double low, double high);
+   int GetHistogramHandle(const char* dirname, const char* name, int Xbins, double Xlow, double Xhigh, int Ybins,
+                          double Ylow, double Yhigh);
+   int GetProfileHistHandle(const char* dirname, const char* name, int Xbins, double Xlow, double Xhigh);
+   int GetHistogramSymHandle(const char* dirname, const char* name, int Xbins, double Xlow, double Xhigh, int Ybins,
+                             double Ylow, double Yhigh);
+
+   void Fill1D(int handle, double value, double weight = 1);                  ///< fills 1D histogram of handle
+   void Fill2D(int handle, double Xvalue, double Yvalue, double weight = 1); ///< fills 2D, symmetric, or profile histogram
+   TH1* GetHistogram(int handle);
+
+   void ClearIndex(); ///< has to be called if objects are removed from GetObjects() by hand
+
    double GetVariable(const char* name);
 
    static TRuntimeObjects* Get(const std::string& name = "default")
@@ -131,8 +163,39 @@ public:
    TDirectory*                   GetDirectory() const { return fDirectory; }
 
 private:
+   enum class EHistogramType { k1D, k2D, kSym, kProfile };
+   /// everything needed to create the histogram of a handle
+   struct THistogramSpec {
+      std::string    fDirname;
+      std::string    fName;
+      EHistogramType fType;
+      int            fXbins;
+      double         fXlow;
+      double         fXhigh;
+      int            fYbins;
+      double         fYlow;
+      double         fYhigh;
+   };
+
+   TObject*    FindIndexedObject(const char* name);
+   TDirectory* FindIndexedDirectory(const char* dirname);
+   TObject*    FindIndexedObject(TDirectory* dir, const char* dirname, const char* name);
+   void AddIndexedObject(TObject* obj);
+   void AddIndexedObject(TDirectory* dir, const char* dirname, TObject* obj);
+
+   int RegisterHandle(const THistogramSpec& spec);
+   TH1* ResolveHandle(int handle);
+
    static std::map<std::string, TRuntimeObjects*> fRuntimeMap;
 #ifndef __CINT__
+   static std::vector<THistogramSpec>          fHandleSpecs;
+   static std::unordered_map<std::string, int> fHandleIndex; ///< handles by name, or dirname and name
+   static std::mutex                           fHandleMutex;
+
+   std::unordered_map<std::string, TObject*>    fObjectIndex;   ///< objects in fObjects by name, or dirname and name
+   std::vector<std::pair<TH1*, EHistogramType>> fHandleObjects; ///< histograms of this instance by handle
+   std::string                                  fKey;           ///< re-used to build keys without re-allocating
+
    std::shared_ptr<TUnpackedEvent>  fDetectors;
    std::shared_ptr<const TFragment> fFrag;
 #endif
@@ -45,10 +45,25 @@ private:
 
    std::map<std::pair<double, double>, double> AdjustedEnergyMap;
 
+   std::string fFileName; // full path of the energy loss file that was read in
+
+   // energy after a thickness, for nEnergy x nThickness points from 0 to fTableEmax keV and 0 to fTableXmax um
+   std::vector<double> fEnergyTable;
+   double              fTableEmax{0.};
+   double              fTableXmax{0.};
+   double              fTableStepSize{0.}; // step size used by GetAdjustedEnergy to calculate the table
+   int                 fTableNEnergy{0};
+   int                 fTableNThickness{0};
+
+   double GetSteppedEnergy(double energy, double thickness, double stepsize);
+   std::string TableFileName(const char* filename) const;
+   std::string SourceSignature() const;
+
 public:
    void ReadEnergyLossFile(const char* filename, double emax = -1.0, double emin = 0.0, bool printfile = true);
 
    double GetAdjustedEnergy(double energy, double thickness, double stepsize = dx);
+   double GetTableEnergy(double energy, double thickness) const;
    double GetEnergyLost(double energy, double distance, double stepsize = dx)
    {
       return energy - GetAdjustedEnergy(energy, distance, stepsize);
@@ -57,6 +72,14 @@ public:
    double GetEnergy(double energy, double dist);
    double GetEnergyChange(double energy, double dist) { return GetEnergy(energy, dist) - energy; };
 
+   // table of GetAdjustedEnergy, used by it for energies and thicknesses within the table
+   void   MakeEnergyTable(double emax, double xmax, int nEnergy = 500, int nThickness = 200, double stepsize = dx);
+   bool   WriteEnergyTable(const char* filename = nullptr) const;
+   bool   ReadEnergyTable(const char* filename = nullptr, bool printfile = true);
+   double CheckEnergyTable(int nEnergy = 100, int nThickness = 100, bool print = true);
+   bool   HasEnergyTable() const { return !fEnergyTable.empty(); }
+   void   ClearEnergyTable();
+
    double GetEmax() { return Emax; };
    double GetEmin() { return Emin; };
    double GetXmax() { return Xmax; };
@@ -25,11 +25,13 @@
 
 #include <iostream>
 #include <map>
+#include <vector>
 
 #include "TObject.h"
 #include "Globals.h"
 #include "TCollection.h"
 #include "TTree.h"
+#include "TFile.h"
 #include "TH1D.h"
 
 #include "TPPG.h"
@@ -95,6 +97,58 @@ private:
    /// \endcond
 };
 
+//////////////////////////////////////////////////////////////////////////
+///
+/// \class TScalerIndex
+///
+/// Column-wise copy of the scaler tree, sorted by address and time.
+/// The timestamps (and scaler values) of each address are contiguous,
+/// so the readout for a time can be found with an interpolation search
+/// instead of looping over the tree. The index can be written to the
+/// file with the scaler tree (TScaler::WriteIndex), in which case
+/// TScaler reads it instead of building it again.
+///
+//////////////////////////////////////////////////////////////////////////
+
+class TScalerIndex : public TObject {
+public:
+   TScalerIndex() = default;
+   ~TScalerIndex() override = default;
+
+   void Clear(Option_t* opt = "") override;
+   void Print(Option_t* opt = "") const override;
+
+   void Add(const TScalerData* data);
+   void Finalize(Long64_t treeEntries);
+
+   bool     Empty() const { return fTimeStamps.empty(); }
+   Long64_t GetTreeEntries() const { return fTreeEntries; }
+
+   bool   Range(UInt_t address, size_t& begin, size_t& end) const;
+   size_t LowerBound(size_t begin, size_t end, ULong64_t time) const;
+
+   ULong64_t GetTimeStamp(size_t row) const { return fTimeStamps[row]; }
+   UInt_t GetScaler(size_t row, size_t index) const { return index < fWidth ? fScalers[row * fWidth + index] : 0; }
+   std::vector<UInt_t> GetScaler(size_t row) const;
+
+private:
+   std::vector<UInt_t>    fAddresses;      ///< sorted addresses
+   std::vector<ULong64_t> fFirstRow;       ///< first row of each address, plus the end of the last address
+   std::vector<ULong64_t> fTimeStamps;     ///< timestamp of each row, sorted by address and time
+   std::vector<UInt_t>    fScalers;        ///< fWidth scaler values per row
+   UInt_t                 fWidth{0};       ///< number of scaler values per row (maximum of all readouts)
+   Long64_t               fTreeEntries{0}; ///< number of entries of the tree this index was built from
+
+   std::vector<UInt_t>    fUnsortedAddresses;  //!<! readouts added, but not sorted yet
+   std::vector<ULong64_t> fUnsortedTimeStamps; //!<!
+   std::vector<ULong64_t> fUnsortedOffsets;    //!<! offset of the scaler values of each readout in fUnsortedScalers
+   std::vector<UInt_t>    fUnsortedScalers;    //!<!
+
+   /// \cond CLASSIMP
+   ClassDefOverride(TScalerIndex, 1) // Sorted index of scaler readouts
+   /// \endcond
+};
+
 class TScaler : public TObject {
 public:
    TScaler(bool loadIntoMap = false);
@@ -123,12 +177,16 @@ public:
 
    void ListHistograms();
 
+   bool WriteIndex(TFile* file = nullptr);
+
 private:
+   void BuildIndex() const;
+   bool ReadIndex();
+
    TTree*       fTree;
    TScalerData* fScalerData;
    Long64_t     fEntries;
-   std::map<UInt_t, std::map<ULong64_t, std::vector<UInt_t>>>
-      fScalerMap; //!<! an address-map of timestamp mapped scaler values
+   mutable TScalerIndex fIndex; //!<! scaler values sorted by address and time, built on first use
    std::map<UInt_t, ULong64_t>
       fTimePeriod; //!<! a map between addresses and time differences (used to calculate the time period)
    std::map<UInt_t, std::map<ULong64_t, int>> fNumberOfTimePeriods; //!<!
@@ -60,6 +60,7 @@ public:
    void SetTimeFit(double t0) { fTimeFit = t0; }
 
    void             SetWavefit(const TFragment&);
+   void             SetWavefit(TPulseAnalyzer&);
    static TChannel* GetSiLiHitChannel(int segment);
    static TPulseAnalyzer* FitFrag(const TFragment& frag, int ShapeFit, int segment);
    static TPulseAnalyzer* FitFrag(const TFragment& frag, int ShapeFit = 0, TChannel* = nullptr);
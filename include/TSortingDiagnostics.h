@@ -43,20 +43,36 @@ public:
 private:
    // analysis tree diagnostics (should these all be static?)
    std::map<long, std::pair<long, long>> fFragmentsOutOfOrder;
-   std::vector<Long_t> fPreviousTimeStamps; ///< timestamps of previous fragments, saved every 'BuildWindow' entries
+   std::vector<Long_t> fPreviousTimeStamps;       ///< running maximum of timestamps, saved every 'BuildWindow' entries
    long                fMaxEntryDiff{0};
+   Long_t              fSortDepth{0};             ///< sort depth used (the largest one chosen if it was adaptive)
+   bool                fAdaptiveSortDepth{false}; ///< was the sort depth adapted to the disorder of the fragments?
 
    static TSortingDiagnostics* fSortingDiagnostics;
 
 public:
    //"setter" functions
    void OutOfOrder(long newFragTS, long oldFragTS, long newEntry);
-   void AddTimeStamp(Long_t val) { fPreviousTimeStamps.push_back(val); }
+   void AddTimeStamp(Long_t val)
+   {
+      /// saves the running maximum of the timestamps so that they stay sorted for the binary search in OutOfOrder
+      if(!fPreviousTimeStamps.empty() && val < fPreviousTimeStamps.back()) {
+         val = fPreviousTimeStamps.back();
+      }
+      fPreviousTimeStamps.push_back(val);
+   }
+   void SetSortDepth(Long_t depth, bool adaptive)
+   {
+      fSortDepth         = depth;
+      fAdaptiveSortDepth = adaptive;
+   }
 
    // getter functions
    size_t NumberOfFragmentsOutOfOrder() const { return fFragmentsOutOfOrder.size(); }
    std::map<long, std::pair<long, long>> FragmentsOutOfOrder() { return fFragmentsOutOfOrder; }
-   long MaxEntryDiff() const { return fMaxEntryDiff; }
+   long   MaxEntryDiff() const { return fMaxEntryDiff; }
+   Long_t SortDepth() const { return fSortDepth; }
+   bool   AdaptiveSortDepth() const { return fAdaptiveSortDepth; }
 
    // other functions
    void WriteToFile(const char*) const;
@@ -67,7 +83,7 @@ public:
    void Draw(Option_t* opt = "") override;
 
    /// \cond CLASSIMP
-   ClassDefOverride(TSortingDiagnostics, 1);
+   ClassDefOverride(TSortingDiagnostics, 2);
    /// \endcond
 };
 /*! @} */
@@ -40,6 +40,7 @@ public:
 
 #ifndef __CINT__
    void AddFragment(const std::shared_ptr<const TFragment>&, TChannel*) override; //!<!
+   void AddWaveformFits(TWaveformFitter& fitter) override;                        //!<!
 #endif
    void Copy(TObject& rhs) const override;
 
@@ -78,8 +78,10 @@ public:
    }
 
    void SetWavefit(const TFragment&);
+   void SetWavefit(TPulseAnalyzer&);
 
    void SetPID(const TFragment&);
+   void SetPID(TPulseAnalyzer&);
 
 public:
    void Clear(Option_t* opt = "") override;       //!<!
@@ -29,6 +29,7 @@ public:
    void ClearRawData();
 
    void Build();
+   void AddWaveformFits(TWaveformFitter& fitter);
 
    int Size() { return fDetectors.size(); }
 
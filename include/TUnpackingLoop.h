@@ -11,11 +11,21 @@
 ///
 /// This loop parses Midas events into fragments.
 ///
+/// With --unpacking-threads N (N > 1) midas data events are handed to N
+/// unpacking threads, each with its own TDataParser in deferred mode. The
+/// output of each event is passed on in the order the events were read, and
+/// fragment ids and entry numbers are only assigned at that point, so the
+/// output doesn't depend on the number of threads. Piled-up GRF4 hits are
+/// solved by the fragment map of this loop's parser when the output is
+/// passed on, and all other events are processed by this loop in order.
+///
 ////////////////////////////////////////////////////////////////////////////////
 
 #ifndef __CINT__
 #include <memory>
+#include <vector>
 #include "ThreadsafeQueue.h"
+#include "TOrderedWorkerPool.h"
 #endif
 
 #include "StoppableThread.h"
@@ -23,6 +33,7 @@
 #include "TFragment.h"
 #include "TEpicsFrag.h"
 #include "TDataParser.h"
+#include "TParsingDiagnostics.h"
 
 class TUnpackingLoop : public StoppableThread {
 public:
@@ -31,8 +42,16 @@ public:
    static TUnpackingLoop* Get(std::string name = "");
    ~TUnpackingLoop() override;
 
-   void SetNoWaveForms(bool temp = true) { fParser.SetNoWaveForms(temp); }
-   void SetRecordDiag(bool temp = true) { fParser.SetRecordDiag(temp); }
+   void SetNoWaveForms(bool temp = true)
+   {
+      fNoWaveforms = temp;
+      fParser.SetNoWaveForms(temp);
+   }
+   void SetRecordDiag(bool temp = true)
+   {
+      fRecordDiag = temp;
+      fParser.SetRecordDiag(temp);
+   }
 
 #ifndef __CINT__
    std::shared_ptr<ThreadsafeQueue<std::shared_ptr<TRawEvent>>>&       InputQueue() { return fInputQueue; }
@@ -63,6 +82,22 @@ public:
 
 private:
 #ifndef __CINT__
+   /// a midas event handed to one of the unpacking threads, and the output of the unpacking
+   struct TUnpackingJob {
+      size_t                      fNumber;    ///< position of the event in the input queue
+      std::shared_ptr<TRawEvent>  fEvent;     ///< reset once unpacked, events not handed to the threads keep it
+      TDataParser::DeferredOutput fOutput;
+      long                        fFragsRead;
+      long                        fGoodFrags;
+   };
+
+   void StartWorkers();
+   void StopWorkers();
+   void Dispatch(const std::shared_ptr<TRawEvent>& event);
+   void CollectJobs(bool wait);
+   void PassOn(TUnpackingJob& job);
+   void UnpackingThread(size_t index);
+
    std::shared_ptr<ThreadsafeQueue<std::shared_ptr<TRawEvent>>> fInputQueue;
 #endif
 
@@ -73,6 +108,15 @@ private:
    bool   fEvaluateDataType;
    EDataType fDataType;
 
+   bool fNoWaveforms;
+   bool fRecordDiag;
+
+#ifndef __CINT__
+   std::vector<std::unique_ptr<TDataParser>>         fWorkerParsers;     ///< one parser per unpacking thread
+   std::vector<std::unique_ptr<TParsingDiagnostics>> fWorkerDiagnostics; ///< diagnostics of each unpacking thread
+   TOrderedWorkerPool<TUnpackingJob>                 fWorkerPool;        ///< unpacking threads (if more than one)
+#endif
+
    TUnpackingLoop(std::string name);
    TUnpackingLoop(const TUnpackingLoop& other);
    TUnpackingLoop& operator=(const TUnpackingLoop& other);
@@ -0,0 +1,72 @@
+#ifndef TWAVEFORMFITTER_H
+#define TWAVEFORMFITTER_H
+
+/** \addtogroup Fitting Fitting & Analysis
+ *  @{
+ */
+
+////////////////////////////////////////////////////////////////////////////////
+///
+/// \class TWaveformFitter
+///
+/// Fits the waveforms of a block of events with a pool of threads.
+///
+/// With --waveform-fitting-threads N (N > 0) the detector building loop
+/// owns a TWaveformFitter. Detectors that fit waveforms (TTip, TSiLi) then
+/// don't fit them while the hits are built (see DeferFits), instead the
+/// loop collects the fits of a block of events (TDetector::AddWaveformFits),
+/// fits them with N threads (its own and N - 1 fitting threads), and the
+/// results are written back to the hits before the events are passed on.
+/// Each thread re-uses its own TPulseAnalyzer for all of its fits.
+///
+/// Without this option (the default) each hit is fitted when it is built.
+///
+////////////////////////////////////////////////////////////////////////////////
+
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "Rtypes.h"
+
+class TPulseAnalyzer;
+
+class TWaveformFitter {
+public:
+   explicit TWaveformFitter(int nofThreads); ///< nofThreads fitting threads in addition to the one calling Fit
+   ~TWaveformFitter();
+
+   static bool DeferFits(); ///< true if hits should leave their waveform fits to a TWaveformFitter
+
+   /// adds a fit of waveform, fit is called with a TPulseAnalyzer set up for waveform (if it's not empty)
+   void AddFit(const std::vector<Short_t>* waveform, std::function<void(TPulseAnalyzer&)> fit,
+               double noiseFactor = 0.);
+   void   Fit(); ///< fits all added waveforms, returns when all fits are done
+   size_t Size() const { return fJobs.size(); }
+
+private:
+   struct TFitJob {
+      const std::vector<Short_t>*          fWaveform;
+      std::function<void(TPulseAnalyzer&)> fFit;
+      double                               fNoiseFactor;
+   };
+
+   void FittingThread();
+   void FitJobs(TPulseAnalyzer& analyzer);
+
+   std::vector<TFitJob>     fJobs;
+   std::atomic<size_t>      fNextJob;    ///< index of the next job to be fitted
+   std::vector<std::thread> fWorkers;
+   TPulseAnalyzer*          fAnalyzer;   ///< the analyzer of the thread calling Fit
+   std::mutex               fMutex;
+   std::condition_variable  fStart;      ///< signals the fitting threads that a new block is ready (or to stop)
+   std::condition_variable  fDone;       ///< signals Fit that all fitting threads are done with the block
+   size_t                   fGeneration; ///< number of blocks handed to the fitting threads
+   size_t                   fBusy;       ///< fitting threads still working on the current block
+   bool                     fStop;
+};
+/*! @} */
+#endif
@@ -0,0 +1,76 @@
+#ifndef TWAVEFORMKERNELS_H
+#define TWAVEFORMKERNELS_H
+
+/** \addtogroup Sorting
+ *  @{
+ */
+
+////////////////////////////////////////////////////////////////////////////////
+///
+/// \class TWaveformKernels
+///
+/// Waveform processing shared by the detector hits (TDescantHit, TSceptarHit,
+/// TZeroDegreeHit) and TPulseAnalyzer: baseline correction and estimation,
+/// running-sum smoothing, CFD, partial sums, and PSD.
+///
+/// All kernels work on plain arrays of samples and write into buffers
+/// provided by the caller, so they don't allocate. TWorkspace holds the
+/// buffers needed in between, each thread has one (ThreadWorkspace) that
+/// only grows, so processing the waveforms of an event allocates nothing
+/// once the buffers are large enough. The kernels give the same results as
+/// the per-hit code they replace.
+///
+////////////////////////////////////////////////////////////////////////////////
+
+#include <cstddef>
+#include <vector>
+
+#include "Rtypes.h"
+
+class TWaveformKernels {
+public:
+   /// scratch buffers used in between the kernels
+   class TWorkspace {
+   public:
+      Short_t* Smoothed(size_t n) { return Reserve(fSmoothed, n); }
+      Short_t* Monitor(size_t n) { return Reserve(fMonitor, n); }
+      Int_t*   Sums(size_t n) { return Reserve(fSums, n); }
+
+   private:
+      template <typename T>
+      static T* Reserve(std::vector<T>& buffer, size_t n)
+      {
+         if(buffer.size() < n) {
+            buffer.resize(n);
+         }
+         return buffer.data();
+      }
+
+      std::vector<Short_t> fSmoothed;
+      std::vector<Short_t> fMonitor;
+      std::vector<Int_t>   fSums;
+   };
+
+   static TWorkspace& ThreadWorkspace(); ///< the workspace of the calling thread
+
+   // baseline
+   static void CorrectBaseline(Short_t* wave, size_t n, size_t nofAdcs = 8);
+   static void Moments(const Short_t* wave, size_t n, Long64_t& sum, Long64_t& sumOfSquares);
+
+   // smoothing
+   static void RunningSum(const Short_t* wave, size_t n, size_t window, Int_t* sums);
+   static size_t Smooth(const Short_t* wave, size_t n, unsigned int halfWindow, Short_t* smoothed);
+
+   // timing
+   static size_t CfdMonitor(const Short_t* wave, size_t n, double attenuation, unsigned int delay, Short_t* monitor);
+   static Int_t  CfdZeroCrossing(const Short_t* monitor, size_t n, unsigned int interpolationSteps);
+   static Int_t  Cfd(const Short_t* wave, size_t n, double attenuation, unsigned int delay, unsigned int halfWindow,
+                     unsigned int interpolationSteps, TWorkspace& workspace, size_t* monitorSize = nullptr);
+
+   // integration
+   static void  PartialSum(const Short_t* wave, size_t n, Int_t* sums);
+   static Int_t Psd(const Short_t* wave, const Int_t* partialSums, size_t n, double fraction,
+                    unsigned int interpolationSteps);
+};
+/*! @} */
+#endif
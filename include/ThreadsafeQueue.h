@@ -6,57 +6,89 @@
 /// \class ThreadsafeQueue
 /// Template for all queues used to send data from one thread/loop to the next.
 ///
+/// By default the queue is a std::queue protected by a mutex. Alternatively a
+/// bounded lock-free ring buffer can be selected when the queue is created:
+/// EQueueType::kSPSC for 1:1 links between two loops (single producer, single
+/// consumer), or EQueueType::kMPMC for queues shared by several producers
+/// and/or consumers. The ring buffers allocate their full size up-front, so
+/// their size is limited to kMaxRingSize slots (the maximum size given to the
+/// queue is only a soft limit for the mutex queue). Pushing to a full ring
+/// buffer backs off (spin, yield, then sleep) until there is space, or until
+/// the queue is set to finished, in which case the item is dropped.
+///
+/// PushBatch/PopBatch move a whole vector of items through the queue at once,
+/// taking the lock and notifying the other side only once per batch.
+///
 ////////////////////////////////////////////////////////////////////////////////
 
 #include <cassert>
 #include <iostream>
 
 #ifndef __CINT__
+#include <algorithm>
 #include <atomic>
 #include <memory>
 #include <chrono>
 #include <condition_variable>
 #include <mutex>
 #include <queue>
+#include <thread>
 #include <utility>
+#include <vector>
+
+#include "RingBuffer.h"
 #endif
 
 class TDetector;
 
+enum class EQueueType { kMutex, kSPSC, kMPMC };
+
 template <typename T>
 class ThreadsafeQueue {
 public:
-   ThreadsafeQueue(std::string name = "default", size_t maxSize = 50000);
+   ThreadsafeQueue(std::string name = "default", size_t maxSize = 50000, EQueueType type = EQueueType::kMutex);
    ~ThreadsafeQueue();
 #ifndef __CINT__
    int Push(T obj);
    long Pop(T& output, int millisecond_wait = 1000);
+   int PushBatch(std::vector<T>& objs);
+   long PopBatch(std::vector<T>& output, size_t maxItems, int millisecond_wait = 1000);
 
    size_t ItemsPushed() const;
    size_t ItemsPopped() const;
    size_t Size() const;
 
    std::string Name() { return fName; }
+   EQueueType  Type() const { return fType; }
 
    // int ObjectSize(T&) const;
 
    bool IsFinished() const;
    void SetFinished(bool finished = true);
 
+   enum : size_t { kMaxRingSize = 1 << 16 }; ///< maximum number of slots of the lock-free ring buffers
+
 private:
+   static void Backoff(int& spins);
+   bool        RingPush(T& obj);
+
    std::string             fName;
+   EQueueType              fType;
    mutable std::mutex      mutex;
    std::queue<T>           queue;
    std::condition_variable can_push;
    std::condition_variable can_pop;
 
+   std::unique_ptr<SPSCRingBuffer<T>> spsc_buffer;
+   std::unique_ptr<MPMCRingBuffer<T>> mpmc_buffer;
+
    std::atomic_int num_writers{0};
 
    size_t max_queue_size;
 
-   size_t items_in_queue;
-   size_t items_pushed;
-   size_t items_popped;
+   // the counters are atomic so that the status of the queue can be checked without taking the lock
+   std::atomic_size_t items_pushed;
+   std::atomic_size_t items_popped;
 
    std::atomic_bool is_finished;
 #endif
@@ -64,25 +96,67 @@ private:
 
 #ifndef __CINT__
 template <typename T>
-ThreadsafeQueue<T>::ThreadsafeQueue(std::string name, size_t maxSize)
-   : fName(std::move(name)), max_queue_size(maxSize), items_in_queue(0), items_pushed(0), items_popped(0),
-     is_finished(false)
+ThreadsafeQueue<T>::ThreadsafeQueue(std::string name, size_t maxSize, EQueueType type)
+   : fName(std::move(name)), fType(type), max_queue_size(maxSize), items_pushed(0), items_popped(0), is_finished(false)
 {
+   switch(fType) {
+   case EQueueType::kSPSC: spsc_buffer.reset(new SPSCRingBuffer<T>(std::min<size_t>(max_queue_size, kMaxRingSize))); break;
+   case EQueueType::kMPMC: mpmc_buffer.reset(new MPMCRingBuffer<T>(std::min<size_t>(max_queue_size, kMaxRingSize))); break;
+   case EQueueType::kMutex: break;
+   }
 }
 
 template <typename T>
 ThreadsafeQueue<T>::~ThreadsafeQueue() = default;
 
+template <typename T>
+void ThreadsafeQueue<T>::Backoff(int& spins)
+{
+   /// Used by the lock-free queues while waiting for the other side:
+   /// spin a little, then yield, then sleep in short intervals.
+   ++spins;
+   if(spins < 64) {
+      return;
+   }
+   if(spins < 256) {
+      std::this_thread::yield();
+      return;
+   }
+   std::this_thread::sleep_for(std::chrono::microseconds(50));
+}
+
+template <typename T>
+bool ThreadsafeQueue<T>::RingPush(T& obj)
+{
+   /// Pushes obj into the ring buffer, waiting for space if it is full.
+   /// Returns false (without pushing obj) if the queue is full and finished.
+   int spins = 0;
+   while(!(fType == EQueueType::kSPSC ? spsc_buffer->TryPush(obj) : mpmc_buffer->TryPush(obj))) {
+      if(is_finished) {
+         return false;
+      }
+      Backoff(spins);
+   }
+   return true;
+}
+
 template <typename T>
 int ThreadsafeQueue<T>::Push(T obj)
 {
+   if(fType != EQueueType::kMutex) {
+      if(!RingPush(obj)) {
+         return 0;
+      }
+      items_pushed++;
+      return 1;
+   }
+
    std::unique_lock<std::mutex> lock(mutex);
    if(queue.size() > max_queue_size) {
       can_push.wait(lock);
    }
 
    items_pushed++;
-   items_in_queue++;
 
    queue.push(obj);
    can_pop.notify_one();
@@ -92,6 +166,19 @@ int ThreadsafeQueue<T>::Push(T obj)
 template <typename T>
 long ThreadsafeQueue<T>::Pop(T& output, int millisecond_wait)
 {
+   if(fType != EQueueType::kMutex) {
+      auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(millisecond_wait);
+      int  spins    = 0;
+      while(!(fType == EQueueType::kSPSC ? spsc_buffer->TryPop(output) : mpmc_buffer->TryPop(output))) {
+         if(millisecond_wait == 0 || std::chrono::steady_clock::now() > deadline) {
+            return -1;
+         }
+         Backoff(spins);
+      }
+      items_popped++;
+      return Size();
+   }
+
    std::unique_lock<std::mutex> lock(mutex);
    if(!queue.size() && millisecond_wait) {
       can_pop.wait_for(lock, std::chrono::milliseconds(millisecond_wait));
@@ -105,7 +192,6 @@ long ThreadsafeQueue<T>::Pop(T& output, int millisecond_wait)
    queue.pop();
 
    items_popped++;
-   items_in_queue--;
 
    can_push.notify_one();
    return queue.size();
@@ -113,23 +199,111 @@ long ThreadsafeQueue<T>::Pop(T& output, int millisecond_wait)
 }
 
 template <typename T>
-size_t ThreadsafeQueue<T>::Size() const
+int ThreadsafeQueue<T>::PushBatch(std::vector<T>& objs)
 {
+   /// Moves all items of objs into the queue (objs is empty afterwards) and returns the number of items pushed.
+   if(objs.empty()) {
+      return 0;
+   }
+   int nofItems = objs.size();
+   if(fType != EQueueType::kMutex) {
+      int pushed = 0;
+      for(auto& obj : objs) {
+         if(!RingPush(obj)) {
+            break;
+         }
+         ++pushed;
+      }
+      items_pushed += pushed;
+      objs.clear();
+      return pushed;
+   }
+
    std::unique_lock<std::mutex> lock(mutex);
-   return items_in_queue;
+   if(queue.size() > max_queue_size) {
+      can_push.wait(lock);
+   }
+
+   items_pushed += nofItems;
+
+   for(auto& obj : objs) {
+      queue.push(std::move(obj));
+   }
+   objs.clear();
+   can_pop.notify_one();
+   return nofItems;
 }
 
 template <typename T>
-size_t ThreadsafeQueue<T>::ItemsPushed() const
+long ThreadsafeQueue<T>::PopBatch(std::vector<T>& output, size_t maxItems, int millisecond_wait)
 {
+   /// Appends up to maxItems items to output. Returns the number of items left in the queue,
+   /// or -1 if no item could be popped within millisecond_wait.
+   if(fType != EQueueType::kMutex) {
+      auto   deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(millisecond_wait);
+      int    spins    = 0;
+      size_t popped   = 0;
+      T      item;
+      while(popped < maxItems) {
+         if(fType == EQueueType::kSPSC ? spsc_buffer->TryPop(item) : mpmc_buffer->TryPop(item)) {
+            output.push_back(std::move(item));
+            ++popped;
+            continue;
+         }
+         // stop at the first empty slot once we have something, otherwise wait for the first item
+         if(popped > 0 || millisecond_wait == 0 || std::chrono::steady_clock::now() > deadline) {
+            break;
+         }
+         Backoff(spins);
+      }
+      if(popped == 0) {
+         return -1;
+      }
+      items_popped += popped;
+      return Size();
+   }
+
    std::unique_lock<std::mutex> lock(mutex);
+   if(!queue.size() && millisecond_wait) {
+      can_pop.wait_for(lock, std::chrono::milliseconds(millisecond_wait));
+   }
+
+   if(!queue.size()) {
+      return -1;
+   }
+
+   size_t popped = 0;
+   while(popped < maxItems && !queue.empty()) {
+      output.push_back(std::move(queue.front()));
+      queue.pop();
+      ++popped;
+   }
+
+   items_popped += popped;
+
+   can_push.notify_one();
+   return queue.size();
+}
+
+template <typename T>
+size_t ThreadsafeQueue<T>::Size() const
+{
+   // for the lock-free queues the push counter is only incremented after the item is in the queue,
+   // so for a moment we can have more items popped than pushed
+   size_t popped = items_popped;
+   size_t pushed = items_pushed;
+   return (pushed > popped) ? pushed - popped : 0;
+}
+
+template <typename T>
+size_t ThreadsafeQueue<T>::ItemsPushed() const
+{
    return items_pushed;
 }
 
 template <typename T>
 size_t ThreadsafeQueue<T>::ItemsPopped() const
 {
-   std::unique_lock<std::mutex> lock(mutex);
    return items_popped;
 }
 
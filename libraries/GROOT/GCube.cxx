@@ -14,7 +14,84 @@
 #include "TRandom.h"
 #include "TClass.h"
 
+#include <algorithm>
 #include <iostream>
+#include <vector>
+
+namespace {
+inline Int_t CubeBin(Int_t nbins, Int_t binx, Int_t biny, Int_t binz)
+{
+   /// Index of cell binx >= biny >= binz (including under- and overflow). The cells are stored in planes of constant
+   /// binz, each plane is a triangle with rows of constant biny, and each row is contiguous in binx.
+   Long64_t n      = nbins + 2;
+   Long64_t planes = n * (n + 1) * (n + 2) / 6 - (n - binz) * (n - binz + 1) * (n - binz + 2) / 6;
+   Long64_t rows   = static_cast<Long64_t>(biny) * (2 * nbins - biny + 3) / 2 -
+                   static_cast<Long64_t>(binz) * (2 * nbins - binz + 3) / 2;
+   return static_cast<Int_t>(planes + rows + binx - binz);
+}
+
+void FindUniformBins(const TAxis& axis, const Double_t* values, Int_t stride, Int_t n, Int_t* bins)
+{
+   /// Same result as TAxis::FindBin for an axis with fixed bin widths that can't be extended. Written without
+   /// branches so that the compiler can vectorise the loop.
+   const Double_t xmin  = axis.GetXmin();
+   const Double_t xmax  = axis.GetXmax();
+   const Double_t nbins = axis.GetNbins();
+   const Int_t    over  = axis.GetNbins() + 1;
+   for(Int_t i = 0; i < n; ++i) {
+      Double_t x = values[i * stride];
+      Double_t t = nbins * (x - xmin) / (xmax - xmin);
+      t          = (t > 0.) ? t : 0.; // also catches NaN
+      t          = (t < nbins) ? t : nbins;
+      Int_t bin  = 1 + static_cast<Int_t>(t);
+      bin        = (x < xmin) ? 0 : bin;
+      bins[i]    = (x < xmax) ? bin : over;
+   }
+}
+
+template <typename T>
+void AddLine(const T* cells, Int_t nbins, Int_t y, Int_t z, bool absolute, Double_t* result)
+{
+   /// Adds cells (x, y, z) for all x (including under- and overflow) to result[x]. With a >= b being y and z, the
+   /// cells with x >= a are contiguous, for b <= x < a we step through the rows x of plane b, and for x < b through
+   /// the planes x.
+   Int_t a = std::max(y, z);
+   Int_t b = std::min(y, z);
+   for(Int_t x = 0; x < b; ++x) {
+      Double_t c = cells[CubeBin(nbins, a, b, x)];
+      result[x] += absolute ? std::abs(c) : c;
+   }
+   Int_t bin = CubeBin(nbins, a, b, b);
+   for(Int_t x = b; x < a; ++x) {
+      Double_t c = cells[bin];
+      result[x] += absolute ? std::abs(c) : c;
+      bin += nbins + 1 - x;
+   }
+   const T* row = cells + CubeBin(nbins, a, a, b) - a;
+   for(Int_t x = a; x < nbins + 2; ++x) {
+      Double_t c = row[x];
+      result[x] += absolute ? std::abs(c) : c;
+   }
+}
+
+template <typename T>
+void SumLines(const T* cells, const Double_t* sumw2, Int_t nbins, Int_t firstBiny, Int_t lastBiny, Int_t firstBinz,
+              Int_t lastBinz, bool computeErrors, Double_t* content, Double_t* error2)
+{
+   for(Int_t y = firstBiny; y <= lastBiny; ++y) {
+      for(Int_t z = firstBinz; z <= lastBinz; ++z) {
+         AddLine(cells, nbins, y, z, false, content);
+         if(computeErrors) {
+            if(sumw2 != nullptr) {
+               AddLine(sumw2, nbins, y, z, false, error2);
+            } else {
+               AddLine(cells, nbins, y, z, true, error2);
+            }
+         }
+      }
+   }
+}
+} // namespace
 
 // Internal exceptions for the CheckConsistency method
 class DifferentDimension : public std::exception {
@@ -379,14 +456,7 @@ Int_t GCube::Fill(Double_t x, Double_t y, Double_t z)
    if(binx < 0 || biny < 0 || binz < 0) {
       return -1;
    }
-   bin = biny * (2 * fXaxis.GetNbins() - biny + 3) / 2 + binx - binz +
-         (fXaxis.GetNbins() + 2) * (fXaxis.GetNbins() + 3) * (fXaxis.GetNbins() + 4) / 6 -
-         (fXaxis.GetNbins() + 2 - binz) * (fXaxis.GetNbins() + 3 - binz) * (fXaxis.GetNbins() + 4 - binz) / 6 - biny;
-   std::cout<<"binx,y,z = "<<binx<<","<<biny<<","<<binz<<" => bin = "<<bin<<std::endl;
-   bin = binx + biny * (fXaxis.GetNbins() - (biny + 1.) / 2.) +
-         binz * (binz / 2. * (binz / 3. - fXaxis.GetNbins() + 3.) + fXaxis.GetNbins() * (3 + fXaxis.GetNbins() / 2.) +
-                 10. / 3.);
-   std::cout<<"binx,y,z = "<<binx<<","<<biny<<","<<binz<<" => bin = "<<bin<<std::endl;
+   bin = CubeBin(fXaxis.GetNbins(), binx, biny, binz);
    AddBinContent(bin);
    if(fSumw2.fN != 0) {
       ++fSumw2.fArray[bin];
@@ -468,9 +538,7 @@ Int_t GCube::Fill(Double_t x, Double_t y, Double_t z, Double_t w)
    if(binx < 0 || biny < 0 || binz < 0) {
       return -1;
    }
-   bin = binx + biny * (fXaxis.GetNbins() - (biny + 1.) / 2.) +
-         binz * (binz / 2. * (binz / 3. - fXaxis.GetNbins() + 3.) + fXaxis.GetNbins() * (3 + fXaxis.GetNbins() / 2.) +
-                 10. / 3.);
+   bin = CubeBin(fXaxis.GetNbins(), binx, biny, binz);
    AddBinContent(bin, w);
    if(fSumw2.fN != 0) {
       fSumw2.fArray[bin] += w * w;
@@ -540,9 +608,7 @@ Int_t GCube::Fill(const char* namex, const char* namey, const char* namez, Doubl
       std::swap(biny, binz);
    }
 
-   bin = binx + biny * (fXaxis.GetNbins() - (biny + 1.) / 2.) +
-         binz * (binz / 2. * (binz / 3. - fXaxis.GetNbins() + 3.) + fXaxis.GetNbins() * (3 + fXaxis.GetNbins() / 2.) +
-                 10. / 3.);
+   bin = CubeBin(fXaxis.GetNbins(), binx, biny, binz);
    AddBinContent(bin, w);
    if(fSumw2.fN != 0) {
       fSumw2.fArray[bin] += w * w;
@@ -570,6 +636,77 @@ Int_t GCube::Fill(const char* namex, const char* namey, const char* namez, Doubl
    return bin;
 }
 
+void GCube::FillN(Int_t ntimes, const Double_t* x, const Double_t* y, const Double_t* z, const Double_t* w,
+                  Int_t stride)
+{
+   /// Fills the cube with arrays of x, y, z values and weights w (if w is nullptr each entry has weight 1).
+   /// The arrays must have ntimes*stride entries.
+   /// For fixed bin widths the bins are calculated for blocks of entries, in loops the compiler can vectorise,
+   /// instead of calling TAxis::FindBin and sorting the coordinates for each entry.
+   if(fBuffer != nullptr || fXaxis.GetXbins()->fN != 0 || fXaxis.CanExtend() || fYaxis.CanExtend() ||
+      fZaxis.CanExtend()) {
+      ntimes *= stride;
+      for(int i = 0; i < ntimes; i += stride) {
+         if(w != nullptr) {
+            Fill(x[i], y[i], z[i], w[i]);
+         } else {
+            Fill(x[i], y[i], z[i]);
+         }
+      }
+      return;
+   }
+
+   const Int_t nbins     = fXaxis.GetNbins();
+   const Int_t blockSize = 256;
+   Int_t       binx[blockSize];
+   Int_t       biny[blockSize];
+   Int_t       binz[blockSize];
+   for(Int_t first = 0; first < ntimes; first += blockSize) {
+      Int_t n = std::min(blockSize, ntimes - first);
+      FindUniformBins(fXaxis, x + first * stride, stride, n, binx);
+      FindUniformBins(fYaxis, y + first * stride, stride, n, biny);
+      FindUniformBins(fZaxis, z + first * stride, stride, n, binz);
+      for(Int_t i = 0; i < n; ++i) {
+         // sort the bins, so that high >= mid >= low
+         Int_t high = std::max(binx[i], biny[i]);
+         Int_t low  = std::min(binx[i], biny[i]);
+         Int_t mid  = std::max(low, std::min(high, binz[i]));
+         low        = std::min(low, binz[i]);
+         high       = std::max(high, binz[i]);
+         Int_t bin  = CubeBin(nbins, high, mid, low);
+         Int_t j    = (first + i) * stride;
+         fEntries++;
+         Double_t weight = 1.;
+         if(w != nullptr) {
+            weight = w[j];
+            AddBinContent(bin, weight);
+            if(fSumw2.fN != 0) {
+               fSumw2.fArray[bin] += weight * weight;
+            }
+         } else {
+            AddBinContent(bin);
+            if(fSumw2.fN != 0) {
+               ++fSumw2.fArray[bin];
+            }
+         }
+         if(!fgStatOverflows && (low == 0 || high > nbins)) {
+            continue;
+         }
+         fTsumw += weight;
+         fTsumw2 += weight * weight;
+         fTsumwx += weight * x[j];
+         fTsumwx2 += weight * x[j] * x[j];
+         fTsumwy += weight * y[j];
+         fTsumwy2 += weight * y[j] * y[j];
+         fTsumwxy += weight * x[j] * y[j];
+         fTsumwz += weight * z[j];
+         fTsumwz2 += weight * z[j] * z[j];
+         fTsumwxz += weight * x[j] * z[j];
+         fTsumwyz += weight * y[j] * z[j];
+      }
+   }
+}
+
 void GCube::FillRandom(const char* fname, Int_t ntimes)
 {
    ///*-*-*-*-*-*-*Fill histogram following distribution in function fname*-*-*-*
@@ -943,9 +1080,7 @@ Int_t GCube::GetBin(Int_t binx, Int_t biny, Int_t binz) const
       std::swap(biny, binz);
    }
 
-   return binx + biny * (fXaxis.GetNbins() - (biny + 1.) / 2.) +
-          binz * (binz / 2. * (binz / 3. - fXaxis.GetNbins() + 3.) + fXaxis.GetNbins() * (3 + fXaxis.GetNbins() / 2.) +
-                  10. / 3.);
+   return CubeBin(fXaxis.GetNbins(), binx, biny, binz);
 }
 
 Double_t GCube::GetBinWithContent2(Double_t c, Int_t& binx, Int_t& biny, Int_t& binz, Int_t firstxbin, Int_t lastxbin,
@@ -1976,6 +2111,14 @@ TH1D* GCube::Projection(const char* name, Int_t firstBiny, Int_t lastBiny, Int_t
    Double_t totcont       = 0;
    Bool_t   computeErrors = h1->GetSumw2N() != 0;
 
+   // we sum whole lines of the packed cells at once
+   std::vector<Double_t> lineContent;
+   std::vector<Double_t> lineError2;
+   bool                  projected = false;
+   if(!computeErrors || GetBinErrorOption() == kNormal) {
+      projected = ProjectLines(firstBiny, lastBiny, firstBinz, lastBinz, computeErrors, lineContent, lineError2);
+   }
+
    // implement filling of projected histogram
    // xbin is bin number of xAxis (the projected axis). Loop is done on all bin of TH2 histograms
    // inbin is the axis being integrated. Loop is done only on the selected bins
@@ -1986,13 +2129,18 @@ TH1D* GCube::Projection(const char* name, Int_t firstBiny, Int_t lastBiny, Int_t
          continue;
       }
 
-      for(Int_t ybin = firstBiny; ybin <= lastBiny; ++ybin) {
-         for(Int_t zbin = firstBinz; zbin <= lastBinz; ++zbin) {
-            // sum bin content and error if needed
-            cont += GetBinContent(xbin, ybin, zbin);
-            if(computeErrors) {
-               Double_t exy = GetBinError(xbin, ybin, zbin);
-               err2 += exy * exy;
+      if(projected) {
+         cont = lineContent[xbin];
+         err2 = lineError2[xbin];
+      } else {
+         for(Int_t ybin = firstBiny; ybin <= lastBiny; ++ybin) {
+            for(Int_t zbin = firstBinz; zbin <= lastBinz; ++zbin) {
+               // sum bin content and error if needed
+               cont += GetBinContent(xbin, ybin, zbin);
+               if(computeErrors) {
+                  Double_t exy = GetBinError(xbin, ybin, zbin);
+                  err2 += exy * exy;
+               }
             }
          }
       }
@@ -2076,6 +2224,32 @@ TH1D* GCube::Projection(const char* name, Int_t firstBiny, Int_t lastBiny, Int_t
    return h1;
 }
 
+bool GCube::ProjectLines(Int_t firstBiny, Int_t lastBiny, Int_t firstBinz, Int_t lastBinz, bool computeErrors,
+                         std::vector<Double_t>& content, std::vector<Double_t>& error2) const
+{
+   /// Sums the cells of all lines (y, z) with y = firstBiny to lastBiny and z = firstBinz to lastBinz for each x (incl.
+   /// under- and overflow) directly from the packed array. Returns false if the type of the cells is unknown, in which
+   /// case nothing has been done.
+   if(fBuffer != nullptr) {
+      const_cast<GCube*>(this)->BufferEmpty();
+   }
+   Int_t nbins = fXaxis.GetNbins();
+   content.assign(nbins + 2, 0.);
+   error2.assign(nbins + 2, 0.);
+   const Double_t* sumw2 = (fSumw2.fN != 0) ? fSumw2.GetArray() : nullptr;
+   if(auto* cells = dynamic_cast<const TArrayD*>(this)) {
+      SumLines(cells->GetArray(), sumw2, nbins, firstBiny, lastBiny, firstBinz, lastBinz, computeErrors,
+               content.data(), error2.data());
+      return true;
+   }
+   if(auto* cells = dynamic_cast<const TArrayF*>(this)) {
+      SumLines(cells->GetArray(), sumw2, nbins, firstBiny, lastBiny, firstBinz, lastBinz, computeErrors,
+               content.data(), error2.data());
+      return true;
+   }
+   return false;
+}
+
 void GCube::PutStats(Double_t* stats)
 {
    // Replace current statistics with the values in array stats
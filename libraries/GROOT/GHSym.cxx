@@ -13,7 +13,64 @@
 #include "TRandom.h"
 #include "TClass.h"
 
+#include <algorithm>
 #include <iostream>
+#include <vector>
+
+namespace {
+void FindUniformBins(const TAxis& axis, const Double_t* values, Int_t stride, Int_t n, Int_t* bins)
+{
+   /// Same result as TAxis::FindBin for an axis with fixed bin widths that can't be extended. Written without
+   /// branches so that the compiler can vectorise the loop.
+   const Double_t xmin  = axis.GetXmin();
+   const Double_t xmax  = axis.GetXmax();
+   const Double_t nbins = axis.GetNbins();
+   const Int_t    over  = axis.GetNbins() + 1;
+   for(Int_t i = 0; i < n; ++i) {
+      Double_t x = values[i * stride];
+      Double_t t = nbins * (x - xmin) / (xmax - xmin);
+      t          = (t > 0.) ? t : 0.; // also catches NaN
+      t          = (t < nbins) ? t : nbins;
+      Int_t bin  = 1 + static_cast<Int_t>(t);
+      bin        = (x < xmin) ? 0 : bin;
+      bins[i]    = (x < xmax) ? bin : over;
+   }
+}
+
+template <typename T>
+void AddLine(const T* cells, Int_t nbins, Int_t y, bool absolute, Double_t* result)
+{
+   /// Adds cells (x, y) for all x (including under- and overflow) to result[x]. Cells with x >= y are stored
+   /// contiguously in row y, for x < y we step through the rows x at column y.
+   Int_t rowStart = 0;
+   for(Int_t x = 0; x < y; ++x) {
+      Double_t c = cells[rowStart + y];
+      result[x] += absolute ? std::abs(c) : c;
+      rowStart += nbins + 1 - x;
+   }
+   const T* row = cells + rowStart;
+   for(Int_t x = y; x < nbins + 2; ++x) {
+      Double_t c = row[x];
+      result[x] += absolute ? std::abs(c) : c;
+   }
+}
+
+template <typename T>
+void SumLines(const T* cells, const Double_t* sumw2, Int_t nbins, Int_t firstBin, Int_t lastBin,
+                  bool computeErrors, Double_t* content, Double_t* error2)
+{
+   for(Int_t y = firstBin; y <= lastBin; ++y) {
+      AddLine(cells, nbins, y, false, content);
+      if(computeErrors) {
+         if(sumw2 != nullptr) {
+            AddLine(sumw2, nbins, y, false, error2);
+         } else {
+            AddLine(cells, nbins, y, true, error2);
+         }
+      }
+   }
+}
+} // namespace
 
 // Internal exceptions for the CheckConsistency method
 class DifferentDimension : public std::exception {
@@ -461,12 +518,58 @@ void GHSym::FillN(Int_t ntimes, const Double_t* x, const Double_t* y, const Doub
    //*-* NB: function only valid for a TH2x object
    //*-*
    //*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*
-   ntimes *= stride;
-   for(int i = 0; i < ntimes; i += stride) {
-      if(w != nullptr) {
-         Fill(x[i], y[i], w[i]);
-      } else {
-         Fill(x[i], y[i]);
+   //*-* For fixed bin widths the bins are calculated for blocks of entries,
+   //*-* in loops the compiler can vectorise, instead of calling TAxis::FindBin.
+   //*-*
+   if(fBuffer != nullptr || fXaxis.GetXbins()->fN != 0 || fXaxis.CanExtend() || fYaxis.CanExtend()) {
+      ntimes *= stride;
+      for(int i = 0; i < ntimes; i += stride) {
+         if(w != nullptr) {
+            Fill(x[i], y[i], w[i]);
+         } else {
+            Fill(x[i], y[i]);
+         }
+      }
+      return;
+   }
+
+   const Int_t nbins     = fXaxis.GetNbins();
+   const Int_t blockSize = 256;
+   Int_t       binx[blockSize];
+   Int_t       biny[blockSize];
+   for(Int_t first = 0; first < ntimes; first += blockSize) {
+      Int_t n = std::min(blockSize, ntimes - first);
+      FindUniformBins(fXaxis, x + first * stride, stride, n, binx);
+      FindUniformBins(fYaxis, y + first * stride, stride, n, biny);
+      for(Int_t i = 0; i < n; ++i) {
+         Int_t high = std::max(binx[i], biny[i]);
+         Int_t low  = std::min(binx[i], biny[i]);
+         Int_t bin  = low * (2 * nbins - low + 3) / 2 + high;
+         Int_t j    = (first + i) * stride;
+         fEntries++;
+         Double_t weight = 1.;
+         if(w != nullptr) {
+            weight = w[j];
+            AddBinContent(bin, weight);
+            if(fSumw2.fN != 0) {
+               fSumw2.fArray[bin] += weight * weight;
+            }
+         } else {
+            AddBinContent(bin);
+            if(fSumw2.fN != 0) {
+               ++fSumw2.fArray[bin];
+            }
+         }
+         if(!fgStatOverflows && (low == 0 || high > nbins)) {
+            continue;
+         }
+         fTsumw += weight;
+         fTsumw2 += weight * weight;
+         fTsumwx += weight * x[j];
+         fTsumwx2 += weight * x[j] * x[j];
+         fTsumwy += weight * y[j];
+         fTsumwy2 += weight * y[j] * y[j];
+         fTsumwxy += weight * x[j] * y[j];
       }
    }
 }
@@ -1604,7 +1707,7 @@ Long64_t GHSym::Merge(TCollection* list)
          }
       }
       fZaxis.Set(1, 0, 1);
-      fNcells = (fXaxis.GetNbins() + 2) * (fYaxis.GetNbins() + 2);
+      fNcells = ((fXaxis.GetNbins() + 2) * (fXaxis.GetNbins() + 3)) / 2;
       SetBinsLength(fNcells);
       if(fSumw2.fN != 0) {
          fSumw2.Set(fNcells);
@@ -1672,7 +1775,8 @@ Long64_t GHSym::Merge(TCollection* list)
             } else {
                iy = biny;
             }
-            for(binx = 0; binx <= nx + 1; ++binx) {
+            // (binx, biny) and (biny, binx) are the same cell, so we only loop over the upper triangle
+            for(binx = biny; binx <= nx + 1; ++binx) {
                cu = h->GetBinContent(binx, biny);
                if(!allSameLimits) {
                   if(cu != 0 && ((!sameLimitsX && (binx == 0 || binx == nx + 1)) ||
@@ -2093,6 +2197,14 @@ TH1D* GHSym::Projection(const char* name, Int_t firstBin, Int_t lastBin, Option_
    Double_t totcont       = 0;
    Bool_t   computeErrors = h1->GetSumw2N() != 0;
 
+   // without cuts we sum whole lines of the packed cells at once
+   std::vector<Double_t> lineContent;
+   std::vector<Double_t> lineError2;
+   bool                  projected = false;
+   if(ncuts == 0 && (!computeErrors || GetBinErrorOption() == kNormal)) {
+      projected = ProjectLines(firstBin, lastBin, computeErrors, lineContent, lineError2);
+   }
+
    // implement filling of projected histogram
    // xbin is bin number of xAxis (the projected axis). Loop is done on all bin of TH2 histograms
    // inbin is the axis being integrated. Loop is done only on the selected bins
@@ -2103,17 +2215,22 @@ TH1D* GHSym::Projection(const char* name, Int_t firstBin, Int_t lastBin, Option_
          continue;
       }
 
-      for(Int_t ybin = firstBin; ybin <= lastBin; ++ybin) {
-         if(ncuts != 0) {
-            if(!fPainter->IsInside(xbin, ybin)) {
-               continue;
+      if(projected) {
+         cont = lineContent[xbin];
+         err2 = lineError2[xbin];
+      } else {
+         for(Int_t ybin = firstBin; ybin <= lastBin; ++ybin) {
+            if(ncuts != 0) {
+               if(!fPainter->IsInside(xbin, ybin)) {
+                  continue;
+               }
+            }
+            // sum bin content and error if needed
+            cont += GetCellContent(xbin, ybin);
+            if(computeErrors) {
+               Double_t exy = GetCellError(xbin, ybin);
+               err2 += exy * exy;
             }
-         }
-         // sum bin content and error if needed
-         cont += GetCellContent(xbin, ybin);
-         if(computeErrors) {
-            Double_t exy = GetCellError(xbin, ybin);
-            err2 += exy * exy;
          }
       }
       // find corresponding bin number in h1 for xbin
@@ -2196,6 +2313,33 @@ TH1D* GHSym::Projection(const char* name, Int_t firstBin, Int_t lastBin, Option_
    return h1;
 }
 
+bool GHSym::ProjectLines(Int_t firstBin, Int_t lastBin, bool computeErrors, std::vector<Double_t>& content,
+                         std::vector<Double_t>& error2) const
+{
+   /// Sums the cells of all lines y = firstBin to lastBin for each x (incl. under- and overflow) directly from the
+   /// packed array. Returns false if the type of the cells is unknown, in which case nothing has been done.
+   if(fBuffer != nullptr) {
+      const_cast<GHSym*>(this)->BufferEmpty();
+   }
+   Int_t nbins = fXaxis.GetNbins();
+   content.assign(nbins + 2, 0.);
+   error2.assign(nbins + 2, 0.);
+   const Double_t* sumw2 = (fSumw2.fN != 0) ? fSumw2.GetArray() : nullptr;
+   if(auto* cells = dynamic_cast<const TArrayD*>(this)) {
+      SumLines(cells->GetArray(), sumw2, nbins, firstBin, lastBin, computeErrors, content.data(), error2.data());
+      return true;
+   }
+   if(auto* cells = dynamic_cast<const TArrayF*>(this)) {
+      SumLines(cells->GetArray(), sumw2, nbins, firstBin, lastBin, computeErrors, content.data(), error2.data());
+      return true;
+   }
+   if(auto* cells = dynamic_cast<const TArrayI*>(this)) {
+      SumLines(cells->GetArray(), sumw2, nbins, firstBin, lastBin, computeErrors, content.data(), error2.data());
+      return true;
+   }
+   return false;
+}
+
 void GHSym::PutStats(Double_t* stats)
 {
    // Replace current statistics with the values in array stats
@@ -2720,6 +2864,229 @@ void GHSym::Smooth(Int_t ntimes, Option_t* option)
    delete[] ebuf;
 }
 
+//------------------------------------------------------------
+// GHSymI methods (integer = four bytes per cell)
+//------------------------------------------------------------
+
+ClassImp(GHSymI)
+
+   GHSymI::GHSymI()
+   : GHSym(), TArrayI()
+{
+   SetBinsLength(9);
+   if(fgDefaultSumw2) {
+      Sumw2();
+   }
+}
+
+GHSymI::GHSymI(const char* name, const char* title, Int_t nbins, Double_t low, Double_t up)
+   : GHSym(name, title, nbins, low, up)
+{
+   TArrayI::Set(fNcells);
+   if(fgDefaultSumw2) {
+      Sumw2();
+   }
+
+   if(low >= up) {
+      SetBuffer(fgBufferSize);
+   }
+}
+
+GHSymI::GHSymI(const char* name, const char* title, Int_t nbins, const Double_t* bins) : GHSym(name, title, nbins, bins)
+{
+   TArrayI::Set(fNcells);
+   if(fgDefaultSumw2) {
+      Sumw2();
+   }
+}
+
+GHSymI::GHSymI(const char* name, const char* title, Int_t nbins, const Float_t* bins) : GHSym(name, title, nbins, bins)
+{
+   TArrayI::Set(fNcells);
+   if(fgDefaultSumw2) {
+      Sumw2();
+   }
+}
+
+GHSymI::GHSymI(const GHSymI& rhs) : GHSym(), TArrayI()
+{
+   rhs.Copy(*this);
+}
+
+GHSymI::~GHSymI() = default;
+
+void GHSymI::AddBinContent(Int_t bin, Double_t w)
+{
+   // Increment bin content by w, saturating at the limits of Int_t (same as TH2I).
+   Long64_t newval = fArray[bin] + Long64_t(w);
+   if(newval > -2147483647 && newval < 2147483647) {
+      fArray[bin] = Int_t(newval);
+      return;
+   }
+   if(newval < -2147483647) {
+      fArray[bin] = -2147483647;
+   }
+   if(newval > 2147483647) {
+      fArray[bin] = 2147483647;
+   }
+}
+
+TH2I* GHSymI::GetMatrix(bool force)
+{
+   if(fMatrix != nullptr && !force) {
+      return static_cast<TH2I*>(fMatrix);
+   }
+   if(force && fMatrix != nullptr) {
+      delete fMatrix;
+   }
+
+   fMatrix = new TH2I(Form("%s_mat", GetName()), GetTitle(), fXaxis.GetNbins(), fXaxis.GetXmin(), fXaxis.GetXmax(),
+                      fYaxis.GetNbins(), fYaxis.GetXmin(), fYaxis.GetXmax());
+   // copy cell contents (including all overflow and underflow cells)
+   for(int i = 0; i < fXaxis.GetNbins() + 2; ++i) {
+      for(int j = 0; j < fXaxis.GetNbins() + 2; ++j) {
+         fMatrix->SetBinContent(i, j, GetBinContent(i, j));
+      }
+   }
+   return static_cast<TH2I*>(fMatrix);
+}
+
+void GHSymI::Copy(TObject& rh) const
+{
+   GHSym::Copy(static_cast<GHSymI&>(rh));
+}
+
+TH1* GHSymI::DrawCopy(Option_t* option, const char* name_postfix) const
+{
+   // Draw copy.
+
+   TString opt = option;
+   opt.ToLower();
+   if(gPad != nullptr && !opt.Contains("same")) {
+      gPad->Clear();
+   }
+   TString newName = (name_postfix) != nullptr ? TString::Format("%s%s", GetName(), name_postfix) : "";
+   TH1*    newth1  = static_cast<TH1*>(Clone(newName));
+   newth1->SetDirectory(nullptr);
+   newth1->SetBit(kCanDelete);
+   newth1->AppendPad(option);
+   return newth1;
+}
+
+Double_t GHSymI::GetBinContent(Int_t bin) const
+{
+   // Get bin content.
+
+   if(fBuffer != nullptr) {
+      const_cast<GHSymI*>(this)->BufferEmpty();
+   }
+   if(bin < 0) {
+      bin = 0;
+   }
+   if(bin >= fNcells) {
+      bin = fNcells - 1;
+   }
+   if(fArray == nullptr) {
+      return 0;
+   }
+   return Double_t(fArray[bin]);
+}
+
+void GHSymI::Reset(Option_t* option)
+{
+   //*-*-*-*-*-*-*-*Reset this histogram: contents, errors, etc*-*-*-*-*-*-*-*
+   //*-*            ===========================================
+
+   GHSym::Reset(option);
+   TArrayI::Reset();
+}
+
+void GHSymI::SetBinContent(Int_t bin, Double_t content)
+{
+   // Set bin content
+   fEntries++;
+   fTsumw = 0;
+   if(bin < 0) {
+      return;
+   }
+   if(bin >= fNcells) {
+      return;
+   }
+   fArray[bin] = Int_t(content);
+}
+
+void GHSymI::SetBinsLength(Int_t n)
+{
+   // Set total number of bins including under/overflow
+   // Reallocate bin contents array
+
+   if(n < 0) {
+      n = ((fXaxis.GetNbins() + 2) * (fXaxis.GetNbins() + 3)) / 2;
+   }
+   fNcells = n;
+   TArrayI::Set(n);
+}
+
+GHSymI& GHSymI::operator=(const GHSymI& h1)
+{
+   // Operator =
+
+   if(this != &h1) {
+      const_cast<GHSymI&>(h1).Copy(*this);
+   }
+   return *this;
+}
+
+GHSymI operator*(Float_t c1, GHSymI& h1)
+{
+   // Operator *
+
+   GHSymI hnew = h1;
+   hnew.Scale(c1);
+   hnew.SetDirectory(nullptr);
+   return hnew;
+}
+
+GHSymI operator+(GHSymI& h1, GHSymI& h2)
+{
+   // Operator +
+
+   GHSymI hnew = h1;
+   hnew.Add(&h2, 1);
+   hnew.SetDirectory(nullptr);
+   return hnew;
+}
+
+GHSymI operator-(GHSymI& h1, GHSymI& h2)
+{
+   // Operator -
+
+   GHSymI hnew = h1;
+   hnew.Add(&h2, -1);
+   hnew.SetDirectory(nullptr);
+   return hnew;
+}
+
+GHSymI operator*(GHSymI& h1, GHSymI& h2)
+{
+   // Operator *
+
+   GHSymI hnew = h1;
+   hnew.Multiply(&h2);
+   hnew.SetDirectory(nullptr);
+   return hnew;
+}
+
+GHSymI operator/(GHSymI& h1, GHSymI& h2)
+{
+   // Operator /
+
+   GHSymI hnew = h1;
+   hnew.Divide(&h2);
+   hnew.SetDirectory(nullptr);
+   return hnew;
+}
+
 //------------------------------------------------------------
 // GHSymF methods (float = four bytes per cell)
 //------------------------------------------------------------
@@ -2861,7 +3228,7 @@ void GHSymF::SetBinsLength(Int_t n)
    // Reallocate bin contents array
 
    if(n < 0) {
-      n = (fXaxis.GetNbins() + 2) * (fYaxis.GetNbins() + 2);
+      n = ((fXaxis.GetNbins() + 2) * (fXaxis.GetNbins() + 3)) / 2;
    }
    fNcells = n;
    TArrayF::Set(n);
@@ -3068,7 +3435,7 @@ void GHSymD::SetBinsLength(Int_t n)
    // Reallocate bin contents array
 
    if(n < 0) {
-      n = (fXaxis.GetNbins() + 2) * (fYaxis.GetNbins() + 2);
+      n = ((fXaxis.GetNbins() + 2) * (fXaxis.GetNbins() + 3)) / 2;
    }
    fNcells = n;
    TArrayD::Set(n);
@@ -62,6 +62,7 @@
 #pragma link C++ class GH2I+;
 #pragma link C++ class GH2D+;
 #pragma link C++ class GHSym+;
+#pragma link C++ class GHSymI+;
 #pragma link C++ class GHSymF+;
 #pragma link C++ class GHSymD+;
 #pragma link C++ class GCube+;
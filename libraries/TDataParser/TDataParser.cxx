@@ -1,6 +1,8 @@
 #include "TDataParser.h"
 #include "TDataParserException.h"
 
+#include <algorithm>
+
 #include "TChannel.h"
 #include "Globals.h"
 
@@ -17,13 +19,22 @@
 TGRSIOptions* TDataParser::fOptions = nullptr;
 
 TDataParser::TDataParser()
-   : fBadOutputQueue(std::make_shared<ThreadsafeQueue<std::shared_ptr<const TBadFragment>>>("bad_frag_queue")),
-     fScalerOutputQueue(std::make_shared<ThreadsafeQueue<std::shared_ptr<TEpicsFrag>>>("scaler_queue")),
-     fNoWaveforms(false), fRecordDiag(true), fMaxTriggerId(1024 * 1024 * 16), fLastMidasId(0), fLastTriggerId(0),
-     fLastNetworkPacket(0), fFragmentHasWaveform(false), fFragmentMap(fGoodOutputQueues, fBadOutputQueue),
-     fItemsPopped(nullptr), fInputSize(nullptr)
+   : fBadOutputQueue(std::make_shared<ThreadsafeQueue<std::shared_ptr<const TBadFragment>>>(
+        "bad_frag_queue", 50000, TGRSIOptions::Get()->LockFreeQueues() ? EQueueType::kSPSC : EQueueType::kMutex)),
+     fScalerOutputQueue(std::make_shared<ThreadsafeQueue<std::shared_ptr<TEpicsFrag>>>(
+        "scaler_queue", 50000, TGRSIOptions::Get()->LockFreeQueues() ? EQueueType::kSPSC : EQueueType::kMutex)),
+     fBatchSize(std::max(TGRSIOptions::Get()->FragmentBatchSize(), static_cast<size_t>(1))), fDeferOutput(false),
+     fDiagnostics(TParsingDiagnostics::Get()), fNoWaveforms(false), fRecordDiag(true), fMaxTriggerId(1024 * 1024 * 16),
+     fLastMidasId(0), fLastTriggerId(0), fLastNetworkPacket(0), fFragmentHasWaveform(false),
+     fFragmentMap([this](const std::shared_ptr<TFragment>& frag) { PushMappedFragment(frag); },
+                  [this](const std::shared_ptr<TBadFragment>& frag) { PushDroppedFragment(frag); }),
+     fFragmentPool(TGRSIOptions::Get()->FragmentPoolSize()), fItemsPopped(nullptr), fInputSize(nullptr)
 {
    gChannel = new TChannel;
+   // set the options here so that parsers running in parallel threads don't have to
+   if(fOptions == nullptr) {
+      fOptions = TGRSIOptions::Get();
+   }
 }
 
 TDataParser::~TDataParser()
@@ -33,6 +44,8 @@ TDataParser::~TDataParser()
 
 void TDataParser::ClearQueue()
 {
+   fGoodOutputBuffer.clear();
+   fDeferredOutput.clear();
    std::shared_ptr<const TFragment> frag;
    for(const auto& outQueue : fGoodOutputQueues) {
       while(outQueue->Size() != 0u) {
@@ -51,6 +64,7 @@ void TDataParser::ClearQueue()
 
 void TDataParser::SetFinished()
 {
+   FlushGoodOutput();
    for(const auto& outQueue : fGoodOutputQueues) {
       outQueue->SetFinished();
    }
@@ -62,7 +76,7 @@ int TDataParser::TigressDataToFragment(uint32_t* data, int size, unsigned int mi
 {
    /// Converts A MIDAS File from the Tigress DAQ into a TFragment.
    int                        NumFragsFound = 0;
-   std::shared_ptr<TFragment> eventFrag     = std::make_shared<TFragment>();
+   std::shared_ptr<TFragment> eventFrag     = fFragmentPool.Get();
    eventFrag->SetMidasTimeStamp(midasTime);
    eventFrag->SetMidasId(midasSerialNumber);
 
@@ -112,14 +126,14 @@ int TDataParser::TigressDataToFragment(uint32_t* data, int size, unsigned int mi
          /// check whether the fragment is 'good'
 
          if(((*(data + x + 1)) & 0xf0000000) != 0xe0000000) {
-            std::shared_ptr<TFragment> transferfrag = std::make_shared<TFragment>(*eventFrag);
-            eventFrag                               = std::make_shared<TFragment>();
+            std::shared_ptr<TFragment> transferfrag = fFragmentPool.Get(*eventFrag);
+            eventFrag                               = fFragmentPool.Get();
             eventFrag->SetMidasTimeStamp(transferfrag->GetMidasTimeStamp());
             eventFrag->SetMidasId(transferfrag->GetMidasId());
             eventFrag->SetTriggerId(transferfrag->GetTriggerId());
             eventFrag->SetTimeStamp(transferfrag->GetTimeStamp());
 
-            Push(fGoodOutputQueues, transferfrag);
+            Push(transferfrag);
             NumFragsFound++;
 
             // printf("transferfrag = 0x%08x\n",transferfrag); fflush(stdout);
@@ -127,8 +141,8 @@ int TDataParser::TigressDataToFragment(uint32_t* data, int size, unsigned int mi
             // printf("eventFrag: = 0x%08x\n",eventFrag); fflush(stdout);
             // printf("eventFrag->GetTimeStamp() = %lu\n",eventFrag->GetTimeStamp()); fflush(stdout);
          } else {
-            std::shared_ptr<TFragment> transferfrag = std::make_shared<TFragment>(*eventFrag);
-            Push(fGoodOutputQueues, transferfrag);
+            std::shared_ptr<TFragment> transferfrag = fFragmentPool.Get(*eventFrag);
+            Push(transferfrag);
             NumFragsFound++;
             eventFrag = nullptr;
             return NumFragsFound;
@@ -407,7 +421,7 @@ int TDataParser::GriffinDataToFragment(uint32_t* data, int size, EBank bank, uns
 {
    /// Converts a Griffin flavoured MIDAS file into a TFragment and returns the number of words processed (or the
    /// negative index of the word it failed on)
-   std::shared_ptr<TFragment> eventFrag = std::make_shared<TFragment>();
+   std::shared_ptr<TFragment> eventFrag = fFragmentPool.Get();
    // no need to delete eventFrag, it's a shared_ptr and gets deleted when it goes out of scope
    fFragmentHasWaveform = false;
    fState               = EDataParserState::kGood;
@@ -423,7 +437,7 @@ int TDataParser::GriffinDataToFragment(uint32_t* data, int size, EBank bank, uns
    if(!SetGRIFHeader(data[x++], eventFrag, bank)) {
       printf(DYELLOW "data[0] = 0x%08x" RESET_COLOR "\n", data[0]);
 		// we failed to get a good header, so we don't know which detector type this fragment would've belonged to
-      TParsingDiagnostics::Get()->BadFragment(-1); 
+      fDiagnostics->BadFragment(-1); 
       // this is the first word, so no need to check is the state/failed word has been set before
       fState     = EDataParserState::kBadHeader;
       failedWord = 0;
@@ -473,7 +487,7 @@ int TDataParser::GriffinDataToFragment(uint32_t* data, int size, EBank bank, uns
    // The channel trigger ID is in an unstable state right now and is not
    // always written to the midas file
    if(!SetGRIFChannelTriggerId(data[x++], eventFrag)) {
-      TParsingDiagnostics::Get()->BadFragment(eventFrag->GetDetectorType());
+      fDiagnostics->BadFragment(eventFrag->GetDetectorType());
       if(fState == EDataParserState::kGood) {
          fState     = EDataParserState::kBadTriggerId;
          failedWord = x - 1; // -1 compensates the incrementation in the if-statement
@@ -489,7 +503,7 @@ int TDataParser::GriffinDataToFragment(uint32_t* data, int size, EBank bank, uns
    }
 
    if(!SetGRIFTimeStampLow(data[x++], eventFrag)) {
-      TParsingDiagnostics::Get()->BadFragment(eventFrag->GetDetectorType());
+      fDiagnostics->BadFragment(eventFrag->GetDetectorType());
       if(fState == EDataParserState::kGood) {
          fState     = EDataParserState::kBadLowTS;
          failedWord = x - 1; // -1 compensates the incrementation in the if-statement
@@ -499,7 +513,7 @@ int TDataParser::GriffinDataToFragment(uint32_t* data, int size, EBank bank, uns
    }
 
    if(!SetGRIFDeadTime(data[x++], eventFrag)) {
-      TParsingDiagnostics::Get()->BadFragment(eventFrag->GetDetectorType());
+      fDiagnostics->BadFragment(eventFrag->GetDetectorType());
       if(fState == EDataParserState::kGood) {
          fState     = EDataParserState::kBadHighTS;
          failedWord = x - 1; // -1 compensates the incrementation in the if-statement
@@ -523,7 +537,7 @@ int TDataParser::GriffinDataToFragment(uint32_t* data, int size, EBank bank, uns
          // currently the GRIF-C only sets the master/slave port of the address for the first header (of the corrupt
          // event)
          // so we want to ignore this corrupt event and the next event which has a wrong address
-         TParsingDiagnostics::Get()->BadFragment(eventFrag->GetDetectorType());
+         fDiagnostics->BadFragment(eventFrag->GetDetectorType());
          if(fState == EDataParserState::kGood) {
             fState     = EDataParserState::kSecondHeader;
             failedWord = x + 1; //+1 to ensure we don't read this header as start of a good event
@@ -589,7 +603,7 @@ int TDataParser::GriffinDataToFragment(uint32_t* data, int size, EBank bank, uns
             if(eventFrag->GetModuleType() == 1 && bank == EBank::kGRF4) {
                if(tmpCfd.size() != 1) {
                   if(fRecordDiag) {
-                     TParsingDiagnostics::Get()->BadFragment(eventFrag->GetDetectorType());
+                     fDiagnostics->BadFragment(eventFrag->GetDetectorType());
                   }
                   if(fState == EDataParserState::kGood) {
                      fState     = EDataParserState::kNotSingleCfd;
@@ -602,14 +616,22 @@ int TDataParser::GriffinDataToFragment(uint32_t* data, int size, EBank bank, uns
                }
                eventFrag->SetCfd(tmpCfd[0]);
                if(fRecordDiag) {
-                  TParsingDiagnostics::Get()->GoodFragment(eventFrag);
+                  fDiagnostics->GoodFragment(eventFrag);
+               }
+               if(fDeferOutput) {
+                  // piled-up hits are solved with hits of later events, so the fragment map has to see the hits of
+                  // all events in order, i.e. it's the map of the parser replaying the output
+                  fDeferredOutput.emplace_back([eventFrag, tmpCharge, tmpIntLength](TDataParser& parser) {
+                     parser.fFragmentMap.Add(eventFrag, tmpCharge, tmpIntLength);
+                  });
+               } else {
+                  fFragmentMap.Add(eventFrag, tmpCharge, tmpIntLength);
                }
-               fFragmentMap.Add(eventFrag, tmpCharge, tmpIntLength);
                return x;
             }
             if(tmpCharge.size() != tmpIntLength.size() || tmpCharge.size() != tmpCfd.size()) {
                if(fRecordDiag) {
-                  TParsingDiagnostics::Get()->BadFragment(eventFrag->GetDetectorType());
+                  fDiagnostics->BadFragment(eventFrag->GetDetectorType());
                }
                if(fState == EDataParserState::kGood) {
                   fState     = EDataParserState::kSizeMismatch;
@@ -625,13 +647,13 @@ int TDataParser::GriffinDataToFragment(uint32_t* data, int size, EBank bank, uns
                eventFrag->SetKValue(tmpIntLength[h]);
                eventFrag->SetCfd(tmpCfd[h]);
                if(fRecordDiag) {
-                  TParsingDiagnostics::Get()->GoodFragment(eventFrag);
+                  fDiagnostics->GoodFragment(eventFrag);
                }
                if(fState == EDataParserState::kGood) {
                   if(fOptions->ReconstructTimeStamp()) {
                      fLastTimeStampMap[eventFrag->GetAddress()] = eventFrag->GetTimeStamp();
                   }
-                  Push(fGoodOutputQueues, std::make_shared<TFragment>(*eventFrag));
+                  Push(fFragmentPool.Get(*eventFrag));
                } else {
                   if(fOptions->ReconstructTimeStamp() && fState == EDataParserState::kBadHighTS && !multipleErrors) {
                      // std::cout<<"reconstructing timestamp from 0x"<<std::hex<<eventFrag->GetTimeStamp()<<" using
@@ -647,7 +669,7 @@ int TDataParser::GriffinDataToFragment(uint32_t* data, int size, EBank bank, uns
                         eventFrag->AppendTimeStamp(fLastTimeStampMap[eventFrag->GetAddress()] & 0x3fff0000000);
                      }
                      // std::cout<<" => 0x"<<eventFrag->GetTimeStamp()<<std::dec<<std::endl;
-                     Push(fGoodOutputQueues, std::make_shared<TFragment>(*eventFrag));
+                     Push(fFragmentPool.Get(*eventFrag));
                   } else {
                      // std::cout<<"Can't reconstruct time stamp, "<<fOptions->ReconstructTimeStamp()<<",
                      // state "<<fState<<" = "<<EDataParserState::kBadHighTS<<", "<<multipleErrors<<std::endl;
@@ -658,7 +680,7 @@ int TDataParser::GriffinDataToFragment(uint32_t* data, int size, EBank bank, uns
             return x;
          } else {
             if(fRecordDiag) {
-               TParsingDiagnostics::Get()->BadFragment(eventFrag->GetDetectorType());
+               fDiagnostics->BadFragment(eventFrag->GetDetectorType());
             }
             if(fState == EDataParserState::kGood) {
                fState     = EDataParserState::kBadFooter;
@@ -673,7 +695,7 @@ int TDataParser::GriffinDataToFragment(uint32_t* data, int size, EBank bank, uns
       case 0xf:
          switch(bank) {
 			case EBank::kGRF1: // format from before May 2015 experiments
-            TParsingDiagnostics::Get()->BadFragment(eventFrag->GetDetectorType());
+            fDiagnostics->BadFragment(eventFrag->GetDetectorType());
             if(fState == EDataParserState::kGood) {
                fState     = EDataParserState::kFault;
                failedWord = x;
@@ -690,7 +712,7 @@ int TDataParser::GriffinDataToFragment(uint32_t* data, int size, EBank bank, uns
                dword = data[x];
                SetGRIFPsd(dword, eventFrag);
             } else {
-               TParsingDiagnostics::Get()->BadFragment(eventFrag->GetDetectorType());
+               fDiagnostics->BadFragment(eventFrag->GetDetectorType());
                if(fState == EDataParserState::kGood) {
                   fState     = EDataParserState::kMissingPsd;
                   failedWord = x;
@@ -703,7 +725,7 @@ int TDataParser::GriffinDataToFragment(uint32_t* data, int size, EBank bank, uns
             break;
 			case EBank::kGRF3: // from 2016 on we're back to reserving 0xf for faults
 			case EBank::kGRF4:
-            TParsingDiagnostics::Get()->BadFragment(eventFrag->GetDetectorType());
+            fDiagnostics->BadFragment(eventFrag->GetDetectorType());
             if(fState == EDataParserState::kGood) {
                fState     = EDataParserState::kFault;
                failedWord = x;
@@ -735,7 +757,7 @@ int TDataParser::GriffinDataToFragment(uint32_t* data, int size, EBank bank, uns
                   tmpIntLength.push_back(tmp | ((data[x] & 0x7c000000) >> 26));
                   tmpCfd.push_back(data[x] & 0x03ffffff);
                } else {
-                  TParsingDiagnostics::Get()->BadFragment(eventFrag->GetDetectorType());
+                  fDiagnostics->BadFragment(eventFrag->GetDetectorType());
                   if(fState == EDataParserState::kGood) {
                      fState     = EDataParserState::kMissingCfd;
                      failedWord = x;
@@ -758,7 +780,7 @@ int TDataParser::GriffinDataToFragment(uint32_t* data, int size, EBank bank, uns
                   tmpCfd.push_back(data[x] & 0x003fffff);
                   break;
                } else {
-                  TParsingDiagnostics::Get()->BadFragment(eventFrag->GetDetectorType());
+                  fDiagnostics->BadFragment(eventFrag->GetDetectorType());
                   if(fState == EDataParserState::kGood) {
                      fState     = EDataParserState::kMissingCfd;
                      failedWord = x;
@@ -849,7 +871,7 @@ int TDataParser::GriffinDataToFragment(uint32_t* data, int size, EBank bank, uns
                   while(x < size && (data[x] & 0xf0000000) != 0xe0000000) {
                      ++x;
                   }
-                  TParsingDiagnostics::Get()->BadFragment(eventFrag->GetDetectorType());
+                  fDiagnostics->BadFragment(eventFrag->GetDetectorType());
                   if(fState == EDataParserState::kGood) {
                      fState     = EDataParserState::kMissingCharge;
                      failedWord = x;
@@ -864,7 +886,7 @@ int TDataParser::GriffinDataToFragment(uint32_t* data, int size, EBank bank, uns
                if(!fOptions->SuppressErrors()) {
                   printf(DRED "Error, bank type %d not implemented yet" RESET_COLOR "\n", static_cast<std::underlying_type<EBank>::type>(bank));
                }
-               TParsingDiagnostics::Get()->BadFragment(eventFrag->GetDetectorType());
+               fDiagnostics->BadFragment(eventFrag->GetDetectorType());
                if(fState == EDataParserState::kGood) {
                   fState     = EDataParserState::kBadBank;
                   failedWord = x;
@@ -887,7 +909,7 @@ int TDataParser::GriffinDataToFragment(uint32_t* data, int size, EBank bank, uns
                tmpIntLength.push_back(tmp | ((data[x] & 0x7c000000) >> 26));
                tmpCfd.push_back(data[x] & 0x03ffffff);
             } else {
-               TParsingDiagnostics::Get()->BadFragment(eventFrag->GetDetectorType());
+               fDiagnostics->BadFragment(eventFrag->GetDetectorType());
                if(fState == EDataParserState::kGood) {
                   fState     = EDataParserState::kMissingCfd;
                   failedWord = x;
@@ -908,7 +930,7 @@ int TDataParser::GriffinDataToFragment(uint32_t* data, int size, EBank bank, uns
                   dword = data[x];
                   SetGRIFPsd(dword, eventFrag);
                } else {
-                  TParsingDiagnostics::Get()->BadFragment(eventFrag->GetDetectorType());
+                  fDiagnostics->BadFragment(eventFrag->GetDetectorType());
                   if(fState == EDataParserState::kGood) {
                      fState     = EDataParserState::kMissingPsd;
                      failedWord = x;
@@ -924,7 +946,7 @@ int TDataParser::GriffinDataToFragment(uint32_t* data, int size, EBank bank, uns
             if(!fOptions->SuppressErrors()) {
                printf(DRED "Error, module type %d not implemented yet" RESET_COLOR "\n", eventFrag->GetModuleType());
             }
-            TParsingDiagnostics::Get()->BadFragment(eventFrag->GetDetectorType());
+            fDiagnostics->BadFragment(eventFrag->GetDetectorType());
             if(fState == EDataParserState::kGood) {
                fState     = EDataParserState::kBadModuleType;
                failedWord = x;
@@ -938,7 +960,7 @@ int TDataParser::GriffinDataToFragment(uint32_t* data, int size, EBank bank, uns
       } // switch(packet)
    }    // for(;x<size;x++)
 
-   TParsingDiagnostics::Get()->BadFragment(eventFrag->GetDetectorType());
+   fDiagnostics->BadFragment(eventFrag->GetDetectorType());
    if(fState == EDataParserState::kGood) {
       fState     = EDataParserState::kEndOfData;
       failedWord = x;
@@ -1158,11 +1180,15 @@ int TDataParser::GriffinDataToPPGEvent(uint32_t* data, int size, unsigned int, t
       case 0xb0000000: SetPPGHighTimeStamp(value, ppgEvent); break;
       case 0xe0000000:
          // if((value & 0xFFFF) == (ppgEvent->GetNewPPG())){
-         TPPG::Get()->AddData(ppgEvent);
-         TParsingDiagnostics::Get()->GoodFragment(-2); // use detector type -2 for PPG
+         if(fDeferOutput) {
+            fDeferredOutput.emplace_back([ppgEvent](TDataParser&) { TPPG::Get()->AddData(ppgEvent); });
+         } else {
+            TPPG::Get()->AddData(ppgEvent);
+         }
+         fDiagnostics->GoodFragment(-2); // use detector type -2 for PPG
          return x;
          //} else  {
-         //	TParsingDiagnostics::Get()->BadFragment(-2); //use detector type -2 for PPG
+         //	fDiagnostics->BadFragment(-2); //use detector type -2 for PPG
          //	return -x;
          //}
          break;
@@ -1170,7 +1196,7 @@ int TDataParser::GriffinDataToPPGEvent(uint32_t* data, int size, unsigned int, t
    }
    delete ppgEvent;
    // No trailer found
-   TParsingDiagnostics::Get()->BadFragment(-2); // use detector type -2 for PPG
+   fDiagnostics->BadFragment(-2); // use detector type -2 for PPG
    return -x;
 }
 
@@ -1229,7 +1255,7 @@ int TDataParser::GriffinDataToScalerEvent(uint32_t* data, int address)
 
    // we expect a word starting with 0xa containing the 28 lowest bits of the timestamp
    if(!SetScalerLowTimeStamp(data[x++], scalerEvent)) {
-      TParsingDiagnostics::Get()->BadFragment(-3); // use detector type -3 for scaler data
+      fDiagnostics->BadFragment(-3); // use detector type -3 for scaler data
       fState     = EDataParserState::kBadScalerLowTS;
       failedWord = x;
       throw TDataParserException(fState, failedWord, false);
@@ -1237,7 +1263,7 @@ int TDataParser::GriffinDataToScalerEvent(uint32_t* data, int address)
    // followed by four scaler words (32 bits each)
    for(int i = 0; i < 4; ++i) {
       if(!SetScalerValue(i, data[x++], scalerEvent)) {
-         TParsingDiagnostics::Get()->BadFragment(-3); // use detector type -3 for scaler data
+         fDiagnostics->BadFragment(-3); // use detector type -3 for scaler data
          fState     = EDataParserState::kBadScalerValue;
          failedWord = x;
          throw TDataParserException(fState, failedWord, false);
@@ -1246,26 +1272,34 @@ int TDataParser::GriffinDataToScalerEvent(uint32_t* data, int address)
    // and finally the trailer word with the highest 24 bits of the timestamp
    int scalerType = 0;
    if(!SetScalerHighTimeStamp(data[x++], scalerEvent, scalerType)) {
-      TParsingDiagnostics::Get()->BadFragment(-3); // use detector type -3 for scaler data
+      fDiagnostics->BadFragment(-3); // use detector type -3 for scaler data
       fState     = EDataParserState::kBadScalerHighTS;
       failedWord = x;
       throw TDataParserException(fState, failedWord, false);
    }
 
    if(scalerType == 0) { // deadtime scaler
-      TDeadtimeScalerQueue::Get()->Add(scalerEvent);
+      if(fDeferOutput) {
+         fDeferredOutput.emplace_back([scalerEvent](TDataParser&) { TDeadtimeScalerQueue::Get()->Add(scalerEvent); });
+      } else {
+         TDeadtimeScalerQueue::Get()->Add(scalerEvent);
+      }
    } else if(scalerType == 1) { // rate scaler
       // the rate scaler has only one real value, the rate
       scalerEvent->ResizeScaler();
-      TRateScalerQueue::Get()->Add(scalerEvent);
+      if(fDeferOutput) {
+         fDeferredOutput.emplace_back([scalerEvent](TDataParser&) { TRateScalerQueue::Get()->Add(scalerEvent); });
+      } else {
+         TRateScalerQueue::Get()->Add(scalerEvent);
+      }
    } else {                                        // unknown scaler type
-      TParsingDiagnostics::Get()->BadFragment(-3); // use detector type -3 for scaler data
+      fDiagnostics->BadFragment(-3); // use detector type -3 for scaler data
       fState     = EDataParserState::kBadScalerType;
       failedWord = x;
       throw TDataParserException(fState, failedWord, false);
    }
 
-   TParsingDiagnostics::Get()->GoodFragment(-3); // use detector type -3 for scaler data
+   fDiagnostics->GoodFragment(-3); // use detector type -3 for scaler data
    return x;
 }
 
@@ -1467,7 +1501,7 @@ int TDataParser::FippsToFragment(std::vector<char> data)
    uint32_t* ptr = reinterpret_cast<uint32_t*>(data.data());
 
    int                        totalEventsRead = 0;
-   std::shared_ptr<TFragment> eventFrag       = std::make_shared<TFragment>();
+   std::shared_ptr<TFragment> eventFrag       = fFragmentPool.Get();
    Long64_t                   tmpTimestamp;
    if(fItemsPopped != nullptr && fInputSize != nullptr) {
       *fItemsPopped = 0;
@@ -1487,41 +1521,122 @@ int TDataParser::FippsToFragment(std::vector<char> data)
       ++totalEventsRead;
       if((ptr[i + 2] & 0x7fff) == 0) {
          if(fRecordDiag) {
-            TParsingDiagnostics::Get()->BadFragment(99);
+            fDiagnostics->BadFragment(99);
          }
          // Push(*fBadOutputQueue, std::make_shared<TBadFragment>(*eventFrag, ptr, data.size() / 4, i + 2, false));
          continue;
       }
       eventFrag->SetCharge(static_cast<int32_t>(ptr[i + 2] & 0x7fff));
       if(fRecordDiag) {
-         TParsingDiagnostics::Get()->GoodFragment(eventFrag);
+         fDiagnostics->GoodFragment(eventFrag);
       }
-      Push(fGoodOutputQueues, std::make_shared<TFragment>(*eventFrag));
+      Push(fFragmentPool.Get(*eventFrag));
       // std::cout<<totalEventsRead<<": "<<eventFrag->Charge()<<", "<<eventFrag->GetTimeStamp()<<std::endl;
    }
 
    return totalEventsRead;
 }
 
-void TDataParser::Push(std::vector<std::shared_ptr<ThreadsafeQueue<std::shared_ptr<const TFragment>>>>& queues,
-                       const std::shared_ptr<TFragment>&                                                frag)
+void TDataParser::Push(const std::shared_ptr<TFragment>& frag)
 {
+   /// Sets fragment id and entry number and pushes the fragment to the good output queue(s). In deferred mode
+   /// this is done when the output is replayed, so ids and entry numbers don't depend on the number of threads.
+   if(fDeferOutput) {
+      fDeferredOutput.emplace_back([frag](TDataParser& parser) { parser.Push(frag); });
+      return;
+   }
    frag->SetFragmentId(fFragmentIdMap[frag->GetTriggerId()]);
    fFragmentIdMap[frag->GetTriggerId()]++;
    frag->SetEntryNumber();
-   for(const auto& queue : queues) {
-      queue->Push(frag);
+   PushGoodFragment(frag);
+}
+
+void TDataParser::PushGoodFragment(const std::shared_ptr<const TFragment>& frag)
+{
+   /// Pushes the fragment to all good output queues, or - if batching is enabled - adds it
+   /// to the batch of fragments that is pushed once it is full.
+   if(fBatchSize == 1) {
+      for(const auto& queue : fGoodOutputQueues) {
+         queue->Push(frag);
+      }
+      return;
+   }
+   fGoodOutputBuffer.push_back(frag);
+   if(fGoodOutputBuffer.size() >= fBatchSize) {
+      FlushGoodOutput();
    }
 }
 
+void TDataParser::FlushGoodOutput()
+{
+   /// Pushes the current batch of good fragments to all good output queues.
+   if(fGoodOutputBuffer.empty()) {
+      return;
+   }
+   if(fGoodOutputQueues.empty()) {
+      fGoodOutputBuffer.clear();
+      return;
+   }
+   // all but the last queue get a copy, the last one gets the buffer itself
+   for(size_t i = 0; i + 1 < fGoodOutputQueues.size(); ++i) {
+      std::vector<std::shared_ptr<const TFragment>> copy(fGoodOutputBuffer);
+      fGoodOutputQueues[i]->PushBatch(copy);
+   }
+   fGoodOutputQueues.back()->PushBatch(fGoodOutputBuffer);
+   fGoodOutputBuffer.clear();
+   fGoodOutputBuffer.reserve(fBatchSize);
+}
+
 void TDataParser::Push(ThreadsafeQueue<std::shared_ptr<const TBadFragment>>& queue, const std::shared_ptr<TBadFragment>& frag)
 {
+   if(fDeferOutput) {
+      // the queue is always our bad output queue, so the replaying parser uses its own
+      fDeferredOutput.emplace_back([frag](TDataParser& parser) { parser.Push(*(parser.fBadOutputQueue), frag); });
+      return;
+   }
    frag->SetFragmentId(fFragmentIdMap[frag->GetTriggerId()]);
    fFragmentIdMap[frag->GetTriggerId()]++;
    frag->SetEntryNumber();
    queue.Push(frag);
 }
 
+void TDataParser::PushMappedFragment(const std::shared_ptr<TFragment>& frag)
+{
+   /// Pushes a fragment passed on by the fragment map, these get an entry number but keep their fragment id.
+   if(fDeferOutput) {
+      fDeferredOutput.emplace_back([frag](TDataParser& parser) { parser.PushMappedFragment(frag); });
+      return;
+   }
+   frag->SetEntryNumber();
+   PushGoodFragment(frag);
+}
+
+void TDataParser::PushDroppedFragment(const std::shared_ptr<TBadFragment>& frag)
+{
+   /// Pushes a fragment dropped by the fragment map to the bad output queue.
+   if(fDeferOutput) {
+      fDeferredOutput.emplace_back([frag](TDataParser& parser) { parser.PushDroppedFragment(frag); });
+      return;
+   }
+   fBadOutputQueue->Push(frag);
+}
+
+void TDataParser::TakeDeferredOutput(DeferredOutput& output)
+{
+   /// Moves the output recorded in deferred mode (since the last call) into output.
+   output = std::move(fDeferredOutput);
+   fDeferredOutput.clear();
+}
+
+void TDataParser::ReplayDeferredOutput(DeferredOutput& output)
+{
+   /// Pushes the output recorded by a parser in deferred mode through this parser, in the order it was recorded.
+   for(auto& action : output) {
+      action(*this);
+   }
+   output.clear();
+}
+
 std::string TDataParser::OutputQueueStatus()
 {
    std::stringstream ss;
@@ -1554,6 +1669,10 @@ int TDataParser::EPIXToScalar(float* data, int size, unsigned int midasSerialNum
       EXfrag->fName.push_back(TEpicsFrag::GetEpicsVariableName(x));
    }
 
-   fScalerOutputQueue->Push(EXfrag);
+   if(fDeferOutput) {
+      fDeferredOutput.emplace_back([EXfrag](TDataParser& parser) { parser.fScalerOutputQueue->Push(EXfrag); });
+   } else {
+      fScalerOutputQueue->Push(EXfrag);
+   }
    return NumFragsFound;
 }
@@ -1,13 +1,23 @@
 #include "TFragmentMap.h"
 
 #include <iterator>
+#include <utility>
+
+#include "TGRSIRandom.h"
 
 bool TFragmentMap::fDebug = false;
 
-TFragmentMap::TFragmentMap(
-   std::vector<std::shared_ptr<ThreadsafeQueue<std::shared_ptr<const TFragment>>>>& good_output_queue,
-   std::shared_ptr<ThreadsafeQueue<std::shared_ptr<const TBadFragment>>>&           bad_output_queue)
-   : fGoodOutputQueue(good_output_queue), fBadOutputQueue(bad_output_queue)
+namespace {
+/// adds a dither to the raw charge of a fragment, the dither only depends on the fragment if deterministic dithering is selected
+inline double DitheredCharge(const std::shared_ptr<TFragment>& frag, Int_t charge)
+{
+   return charge + TGRSIRandom::Dither(frag->GetAddress(), frag->GetTimeStamp(), charge, TGRSIRandom::kCharge);
+}
+} // namespace
+
+TFragmentMap::TFragmentMap(std::function<void(const std::shared_ptr<TFragment>&)>    good_output,
+                           std::function<void(const std::shared_ptr<TBadFragment>&)> bad_output)
+   : fGoodOutput(std::move(good_output)), fBadOutput(std::move(bad_output))
 {
 }
 
@@ -41,10 +51,7 @@ bool TFragmentMap::Add(std::shared_ptr<TFragment> frag, std::vector<Int_t> charg
             }
          }
       }
-      frag->SetEntryNumber();
-      for(const auto& outputQueue : fGoodOutputQueue) {
-         outputQueue->Push(frag);
-      }
+      fGoodOutput(frag);
       return true;
    }
    // check if this is the last fragment needed
@@ -118,10 +125,10 @@ bool TFragmentMap::Add(std::shared_ptr<TFragment> frag, std::vector<Int_t> charg
       int dropped = -1;
       for(size_t i = 0; i < std::get<1>((*(range.first)).second).size(); ++i) {
          if(k2[i] > 0) {
-            c.push_back((std::get<1>((*(range.first)).second)[i] + gRandom->Uniform()) / k2[i]);
+            c.push_back(DitheredCharge(std::get<0>((*(range.first)).second), std::get<1>((*(range.first)).second)[i]) / k2[i]);
             if(fDebug) {
                std::cout<<"2, "<<i<<std::hex<<": 0x"<<std::get<1>((*(range.first)).second)[i]<<"/0x"
-                        <<k2[i]<<std::dec<<" = "<<(std::get<1>((*(range.first)).second)[i] + gRandom->Uniform())
+                        <<k2[i]<<std::dec<<" = "<<DitheredCharge(std::get<0>((*(range.first)).second), std::get<1>((*(range.first)).second)[i])
                         <<"/"<<k2[i]<<" = "<<c.back()<<std::endl;
             }
          } else {
@@ -182,10 +189,10 @@ bool TFragmentMap::Add(std::shared_ptr<TFragment> frag, std::vector<Int_t> charg
          frags[1]->SetNumberOfPileups(-201);
          break;
       default: // dropped none
-         c.push_back((charge[0] + gRandom->Uniform()) / integrationLength[0]);
+         c.push_back(DitheredCharge(frag, charge[0]) / integrationLength[0]);
          if(fDebug) {
             std::cout<<std::hex<<"2, -: 0x"<<charge[0]<<"/0x"<<integrationLength[0]<<std::dec<<" = "
-                     <<(charge[0] + gRandom->Uniform())<<"/"<<integrationLength[0]<<" = "<<c.back()
+                     <<DitheredCharge(frag, charge[0])<<"/"<<integrationLength[0]<<" = "<<c.back()
                      <<std::endl;
          }
          // all k's are needed squared so we square all elements of k
@@ -232,10 +239,10 @@ bool TFragmentMap::Add(std::shared_ptr<TFragment> frag, std::vector<Int_t> charg
       std::vector<int> dropped;
       for(size_t i = 0; i < std::get<1>((*(range.first)).second).size(); ++i) {
          if(k2[i] > 0) {
-            c.push_back((std::get<1>((*(range.first)).second)[i] + gRandom->Uniform()) / k2[i]);
+            c.push_back(DitheredCharge(std::get<0>((*(range.first)).second), std::get<1>((*(range.first)).second)[i]) / k2[i]);
             if(fDebug) {
                std::cout<<"3, "<<i<<std::hex<<": 0x"<<std::get<1>((*(range.first)).second)[i]<<"/0x"
-                        <<k2[i]<<std::dec<<" = "<<(std::get<1>((*(range.first)).second)[i] + gRandom->Uniform())
+                        <<k2[i]<<std::dec<<" = "<<DitheredCharge(std::get<0>((*(range.first)).second), std::get<1>((*(range.first)).second)[i])
                         <<"/"<<k2[i]<<" = "<<c.back()<<std::endl;
             }
          } else {
@@ -247,11 +254,11 @@ bool TFragmentMap::Add(std::shared_ptr<TFragment> frag, std::vector<Int_t> charg
       }
       for(size_t i = 0; i < std::get<1>((*std::next(range.first)).second).size(); ++i) {
          if(k2[i + situation] > 0) {
-            c.push_back((std::get<1>((*std::next(range.first)).second)[i] + gRandom->Uniform()) / k2[i + situation]);
+            c.push_back(DitheredCharge(std::get<0>((*std::next(range.first)).second), std::get<1>((*std::next(range.first)).second)[i]) / k2[i + situation]);
             if(fDebug) {
                std::cout<<"3, "<<i + situation<<std::hex<<": 0x"
                         <<std::get<1>((*std::next(range.first)).second)[i]<<"/0x"<<k2[i + situation]<<std::dec
-                        <<" = "<<(std::get<1>((*std::next(range.first)).second)[i] + gRandom->Uniform())<<"/"
+                        <<" = "<<DitheredCharge(std::get<0>((*std::next(range.first)).second), std::get<1>((*std::next(range.first)).second)[i])<<"/"
                         <<k2[i + situation]<<" = "<<c.back()<<std::endl;
             }
          } else {
@@ -266,10 +273,10 @@ bool TFragmentMap::Add(std::shared_ptr<TFragment> frag, std::vector<Int_t> charg
       }
       switch(dropped.size()) {
       case 0: // dropped none
-         c.push_back((charge[0] + gRandom->Uniform()) / integrationLength[0]);
+         c.push_back(DitheredCharge(frag, charge[0]) / integrationLength[0]);
          if(fDebug) {
             std::cout<<std::hex<<"3, -: 0x"<<charge[0]<<"/0x"<<integrationLength[0]<<std::dec<<" = "
-                     <<(charge[0] + gRandom->Uniform())<<"/"<<integrationLength[0]<<" = "<<c.back()
+                     <<DitheredCharge(frag, charge[0])<<"/"<<integrationLength[0]<<" = "<<c.back()
                      <<std::endl;
          }
          // all k's are needed squared so we square all elements of k
@@ -327,18 +334,12 @@ bool TFragmentMap::Add(std::shared_ptr<TFragment> frag, std::vector<Int_t> charg
    // add all fragments to queue
    int i = 0;
    for(auto it = range.first; it != range.second; ++it) {
-      frag->SetEntryNumber();
-      for(const auto& outputQueue : fGoodOutputQueue) {
-         outputQueue->Push(std::get<0>((*it).second));
-      }
+      fGoodOutput(std::get<0>((*it).second));
       if(fDebug) {
          std::cout<<"Added "<<++i<<". fragment "<<std::get<0>((*it).second)<<std::endl;
       }
    }
-   frag->SetEntryNumber();
-   for(const auto& outputQueue : fGoodOutputQueue) {
-      outputQueue->Push(frag);
-   }
+   fGoodOutput(frag);
    if(fDebug) {
       std::cout<<"address "<<frag->GetAddress()<<": added last fragment "<<frag<<std::endl;
    }
@@ -452,7 +453,7 @@ void TFragmentMap::DropFragments(
    for(auto it = range.first; it != range.second; ++it) {
 		//(*it).second is a tuple, with the first element being a shared_ptr<TFragment>
 		//we need to convert this to a shared_ptr<TBadFragment>
-      fBadOutputQueue->Push(std::make_shared<TBadFragment>(*(std::get<0>((*it).second).get())));
+      fBadOutput(std::make_shared<TBadFragment>(*(std::get<0>((*it).second).get())));
       if(fDebug) {
          std::cout<<"Added bad fragment "<<std::get<0>((*it).second)<<std::endl;
       }
@@ -0,0 +1,91 @@
+#include "TFragmentPool.h"
+
+#include <sstream>
+
+void TFragmentPool::TRecycler::operator()(TFragment* frag) const
+{
+   std::lock_guard<std::mutex> lock(fFreeList->fMutex);
+   if(fFreeList->fClosed) {
+      delete frag;
+      return;
+   }
+   fFreeList->fFragments.push_back(frag);
+}
+
+TFragmentPool::TFragmentPool(size_t maxSize)
+   : fFreeList(std::make_shared<TFreeList>()), fSize(0), fMaxSize(maxSize), fRecycled(0), fCreated(0), fUnpooled(0)
+{
+}
+
+TFragmentPool::~TFragmentPool()
+{
+   /// Deletes all free fragments, the fragments still in use are deleted when their last user releases them.
+   std::lock_guard<std::mutex> lock(fFreeList->fMutex);
+   fFreeList->fClosed = true;
+   for(auto* frag : fFreeList->fFragments) {
+      delete frag;
+   }
+   fFreeList->fFragments.clear();
+   for(auto* frag : fAvailable) {
+      delete frag;
+   }
+   fAvailable.clear();
+}
+
+std::shared_ptr<TFragment> TFragmentPool::Get()
+{
+   /// Returns a free fragment of the pool. If no fragment has been released yet, a new one is created for the pool (or
+   /// just created if the pool is full). The free list is only locked once for all fragments released since the last
+   /// time we ran out.
+   if(fAvailable.empty() && fSize > 0) {
+      std::lock_guard<std::mutex> lock(fFreeList->fMutex);
+      fAvailable.swap(fFreeList->fFragments);
+   }
+
+   if(!fAvailable.empty()) {
+      TFragment* frag = fAvailable.back();
+      fAvailable.pop_back();
+      frag->Clear();
+      ++fRecycled;
+      return std::shared_ptr<TFragment>(frag, TRecycler{fFreeList});
+   }
+
+   if(fSize < fMaxSize) {
+      ++fSize;
+      ++fCreated;
+      return std::shared_ptr<TFragment>(new TFragment, TRecycler{fFreeList});
+   }
+
+   ++fUnpooled;
+   return std::make_shared<TFragment>();
+}
+
+std::shared_ptr<TFragment> TFragmentPool::Get(const TFragment& rhs)
+{
+   /// Returns a fragment from the pool that has been set to a copy of rhs (including the waveform).
+   std::shared_ptr<TFragment> frag = Get();
+   *frag                           = rhs;
+   frag->ClearTransients();
+   return frag;
+}
+
+void TFragmentPool::AddStatistics(const TFragmentPool& rhs)
+{
+   /// Adds the statistics of another pool (e.g. of another unpacking thread) to ours.
+   fRecycled += rhs.fRecycled;
+   fCreated += rhs.fCreated;
+   fUnpooled += rhs.fUnpooled;
+}
+
+std::string TFragmentPool::Status() const
+{
+   std::stringstream ss;
+   size_t            total = fRecycled + fCreated + fUnpooled;
+   ss<<"fragment pool: "<<total<<" fragments used, "<<fCreated<<" created for the pool, "<<fRecycled
+     <<" recycled, "<<fUnpooled<<" created outside the pool";
+   if(total > 0) {
+      ss<<" => "<<(100. * fRecycled) / total<<"% recycled";
+   }
+   ss<<std::endl;
+   return ss.str();
+}
@@ -149,10 +149,25 @@ void TDescant::AddFragment(const std::shared_ptr<const TFragment>& frag, TChanne
       return;
    }
 
-   TDescantHit hit(*frag);
+   // the waveforms are analyzed for all hits at once in BuildHits
+   TDescantHit hit(*frag, false);
    fDescantHits.push_back(std::move(hit));
 }
 
+void TDescant::BuildHits()
+{
+   /// Analyzes the waveforms of all hits of this event, re-using the buffers of this thread's workspace.
+   if(!TGRSIOptions::Get()->ExtractWaves()) {
+      return;
+   }
+   TWaveformKernels::TWorkspace& workspace = TWaveformKernels::ThreadWorkspace();
+   for(auto& hit : fDescantHits) {
+      if(!hit.GetWaveform()->empty()) {
+         hit.AnalyzeWaveform(workspace);
+      }
+   }
+}
+
 TVector3 TDescant::GetPosition(int DetNbr, double dist)
 {
    // Gets the position vector for detector DetNbr
@@ -9,6 +9,7 @@
 #include "TGRSIOptions.h"
 #include "TChannel.h"
 #include "GValue.h"
+#include "TWaveformKernels.h"
 
 /// \cond CLASSIMP
 ClassImp(TDescantHit)
@@ -28,7 +29,7 @@ TDescantHit::TDescantHit(const TDescantHit& rhs) : TGRSIDetectorHit()
    rhs.Copy(*this);
 }
 
-TDescantHit::TDescantHit(const TFragment& frag) : TGRSIDetectorHit(frag)
+TDescantHit::TDescantHit(const TFragment& frag, bool analyzeWaveform) : TGRSIDetectorHit(frag)
 {
    SetZc(frag.GetZc());
    SetCcShort(frag.GetCcShort());
@@ -69,7 +70,7 @@ TDescantHit::TDescantHit(const TFragment& frag) : TGRSIDetectorHit(frag)
       } else {
          frag.CopyWave(*this);
       }
-      if(!GetWaveform()->empty()) {
+      if(analyzeWaveform && !GetWaveform()->empty()) {
          // printf("Analyzing waveform, current cfd = %d, psd = %d\n",hit.GetCfd(),hit.GetPsd());
          AnalyzeWaveform();
          //          bool analyzed = hit.AnalyzeWaveform();
@@ -140,7 +141,7 @@ Int_t TDescantHit::GetRemainder() const
 
 Double_t TDescantHit::GetTime(const ETimeFlag&, Option_t*) const
 {
-   Double_t  dTime = GetTimeStamp() * 10. + GetRemainder() + (GetCfd() + gRandom->Uniform()) / 256.;
+   Double_t  dTime = GetTimeStamp() * 10. + GetRemainder() + (GetCfd() + Dither(TGRSIRandom::kCfd)) / 256.;
    TChannel* chan  = GetChannel();
    if(chan == nullptr) {
       Error("GetTime", "No TChannel exists for address 0x%08x", GetAddress());
@@ -179,49 +180,53 @@ void TDescantHit::Print(Option_t*) const
 
 bool TDescantHit::AnalyzeWaveform()
 {
-   bool error = false;
+   return AnalyzeWaveform(TWaveformKernels::ThreadWorkspace());
+}
 
+bool TDescantHit::AnalyzeWaveform(TWaveformKernels::TWorkspace& workspace)
+{
+   /// Corrects the baseline of the waveform and calculates cfd, psd, and charge from it. All intermediate results are
+   /// kept in the buffers of the workspace.
    if(fWaveform.empty()) {
       return false; // Error!
    }
-   std::vector<Int_t>   baselineCorrections(8, 0);
-   std::vector<Short_t> smoothedWaveform;
+   size_t size = fWaveform.size();
 
    // all timing algorithms use interpolation with this many steps between two samples (all times are stored as
    // integers)
    unsigned int interpolationSteps  = 256;
-   int          delay               = 8;
+   unsigned int delay               = 8;
    double       attenuation         = 24. / 64.;
-   int          halfSmoothingWindow = 0; // 2*halfsmoothingwindow + 1 = number of samples in moving window.
+   unsigned int halfSmoothingWindow = 0; // 2*halfsmoothingwindow + 1 = number of samples in moving window.
 
    // baseline algorithm: correct each adc with average of first two samples in that adc
-   for(size_t i = 0; i < 8 && i < fWaveform.size(); ++i) {
-      baselineCorrections[i] = fWaveform[i];
-   }
-   for(size_t i = 8; i < 16 && i < fWaveform.size(); ++i) {
-      baselineCorrections[i - 8] =
-         ((baselineCorrections[i - 8] + fWaveform[i]) + ((baselineCorrections[i - 8] + fWaveform[i]) > 0 ? 1 : -1)) >>
-         1; // Average
-   }
-   for(size_t i = 0; i < fWaveform.size(); ++i) {
-      fWaveform[i] -= baselineCorrections[i % 8];
-   }
+   TWaveformKernels::CorrectBaseline(fWaveform.data(), size);
 
-   SetCfd(CalculateCfd(attenuation, delay, halfSmoothingWindow, interpolationSteps));
+   size_t monitorSize = 0;
+   Int_t  cfd         = TWaveformKernels::Cfd(fWaveform.data(), size, attenuation, delay, halfSmoothingWindow,
+                                             interpolationSteps, workspace, &monitorSize);
+   if(TGRSIOptions::Get()->Debug()) {
+      const Short_t* monitor = workspace.Monitor(monitorSize);
+      fCfdMonitor.assign(monitor, monitor + monitorSize);
+   }
+   // correct for remainder between the 100MHz timestamp and the 125MHz start of the waveform
+   // we save this in the upper bits, otherwise we can't correct the waveform themselves
+   SetCfd((cfd & 0x3fffff) | (fCfd & 0x7c00000));
 
    // PSD
    // time to zero-crossing algorithm: time when sum reaches n% of the total sum minus the cfd time
-   double fraction = 0.90;
+   double fraction    = 0.90;
+   Int_t* partialSums = workspace.Sums(size);
+   TWaveformKernels::PartialSum(fWaveform.data(), size, partialSums);
+   if(TGRSIOptions::Get()->Debug()) {
+      fPartialSum.assign(partialSums, partialSums + size);
+   }
 
-   SetPsd(CalculatePsd(fraction, interpolationSteps));
+   SetPsd(TWaveformKernels::Psd(fWaveform.data(), partialSums, size, fraction, interpolationSteps));
 
-   SetCharge(CalculatePartialSum().back());
+   SetCharge(partialSums[size - 1]);
 
-   if(fPsd < 0) {
-      error = true;
-   }
-
-   return !(error);
+   return fPsd >= 0;
 }
 
 Int_t TDescantHit::CalculateCfd(double attenuation, unsigned int delay, int halfsmoothingwindow,
@@ -236,53 +241,17 @@ Int_t TDescantHit::CalculateCfd(double attenuation, unsigned int delay, int half
 Int_t TDescantHit::CalculateCfdAndMonitor(double attenuation, unsigned int delay, int halfSmoothingWindow,
                                           unsigned int interpolationSteps, std::vector<Short_t>& monitor)
 {
-
-   Short_t monitormax = 0;
-   bool    armed      = false;
-
-   Int_t cfd = 0;
    if(fWaveform.empty()) {
       return INT_MAX; // Error!
    }
-   std::vector<Short_t> smoothedWaveform;
-
-   if(fWaveform.size() > delay + 1) {
-      if(halfSmoothingWindow > 0) {
-         smoothedWaveform = TDescantHit::CalculateSmoothedWaveform(halfSmoothingWindow);
-      } else {
-         smoothedWaveform = fWaveform;
-      }
 
-      monitor.clear();
-      monitor.resize(smoothedWaveform.size() - delay);
-      monitor[0] = attenuation * smoothedWaveform[delay] - smoothedWaveform[0];
-      if(monitor[0] > monitormax) {
-         armed      = true;
-         monitormax = monitor[0];
-      }
-
-      for(size_t i = delay + 1; i < smoothedWaveform.size(); ++i) {
-         monitor[i - delay] = attenuation * smoothedWaveform[i] - smoothedWaveform[i - delay];
-         if(monitor[i - delay] > monitormax) {
-            armed      = true;
-            monitormax = monitor[i - delay];
-         } else {
-            if(armed && monitor[i - delay] < 0) {
-               armed = false;
-               if(monitor[i - delay - 1] - monitor[i - delay] != 0) {
-                  // Linear interpolation.
-                  cfd = (i - delay - 1) * interpolationSteps +
-                        (monitor[i - delay - 1] * interpolationSteps) / (monitor[i - delay - 1] - monitor[i - delay]);
-               } else {
-                  // Should be impossible, since monitor[i-delay-1] => 0 and monitor[i-delay] > 0
-                  cfd = 0;
-               }
-            }
-         }
-      }
-   } else {
-      monitor.resize(0);
-   }
+   TWaveformKernels::TWorkspace& workspace   = TWaveformKernels::ThreadWorkspace();
+   size_t                        monitorSize = 0;
+   Int_t cfd = TWaveformKernels::Cfd(fWaveform.data(), fWaveform.size(), attenuation, delay,
+                                     halfSmoothingWindow > 0 ? halfSmoothingWindow : 0, interpolationSteps, workspace,
+                                     &monitorSize);
+   const Short_t* monitorData = workspace.Monitor(monitorSize);
+   monitor.assign(monitorData, monitorData + monitorSize);
 
    if(TGRSIOptions::Get()->Debug()) {
       fCfdMonitor = monitor;
@@ -302,14 +271,9 @@ std::vector<Short_t> TDescantHit::CalculateSmoothedWaveform(unsigned int halfSmo
       return std::vector<Short_t>(); // Error!
    }
 
-   std::vector<Short_t> smoothedWaveform(std::max((static_cast<size_t>(0)), fWaveform.size() - 2 * halfSmoothingWindow),
-                                         0);
-
-   for(size_t i = halfSmoothingWindow; i < fWaveform.size() - halfSmoothingWindow; ++i) {
-      for(int j = -static_cast<int>(halfSmoothingWindow); j <= static_cast<int>(halfSmoothingWindow); ++j) {
-         smoothedWaveform[i - halfSmoothingWindow] += fWaveform[i + j];
-      }
-   }
+   std::vector<Short_t> smoothedWaveform(fWaveform.size(), 0);
+   smoothedWaveform.resize(
+      TWaveformKernels::Smooth(fWaveform.data(), fWaveform.size(), halfSmoothingWindow, smoothedWaveform.data()));
 
    return smoothedWaveform;
 }
@@ -329,11 +293,9 @@ std::vector<Short_t> TDescantHit::CalculateCfdMonitor(double attenuation, unsign
       smoothedWaveform = fWaveform;
    }
 
-   std::vector<Short_t> monitor(std::max((static_cast<size_t>(0)), smoothedWaveform.size() - delay), 0);
-
-   for(size_t i = delay; i < fWaveform.size(); ++i) {
-      monitor[i - delay] = attenuation * smoothedWaveform[i] - smoothedWaveform[i - delay];
-   }
+   std::vector<Short_t> monitor(smoothedWaveform.size(), 0);
+   monitor.resize(TWaveformKernels::CfdMonitor(smoothedWaveform.data(), smoothedWaveform.size(), attenuation, delay,
+                                               monitor.data()));
 
    return monitor;
 }
@@ -346,13 +308,7 @@ std::vector<Int_t> TDescantHit::CalculatePartialSum()
    }
 
    std::vector<Int_t> partialSums(fWaveform.size(), 0);
-
-   if(!fWaveform.empty()) {
-      partialSums[0] = fWaveform.at(0);
-      for(size_t i = 1; i < fWaveform.size(); ++i) {
-         partialSums[i] = partialSums[i - 1] + fWaveform[i];
-      }
-   }
+   TWaveformKernels::PartialSum(fWaveform.data(), fWaveform.size(), partialSums.data());
 
    if(TGRSIOptions::Get()->Debug()) {
       fPartialSum = partialSums;
@@ -371,24 +327,12 @@ Int_t TDescantHit::CalculatePsd(double fraction, unsigned int interpolationSteps
 Int_t TDescantHit::CalculatePsdAndPartialSums(double fraction, unsigned int interpolationSteps,
                                               std::vector<Int_t>& partialSums)
 {
-
-   Int_t psd = 0;
-
    partialSums = CalculatePartialSum();
    if(partialSums.empty()) {
       return -1;
    }
-   int totalSum = partialSums.back();
 
    fPsd = -1;
-   if(partialSums[0] < fraction * totalSum) {
-      for(size_t i = 1; i < partialSums.size(); ++i) {
-         if(partialSums[i] >= fraction * totalSum) {
-            psd = i * interpolationSteps - ((partialSums[i] - fraction * totalSum) * interpolationSteps) / fWaveform[i];
-            break;
-         }
-      }
-   }
 
-   return psd;
+   return TWaveformKernels::Psd(fWaveform.data(), partialSums.data(), partialSums.size(), fraction, interpolationSteps);
 }
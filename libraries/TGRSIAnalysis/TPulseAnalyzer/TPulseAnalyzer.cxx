@@ -1,6 +1,9 @@
 #include <utility>
+#include <algorithm>
+#include <mutex>
 
 #include "TPulseAnalyzer.h"
+#include "TWaveformKernels.h"
 
 /// \cond CLASSIMP
 ClassImp(TPulseAnalyzer)
@@ -54,6 +57,9 @@ void TPulseAnalyzer::Clear(Option_t*)
    memset(lineq_vector, 0, sizeof(lineq_vector));
    memset(lineq_solution, 0, sizeof(lineq_solution));
    memset(copy_matrix, 0, sizeof(copy_matrix));
+
+   cWindowSums.clear();
+   cWindowSumsSet = false;
 }
 
 void TPulseAnalyzer::SetData(const TFragment& fragment, double noise_fac)
@@ -68,8 +74,9 @@ void TPulseAnalyzer::SetData(const std::vector<Short_t>& wave, double noise_fac)
    SetCsI(false);
    cN = wave.size();
    if(cN > 0) {
-      cWavebuffer = wave;
-      set         = true;
+      cWavebuffer    = wave;
+      set            = true;
+      cWindowSumsSet = false;
       if(noise_fac > 0) {
          FILTER  = 8 * noise_fac;
          T0RANGE = 8 * noise_fac;
@@ -81,50 +88,163 @@ void TPulseAnalyzer::SetData(const std::vector<Short_t>& wave, double noise_fac)
 //	Linear Equation Solver
 ////////////////////////////////////////
 
-// "Very efficient" apparently, written by Kris S,
 // Solve the currently stored n dimentional linear eqaution
+// All fits set up symmetric normal equations, so we try a Cholesky decomposition first, and fall back to Gaussian
+// elimination with partial pivoting if the matrix is not symmetric positive definite.
+// Returns 0 if the matrix is singular.
 int TPulseAnalyzer::solve_lin_eq()
 {
-   memcpy(copy_matrix, lineq_matrix, sizeof(lineq_matrix));
-   long double w = determinant(lineq_dim);
-   if(w == 0.) {
+   if(lineq_dim < 1 || lineq_dim > 20) {
       return 0;
    }
+   bool symmetric = true;
+   for(int i = 0; i < lineq_dim && symmetric; i++) {
+      for(int j = 0; j < i; j++) {
+         if(lineq_matrix[i][j] != lineq_matrix[j][i]) {
+            symmetric = false;
+            break;
+         }
+      }
+   }
+   if(symmetric && solve_cholesky() == 1) {
+      return 1;
+   }
+   return solve_pivot();
+}
+
+// Solve via M = L*L^T, L is stored in the lower triangle of copy_matrix.
+// Returns 0 if M is not positive definite.
+int TPulseAnalyzer::solve_cholesky()
+{
+   for(int j = 0; j < lineq_dim; j++) {
+      long double d = lineq_matrix[j][j];
+      for(int k = 0; k < j; k++) {
+         d -= copy_matrix[j][k] * copy_matrix[j][k];
+      }
+      if(!(d > 0.)) {
+         return 0;
+      }
+      copy_matrix[j][j] = std::sqrt(d);
+      for(int i = j + 1; i < lineq_dim; i++) {
+         long double s = lineq_matrix[i][j];
+         for(int k = 0; k < j; k++) {
+            s -= copy_matrix[i][k] * copy_matrix[j][k];
+         }
+         copy_matrix[i][j] = s / copy_matrix[j][j];
+      }
+   }
+   // forward substitution L*y = v
    for(int i = 0; i < lineq_dim; i++) {
-      memcpy(copy_matrix, lineq_matrix, sizeof(lineq_matrix));
-      memcpy(copy_matrix[i], lineq_vector, sizeof(lineq_vector));
-      lineq_solution[i] = determinant(lineq_dim) / w;
+      long double s = lineq_vector[i];
+      for(int k = 0; k < i; k++) {
+         s -= copy_matrix[i][k] * lineq_solution[k];
+      }
+      lineq_solution[i] = s / copy_matrix[i][i];
+   }
+   // back substitution L^T*u = y
+   for(int i = lineq_dim - 1; i >= 0; i--) {
+      long double s = lineq_solution[i];
+      for(int k = i + 1; k < lineq_dim; k++) {
+         s -= copy_matrix[k][i] * lineq_solution[k];
+      }
+      lineq_solution[i] = s / copy_matrix[i][i];
    }
    return 1;
 }
 
-// solve the determinant of the currently stored copy_matrix for dimentions m
-long double TPulseAnalyzer::determinant(int m)
+// Solve via Gaussian elimination with partial pivoting on copy_matrix, the right hand side is eliminated in
+// lineq_solution. Returns 0 if the matrix is singular.
+int TPulseAnalyzer::solve_pivot()
 {
-   long double s;
-   if(m == 1) {
-      return copy_matrix[0][0];
-   }
-   if(copy_matrix[m - 1][m - 1] == 0.) {
-      int j = m - 1;
-      while(copy_matrix[m - 1][j] == 0 && j >= 0) {
-         j--;
+   int n = lineq_dim;
+   memcpy(copy_matrix, lineq_matrix, sizeof(lineq_matrix));
+   memcpy(lineq_solution, lineq_vector, sizeof(lineq_vector));
+   for(int j = 0; j < n; j++) {
+      int p = j;
+      for(int i = j + 1; i < n; i++) {
+         if(std::fabs(copy_matrix[i][j]) > std::fabs(copy_matrix[p][j])) {
+            p = i;
+         }
+      }
+      if(copy_matrix[p][j] == 0.) {
+         return 0;
       }
-      if(j < 0) {
-         return 0.;
+      if(p != j) {
+         for(int k = j; k < n; k++) {
+            std::swap(copy_matrix[p][k], copy_matrix[j][k]);
+         }
+         std::swap(lineq_solution[p], lineq_solution[j]);
       }
-      for(int i = 0; i < m; i++) {
-         s                     = copy_matrix[i][m - 1];
-         copy_matrix[i][m - 1] = copy_matrix[i][j];
-         copy_matrix[i][j]     = s;
+      for(int i = j + 1; i < n; i++) {
+         long double f = copy_matrix[i][j] / copy_matrix[j][j];
+         for(int k = j + 1; k < n; k++) {
+            copy_matrix[i][k] -= f * copy_matrix[j][k];
+         }
+         lineq_solution[i] -= f * lineq_solution[j];
       }
    }
-   for(int j = m - 2; j >= 0; j--) {
-      for(int i = 0; i < m; i++) {
-         copy_matrix[i][j] -= copy_matrix[i][m - 1] / copy_matrix[m - 1][m - 1] * copy_matrix[m - 1][j];
+   for(int i = n - 1; i >= 0; i--) {
+      long double s = lineq_solution[i];
+      for(int k = i + 1; k < n; k++) {
+         s -= copy_matrix[i][k] * lineq_solution[k];
       }
+      lineq_solution[i] = s / copy_matrix[i][i];
+   }
+   return 1;
+}
+
+// Calculate the prefix sums of the waveform, so that the normal equations of the line and parabola fits over any
+// window of samples are a difference of two entries instead of a loop over the window
+void TPulseAnalyzer::set_window_sums()
+{
+   cWindowSums.resize(cN + 1);
+   memset(&cWindowSums[0], 0, sizeof(WindowSums));
+   for(int i = 0; i < cN; i++) {
+      const WindowSums& prev = cWindowSums[i];
+      WindowSums&       next = cWindowSums[i + 1];
+      long double       x    = i;
+      long double       y    = cWavebuffer[i];
+      next.x[0]              = prev.x[0] + 1;
+      next.x[1]              = prev.x[1] + x;
+      next.x[2]              = prev.x[2] + x * x;
+      next.x[3]              = prev.x[3] + x * x * x;
+      next.x[4]              = prev.x[4] + x * x * x * x;
+      next.y[0]              = prev.y[0] + y;
+      next.y[1]              = prev.y[1] + y * x;
+      next.y[2]              = prev.y[2] + y * x * x;
+      next.y2                = prev.y2 + y * y;
+   }
+   cWindowSumsSet = true;
+}
+
+// Get the sums over the samples low to high-1 (limited to the waveform), with i counted from origin
+// All sums are integers well below 2^64, so they (and the shift to the origin) are exact in long double
+void TPulseAnalyzer::get_window_sums(int low, int high, WindowSums& ws, int origin)
+{
+   low  = std::min(std::max(low, 0), cN);
+   high = std::min(std::max(high, low), cN);
+   if(!cWindowSumsSet) {
+      set_window_sums();
+   }
+   const WindowSums& l = cWindowSums[low];
+   const WindowSums& h = cWindowSums[high];
+   for(int k = 0; k < 5; k++) {
+      ws.x[k] = h.x[k] - l.x[k];
+   }
+   for(int k = 0; k < 3; k++) {
+      ws.y[k] = h.y[k] - l.y[k];
+   }
+   ws.y2 = h.y2 - l.y2;
+   if(origin != 0) {
+      long double o  = origin;
+      long double o2 = o * o;
+      ws.x[4] += -4. * o * ws.x[3] + 6. * o2 * ws.x[2] - 4. * o2 * o * ws.x[1] + o2 * o2 * ws.x[0];
+      ws.x[3] += -3. * o * ws.x[2] + 3. * o2 * ws.x[1] - o2 * o * ws.x[0];
+      ws.x[2] += -2. * o * ws.x[1] + o2 * ws.x[0];
+      ws.x[1] -= o * ws.x[0];
+      ws.y[2] += -2. * o * ws.y[1] + o2 * ws.y[0];
+      ws.y[1] -= o * ws.y[0];
    }
-   return copy_matrix[m - 1][m - 1] * determinant(m - 1);
 }
 
 ////////////////////////////////////////
@@ -133,34 +253,31 @@ long double TPulseAnalyzer::determinant(int m)
 
 int TPulseAnalyzer::fit_smooth_parabola(int low, int high, double x0, ParPar* pp)
 {
-   int    i, ndf, k;
-   double chisq;
-   double x;
+   int         ndf, k;
+   double      chisq;
+   long double x, x2;
+   WindowSums  flat, rise;
    memset(pp, 0, sizeof(ParPar));
    memset(lineq_matrix, 0, sizeof(lineq_matrix));
    memset(lineq_vector, 0, sizeof(lineq_vector));
    lineq_dim = 2;
-   chisq     = 0.;
-   ndf       = 0;
    k         = static_cast<int>(rint(x0));
 
-   for(i = low; i < k; i++) {
-      lineq_matrix[0][0] += 1;
-      lineq_vector[0] += cWavebuffer[i];
-      ndf++;
-      chisq += cWavebuffer[i] * cWavebuffer[i];
-   }
-
-   for(i = k; i < high; i++) {
-      x = (i - x0) * (i - x0);
-      lineq_matrix[0][0] += 1;
-      lineq_matrix[0][1] += x;
-      lineq_matrix[1][1] += x * x;
-      lineq_vector[0] += cWavebuffer[i];
-      lineq_vector[1] += cWavebuffer[i] * x;
-      ndf++;
-      chisq += cWavebuffer[i] * cWavebuffer[i];
-   }
+   // constant from low to k, constant + quadratic*(i-x0)^2 from k to high
+   // the sums for the rise are counted from k, so that (i-x0) = (i-k) + x with |x| <= 0.5
+   get_window_sums(low, k, flat);
+   get_window_sums(k, high, rise, k);
+   x  = k - x0;
+   x2 = x * x;
+
+   lineq_matrix[0][0] = flat.x[0] + rise.x[0];
+   lineq_matrix[0][1] = rise.x[2] + 2. * x * rise.x[1] + x2 * rise.x[0];
+   lineq_matrix[1][1] =
+      rise.x[4] + 4. * x * rise.x[3] + 6. * x2 * rise.x[2] + 4. * x2 * x * rise.x[1] + x2 * x2 * rise.x[0];
+   lineq_vector[0] = flat.y[0] + rise.y[0];
+   lineq_vector[1] = rise.y[2] + 2. * x * rise.y[1] + x2 * rise.y[0];
+   ndf             = static_cast<int>(flat.x[0] + rise.x[0]);
+   chisq           = flat.y2 + rise.y2;
    lineq_matrix[1][0] = lineq_matrix[0][1];
 
    if(solve_lin_eq() == 0) {
@@ -271,26 +388,24 @@ double TPulseAnalyzer::fit_newT0()
 /*================================================================*/
 int TPulseAnalyzer::fit_parabola(int low, int high, ParPar* pp)
 {
-   int    i, ndf;
-   double chisq;
+   int        ndf;
+   double     chisq;
+   WindowSums ws;
    memset(pp, 0, sizeof(ParPar));
    memset(lineq_matrix, 0, sizeof(lineq_matrix));
    memset(lineq_vector, 0, sizeof(lineq_vector));
    lineq_dim = 3;
-   chisq     = 0.;
-   ndf       = 0;
-   for(i = low; i < high; i++) {
-      lineq_matrix[0][0] += 1;
-      lineq_matrix[0][1] += i;
-      lineq_matrix[0][2] += i * i;
-      lineq_matrix[1][2] += i * i * i;
-      lineq_matrix[2][2] += i * i * i * i;
-      lineq_vector[0] += cWavebuffer[i];
-      lineq_vector[1] += cWavebuffer[i] * i;
-      lineq_vector[2] += cWavebuffer[i] * i * i;
-      ndf++;
-      chisq += cWavebuffer[i] * cWavebuffer[i];
-   }
+   get_window_sums(low, high, ws);
+   lineq_matrix[0][0] = ws.x[0];
+   lineq_matrix[0][1] = ws.x[1];
+   lineq_matrix[0][2] = ws.x[2];
+   lineq_matrix[1][2] = ws.x[3];
+   lineq_matrix[2][2] = ws.x[4];
+   lineq_vector[0]    = ws.y[0];
+   lineq_vector[1]    = ws.y[1];
+   lineq_vector[2]    = ws.y[2];
+   ndf                = static_cast<int>(ws.x[0]);
+   chisq              = ws.y2;
    lineq_matrix[1][0] = lineq_matrix[0][1];
    lineq_matrix[1][1] = lineq_matrix[0][2];
    lineq_matrix[2][0] = lineq_matrix[0][2];
@@ -313,23 +428,21 @@ int TPulseAnalyzer::fit_parabola(int low, int high, ParPar* pp)
 /*================================================================*/
 int TPulseAnalyzer::fit_line(int low, int high, LinePar* lp)
 {
-   int    i, ndf;
-   double chisq;
+   int        ndf;
+   double     chisq;
+   WindowSums ws;
    memset(lp, 0, sizeof(LinePar));
    memset(lineq_matrix, 0, sizeof(lineq_matrix));
    memset(lineq_vector, 0, sizeof(lineq_vector));
    lineq_dim = 2;
-   chisq     = 0.;
-   ndf       = 0;
-   for(i = low; i < high; i++) {
-      lineq_matrix[0][0] += 1;
-      lineq_matrix[0][1] += i;
-      lineq_matrix[1][1] += i * i;
-      lineq_vector[0] += cWavebuffer[i];
-      lineq_vector[1] += cWavebuffer[i] * i;
-      ndf++;
-      chisq += cWavebuffer[i] * cWavebuffer[i];
-   }
+   get_window_sums(low, high, ws);
+   lineq_matrix[0][0] = ws.x[0];
+   lineq_matrix[0][1] = ws.x[1];
+   lineq_matrix[1][1] = ws.x[2];
+   lineq_vector[0]    = ws.y[0];
+   lineq_vector[1]    = ws.y[1];
+   ndf                = static_cast<int>(ws.x[0]);
+   chisq              = ws.y2;
    lineq_matrix[1][0] = lineq_matrix[0][1];
 
    if(solve_lin_eq() == 0) {
@@ -522,10 +635,11 @@ void TPulseAnalyzer::get_baseline()
       exit(0);
    }
 
-   for(int i = 0; i < cWpar->baseline_range; i++) {
-      cWpar->baseline += cWavebuffer[i];
-      cWpar->baselineStDev += cWavebuffer[i] * cWavebuffer[i];
-   }
+   Long64_t sum          = 0;
+   Long64_t sumOfSquares = 0;
+   TWaveformKernels::Moments(cWavebuffer.data(), cWpar->baseline_range, sum, sumOfSquares);
+   cWpar->baseline      = sum;
+   cWpar->baselineStDev = sumOfSquares;
 
    cWpar->baselineStDev /= cWpar->baseline_range;
    cWpar->baseline /= cWpar->baseline_range;
@@ -548,10 +662,11 @@ void TPulseAnalyzer::get_baseline_fin()
 
    // error if waveform length cN is shorter than baseline range
    if(cN > tb && tb > 0) {
-      for(int i = 0; i < tb; i++) {
-         cWpar->baselinefin += cWavebuffer[i];
-         cWpar->baselineStDevfin += cWavebuffer[i] * cWavebuffer[i];
-      }
+      Long64_t sum          = 0;
+      Long64_t sumOfSquares = 0;
+      TWaveformKernels::Moments(cWavebuffer.data(), tb, sum, sumOfSquares);
+      cWpar->baselinefin      = sum;
+      cWpar->baselineStDevfin = sumOfSquares;
 
       cWpar->baselineStDevfin /= tb;
       cWpar->baselinefin /= tb;
@@ -565,20 +680,23 @@ void TPulseAnalyzer::get_baseline_fin()
 // Find the maximum of the wavefunction, smoothed with a moving average filter
 void TPulseAnalyzer::get_tmax()
 {
-   int i, j, sum;
+   int i, sum;
    int D = FILTER / 2;
 
    cWpar->max  = cWavebuffer[0];
    cWpar->tmax = 0;
 
-   // applies the filter to the waveform
+   if(D <= 0 || cN <= 2 * D) {
+      cWpar->mflag = 1; // nothing to filter
+      return;
+   }
+
+   // applies the filter to the waveform, sums[i - D] is the sum of the samples i - D to i + D - 1
+   Int_t* sums = TWaveformKernels::ThreadWorkspace().Sums(cN);
+   TWaveformKernels::RunningSum(cWavebuffer.data(), cN, 2 * D, sums);
    //     cout<<" "<<cWpar->tmax<<" "<< cWpar->max<<flush;
    for(i = D; i < cN - D; i++) {
-      sum = 0;
-      for(j = i - D; j < i + D; j++) {
-         sum += cWavebuffer[j];
-      }
-      sum /= FILTER; // the value of the filtered waveform at i
+      sum = sums[i - D] / FILTER; // the value of the filtered waveform at i
       if(sum > cWpar->max) {
          // if the value of the filtered waveform at i is larger than the current maximum, max=value and tmax = i
          cWpar->max  = sum;
@@ -1516,6 +1634,10 @@ bool TPulseAnalyzer::GetSiliShape(double tauDecay,double tauRise){if(IsSet()){
 //Needs initial estimates even if fitting those parameters
 //Setting basefreq>0 opens a very experimental/bad mode
 bool TPulseAnalyzer::GetSiliShapeTF1(double tauDecay,double tauRise,double baseline,double basefreq){
+// the default minimizer (TMinuit) isn't reentrant, so only one of these fits runs at a time (hits can be fitted by
+// several detector building or waveform fitting threads)
+static std::mutex fitMutex;
+std::lock_guard<std::mutex> fitLock(fitMutex);
 TGraph* h=GetWaveGraph();if(h){//Graph better than hist for stats and simplicity 
 	
 	SiliShapePrepare(tauDecay,tauRise);
@@ -1594,7 +1716,7 @@ double TPulseAnalyzer::SiLiFitFunction(double *i,double *p){
 
 TF1  TPulseAnalyzer::Getsilifit(){
 	if(set&&cWpar){
-		std::stringstream ss;ss<<"Fit"<<nameiter;++nameiter;
+		std::stringstream ss;ss<<"Fit"<<nameiter++;
 		TF1 g(ss.str().c_str(),SiLiFitFunction,0,cN,8);
 		
 		g.SetParameter(0,cWpar->t0);
@@ -1650,15 +1772,14 @@ void TPulseAnalyzer::DrawWave()
    }
 }
 
-int   TPulseAnalyzer::nameiter = 0;
+std::atomic<int> TPulseAnalyzer::nameiter(0);
 TH1I* TPulseAnalyzer::GetWaveHist()
 {
    if(cN == 0 || !set) {
       return nullptr;
    }
    std::stringstream ss;
-   ss<<"WaveformHist"<<nameiter;
-   ++nameiter; // Avoid naming conflicts with TNamed
+   ss<<"WaveformHist"<<nameiter++; // Avoid naming conflicts with TNamed
    TH1I* h = new TH1I(ss.str().c_str(), ss.str().c_str(), cN, -0.5,
                       cN - 0.5); // midpoint should be the value, else time is off
    for(Int_t i = 0; i < cN; i++) {
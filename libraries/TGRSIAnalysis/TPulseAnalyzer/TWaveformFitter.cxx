@@ -0,0 +1,109 @@
+#include "TWaveformFitter.h"
+
+#include "TROOT.h"
+
+#include "TPulseAnalyzer.h"
+
+namespace {
+std::atomic<int> gNofFitters(0); ///< number of TWaveformFitters that currently exist
+}
+
+TWaveformFitter::TWaveformFitter(int nofThreads)
+   : fNextJob(0), fAnalyzer(new TPulseAnalyzer), fGeneration(0), fBusy(0), fStop(false)
+{
+   ++gNofFitters;
+   if(nofThreads > 0) {
+      // the SiLi fits can fall back to a TF1 fit, ROOT's global lists need protecting then (the fit itself is
+      // serialized in TPulseAnalyzer::GetSiliShapeTF1)
+      ROOT::EnableThreadSafety();
+   }
+   for(int i = 0; i < nofThreads; ++i) {
+      fWorkers.emplace_back(&TWaveformFitter::FittingThread, this);
+   }
+}
+
+TWaveformFitter::~TWaveformFitter()
+{
+   {
+      std::lock_guard<std::mutex> lock(fMutex);
+      fStop = true;
+   }
+   fStart.notify_all();
+   for(auto& worker : fWorkers) {
+      worker.join();
+   }
+   delete fAnalyzer;
+   --gNofFitters;
+}
+
+bool TWaveformFitter::DeferFits()
+{
+   return gNofFitters.load() > 0;
+}
+
+void TWaveformFitter::AddFit(const std::vector<Short_t>* waveform, std::function<void(TPulseAnalyzer&)> fit,
+                             double noiseFactor)
+{
+   fJobs.push_back(TFitJob{waveform, std::move(fit), noiseFactor});
+}
+
+void TWaveformFitter::Fit()
+{
+   /// Hands the fits to the fitting threads, helps fitting, and waits until all fits are done.
+   if(fJobs.empty()) {
+      return;
+   }
+   fNextJob = 0;
+   if(!fWorkers.empty()) {
+      std::lock_guard<std::mutex> lock(fMutex);
+      ++fGeneration;
+      fBusy = fWorkers.size();
+   }
+   fStart.notify_all();
+
+   FitJobs(*fAnalyzer);
+
+   if(!fWorkers.empty()) {
+      std::unique_lock<std::mutex> lock(fMutex);
+      fDone.wait(lock, [this] { return fBusy == 0; });
+   }
+   fJobs.clear();
+}
+
+void TWaveformFitter::FitJobs(TPulseAnalyzer& analyzer)
+{
+   /// Fits jobs until there are none left, the analyzer is re-used for all of them.
+   size_t nofJobs = fJobs.size();
+   for(size_t i = fNextJob++; i < nofJobs; i = fNextJob++) {
+      TFitJob& job = fJobs[i];
+      analyzer.Clear();
+      analyzer.SetData(*job.fWaveform, job.fNoiseFactor);
+      if(analyzer.IsSet()) {
+         job.fFit(analyzer);
+      }
+   }
+}
+
+void TWaveformFitter::FittingThread()
+{
+   /// Waits for a new block of fits, fits jobs until there are none left, and reports back.
+   TPulseAnalyzer analyzer;
+   size_t         generation = 0;
+   while(true) {
+      {
+         std::unique_lock<std::mutex> lock(fMutex);
+         fStart.wait(lock, [this, generation] { return fStop || fGeneration != generation; });
+         if(fStop) {
+            return;
+         }
+         generation = fGeneration;
+      }
+      FitJobs(analyzer);
+      {
+         std::lock_guard<std::mutex> lock(fMutex);
+         if(--fBusy == 0) {
+            fDone.notify_one();
+         }
+      }
+   }
+}
@@ -5,6 +5,7 @@
 #include "TMath.h"
 
 #include "TGRSIOptions.h"
+#include "TGRSIRandom.h"
 
 /// \cond CLASSIMP
 ClassImp(TS3)
@@ -355,9 +356,9 @@ TVector3 TS3::GetPosition(int ring, int sector, double offsetphi, double offsetZ
    if(smear) {
       double sep = ring_width * 0.025;
       double r1 = radius - ring_width * 0.5 + sep, r2 = radius + ring_width * 0.5 - sep;
-      radius        = sqrt(gRandom->Uniform(r1 * r1, r2 * r2));
+      radius        = sqrt(TGRSIRandom::Uniform(r1 * r1, r2 * r2));
       double sepphi = sep / radius;
-      phi           = gRandom->Uniform(phi - phi_width * 0.5 + sepphi, phi + phi_width * 0.5 - sepphi);
+      phi           = TGRSIRandom::Uniform(phi - phi_width * 0.5 + sepphi, phi + phi_width * 0.5 - sepphi);
    }
 
    return TVector3(cos(phi) * radius, sin(phi) * radius, offsetZ);
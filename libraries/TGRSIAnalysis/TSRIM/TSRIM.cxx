@@ -6,11 +6,15 @@
 #include <TVector3.h>
 #include <TMath.h>
 
+#include <algorithm>
 #include <cmath>
+#include <iomanip>
 #include <sstream>
 #include <TStopwatch.h>
 
 #include <cstdio>
+#include <cstring>
+#include <limits>
 
 /// \cond CLASSIMP
 ClassImp(TSRIM)
@@ -52,6 +56,7 @@ void TSRIM::ReadEnergyLossFile(const char* filename, double emax, double emin, b
       printf("{TSRIM} Warning : Couldn't find the file '%s' ..\n", filename);
       return;
    }
+   fFileName = buf;
    std::string line;
    std::string word;
    double      density_scale = 0.;
@@ -189,6 +194,14 @@ void TSRIM::ReadEnergyLossFile(const char* filename, double emax, double emin, b
       fEgetX->GetXaxis()->SetTitle("Energy (keV)");
       sEgetX = new TSpline3(Form("%s_Espline", filename), fEgetX);
       sEgetX->SetName(Form("%s_Espline", filename));
+
+      // use the energy table saved next to the energy loss file (see WriteEnergyTable), if there is one
+      ClearEnergyTable();
+      std::ifstream tableFile(TableFileName(nullptr).c_str());
+      if(tableFile.good()) {
+         tableFile.close();
+         ReadEnergyTable(nullptr, printfile);
+      }
    }
 
    if(printfile) {
@@ -215,8 +228,20 @@ double TSRIM::GetEnergy(double energy, double dist)
    return sXgetE->Eval(xbegin + dist);
 }
 
-// THIS FUNCTION DOES A MORE ACCURATE ENERGY LOSS CALCULATION BASED ON SMALL EXTRAPOLATIONS
 double TSRIM::GetAdjustedEnergy(double energy, double thickness, double stepsize)
+{
+   /// Returns the energy left after passing through thickness (um) with the initial energy (keV). If an energy table
+   /// calculated with the same step size covers energy and thickness it is interpolated from the table, otherwise the
+   /// energy loss is integrated in steps of stepsize.
+   if(HasEnergyTable() && stepsize == fTableStepSize && energy >= 0. && energy <= fTableEmax && thickness >= 0. &&
+      thickness <= fTableXmax) {
+      return GetTableEnergy(energy, thickness);
+   }
+   return GetSteppedEnergy(energy, thickness, stepsize);
+}
+
+// THIS FUNCTION DOES A MORE ACCURATE ENERGY LOSS CALCULATION BASED ON SMALL EXTRAPOLATIONS
+double TSRIM::GetSteppedEnergy(double energy, double thickness, double stepsize)
 {
    if(fEnergyLoss == nullptr) {
       printf("energy loss file has not yet been read in.\n");
@@ -245,3 +270,260 @@ double TSRIM::GetAdjustedEnergy(double energy, double thickness, double stepsize
 
    return energy_temp;
 }
+
+void TSRIM::MakeEnergyTable(double emax, double xmax, int nEnergy, int nThickness, double stepsize)
+{
+   /// Calculates the energy left after 0 to xmax um (in nThickness intervals) for initial energies from 0 to emax keV
+   /// (in nEnergy intervals). Each initial energy is stepped through the whole thickness once, with steps of at most
+   /// stepsize, so if xmax/nThickness is a multiple of stepsize the table is identical to GetAdjustedEnergy at the grid
+   /// points. Afterwards GetAdjustedEnergy (with the same stepsize) interpolates this table instead of stepping.
+   if(fEnergyLoss == nullptr) {
+      printf("energy loss file has not yet been read in.\n");
+      return;
+   }
+   if(emax <= 0. || xmax <= 0. || nEnergy < 1 || nThickness < 1 || stepsize <= 0.) {
+      printf("{TSRIM} Warning: can't make energy table for emax = %f keV, xmax = %f um, %d x %d points, and step size "
+             "%f um\n",
+             emax, xmax, nEnergy, nThickness, stepsize);
+      return;
+   }
+
+   ClearEnergyTable();
+   double xbin   = xmax / nThickness;
+   int    nSteps = static_cast<int>(std::ceil(xbin / stepsize - 1e-9));
+   double xstep  = xbin / nSteps;
+
+   fEnergyTable.resize((nEnergy + 1) * (nThickness + 1));
+   for(int i = 0; i <= nEnergy; ++i) {
+      double* row    = &fEnergyTable[i * (nThickness + 1)];
+      double  energy = emax * i / nEnergy;
+      row[0]         = energy;
+      for(int j = 1; j <= nThickness; ++j) {
+         for(int step = 0; step < nSteps && energy > 0.; ++step) {
+            energy -= xstep * sEnergyLoss->Eval(energy);
+         }
+         if(energy <= 0.) {
+            energy = 0.; // if no energy is remaining then final energy is zero
+         }
+         row[j] = energy;
+      }
+   }
+
+   fTableEmax       = emax;
+   fTableXmax       = xmax;
+   fTableStepSize   = stepsize;
+   fTableNEnergy    = nEnergy;
+   fTableNThickness = nThickness;
+}
+
+double TSRIM::GetTableEnergy(double energy, double thickness) const
+{
+   /// Returns the energy left after passing through thickness (um) with the initial energy (keV), bilinearly
+   /// interpolated from the energy table. Energies and thicknesses outside of the table are moved to its edge.
+   if(!HasEnergyTable()) {
+      printf("energy table has not yet been made or read in.\n");
+      return 0.0;
+   }
+
+   double ebin = std::min(std::max(energy / fTableEmax * fTableNEnergy, 0.), static_cast<double>(fTableNEnergy));
+   double xbin = std::min(std::max(thickness / fTableXmax * fTableNThickness, 0.), static_cast<double>(fTableNThickness));
+   int    i    = std::min(static_cast<int>(ebin), fTableNEnergy - 1);
+   int    j    = std::min(static_cast<int>(xbin), fTableNThickness - 1);
+   ebin -= i;
+   xbin -= j;
+
+   const double* low  = &fEnergyTable[i * (fTableNThickness + 1) + j];
+   const double* high = low + fTableNThickness + 1;
+   double        lowEnergy  = low[0] + xbin * (low[1] - low[0]);
+   double        highEnergy = high[0] + xbin * (high[1] - high[0]);
+
+   return lowEnergy + ebin * (highEnergy - lowEnergy);
+}
+
+double TSRIM::CheckEnergyTable(int nEnergy, int nThickness, bool print)
+{
+   /// Compares the energy table to the stepped calculation of GetAdjustedEnergy (with the step size of the table) on a
+   /// grid of nEnergy x nThickness points. The points are placed in the centres of the table cells, where the
+   /// interpolation is worst. Returns the largest difference in keV.
+   if(!HasEnergyTable() || nEnergy < 1 || nThickness < 1) {
+      printf("energy table has not yet been made or read in.\n");
+      return -1.;
+   }
+
+   double maxDiff   = 0.;
+   double sumDiff   = 0.;
+   double maxEnergy = 0.;
+   double maxX      = 0.;
+   for(int i = 0; i < nEnergy; ++i) {
+      // centre of the table cell at the i-th of nEnergy evenly spaced energies
+      double energy = fTableEmax * ((i * fTableNEnergy) / nEnergy + 0.5) / fTableNEnergy;
+      for(int j = 0; j < nThickness; ++j) {
+         double thickness = fTableXmax * ((j * fTableNThickness) / nThickness + 0.5) / fTableNThickness;
+         double diff = std::fabs(GetTableEnergy(energy, thickness) - GetSteppedEnergy(energy, thickness, fTableStepSize));
+         sumDiff += diff;
+         if(diff > maxDiff) {
+            maxDiff   = diff;
+            maxEnergy = energy;
+            maxX      = thickness;
+         }
+      }
+   }
+
+   if(print) {
+      printf("{TSRIM} energy table (%d x %d points, 0 - %.03f keV, 0 - %.03f um) vs. steps of %.03f um:\n",
+             fTableNEnergy + 1, fTableNThickness + 1, fTableEmax, fTableXmax, fTableStepSize);
+      printf("\tmean difference %.03f keV, max. difference %.03f keV at %.03f keV and %.03f um\n",
+             sumDiff / (nEnergy * nThickness), maxDiff, maxEnergy, maxX);
+   }
+
+   return maxDiff;
+}
+
+std::string TSRIM::SourceSignature() const
+{
+   /// Returns the size and the FNV-1a hash of the energy loss file that was read in, which are stored with the energy
+   /// table to recognize a table that was calculated from a different (or changed) file. Empty if the file can't be
+   /// read.
+   std::ifstream infile(fFileName.c_str(), std::ios::binary);
+   if(fFileName.empty() || !infile.good()) {
+      return std::string();
+   }
+   unsigned long long hash = 14695981039346656037ULL;
+   long               size = 0;
+   char               buffer[4096];
+   while(infile.read(buffer, sizeof(buffer)) || infile.gcount() > 0) {
+      for(std::streamsize i = 0; i < infile.gcount(); ++i) {
+         hash ^= static_cast<unsigned char>(buffer[i]);
+         hash *= 1099511628211ULL;
+      }
+      size += infile.gcount();
+   }
+   std::stringstream str;
+   str<<size<<" "<<std::hex<<std::setw(16)<<std::setfill('0')<<hash;
+   return str.str();
+}
+
+std::string TSRIM::TableFileName(const char* filename) const
+{
+   /// Returns filename, or if that is empty the name of the energy loss file with ".txt" replaced by ".table".
+   if(filename != nullptr && strlen(filename) > 0) {
+      return std::string(filename);
+   }
+   std::string fname = fFileName;
+   if(fname.size() > 4 && fname.compare(fname.size() - 4, 4, ".txt") == 0) {
+      fname.erase(fname.size() - 4);
+   }
+   return fname.append(".table");
+}
+
+bool TSRIM::WriteEnergyTable(const char* filename) const
+{
+   /// Writes the energy table to filename, by default next to the energy loss file it was calculated from, where
+   /// ReadEnergyLossFile will pick it up.
+   if(!HasEnergyTable()) {
+      printf("energy table has not yet been made or read in.\n");
+      return false;
+   }
+   std::string signature = SourceSignature();
+   if(signature.empty()) {
+      printf("{TSRIM} Warning : Couldn't read the energy loss file '%s' ..\n", fFileName.c_str());
+      return false;
+   }
+   std::string   fname = TableFileName(filename);
+   std::ofstream outfile(fname.c_str());
+   if(!outfile.good()) {
+      printf("{TSRIM} Warning : Couldn't open the file '%s' for writing ..\n", fname.c_str());
+      return false;
+   }
+
+   outfile<<"# energy (keV) after thickness (um)"<<std::endl
+          <<"# energy loss file it was calculated from, and its size and hash"<<std::endl
+          <<fFileName<<std::endl
+          <<signature<<std::endl
+          <<"# max. energy, max. thickness, energy intervals, thickness intervals, step size"<<std::endl
+          <<std::setprecision(12)<<fTableEmax<<" "<<fTableXmax<<" "<<fTableNEnergy<<" "<<fTableNThickness<<" "
+          <<fTableStepSize<<std::endl;
+   for(int i = 0; i <= fTableNEnergy; ++i) {
+      for(int j = 0; j <= fTableNThickness; ++j) {
+         outfile<<(j == 0 ? "" : " ")<<fEnergyTable[i * (fTableNThickness + 1) + j];
+      }
+      outfile<<std::endl;
+   }
+
+   return outfile.good();
+}
+
+bool TSRIM::ReadEnergyTable(const char* filename, bool printfile)
+{
+   /// Reads an energy table written by WriteEnergyTable, by default from next to the energy loss file. The table is
+   /// rejected if it wasn't calculated from the energy loss file that was read in (same path, size, and hash).
+   std::string   fname = TableFileName(filename);
+   std::ifstream infile(fname.c_str());
+   if(!infile.good()) {
+      printf("{TSRIM} Warning : Couldn't find the file '%s' ..\n", fname.c_str());
+      return false;
+   }
+
+   ClearEnergyTable();
+   std::string source;
+   std::string signature;
+   // after the comments at the top come the energy loss file and its signature
+   while(infile.peek() == '#') {
+      infile.ignore(std::numeric_limits<std::streamsize>::max(), '\n');
+   }
+   std::getline(infile, source);
+   std::getline(infile, signature);
+   if(source != fFileName || signature.empty() || signature != SourceSignature()) {
+      printf("{TSRIM} Warning : energy table '%s' was not calculated from the energy loss file '%s' (or the file has "
+             "changed), please make a new one using MakeEnergyTable ..\n",
+             fname.c_str(), fFileName.c_str());
+      return false;
+   }
+
+   // skip the comments before the parameters
+   while(infile.peek() == '#') {
+      infile.ignore(std::numeric_limits<std::streamsize>::max(), '\n');
+   }
+
+   double emax, xmax, stepsize;
+   int    nEnergy, nThickness;
+   infile>>emax>>xmax>>nEnergy>>nThickness>>stepsize;
+   if(infile.fail() || emax <= 0. || xmax <= 0. || nEnergy < 1 || nThickness < 1 || stepsize <= 0.) {
+      printf("{TSRIM} Warning : '%s' is not an energy table ..\n", fname.c_str());
+      return false;
+   }
+   fEnergyTable.resize((nEnergy + 1) * (nThickness + 1));
+   for(double& energy : fEnergyTable) {
+      infile>>energy;
+   }
+   if(infile.fail()) {
+      printf("{TSRIM} Warning : energy table '%s' is incomplete ..\n", fname.c_str());
+      ClearEnergyTable();
+      return false;
+   }
+
+   fTableEmax       = emax;
+   fTableXmax       = xmax;
+   fTableStepSize   = stepsize;
+   fTableNEnergy    = nEnergy;
+   fTableNThickness = nThickness;
+
+   if(printfile) {
+      printf("\tenergy table %s read in [0 - %.03f keV & 0 - %.03f um, %d x %d points]\n", fname.c_str(), fTableEmax,
+             fTableXmax, fTableNEnergy + 1, fTableNThickness + 1);
+      // spot check the table against the stepped calculation
+      CheckEnergyTable(10, 10, true);
+   }
+
+   return true;
+}
+
+void TSRIM::ClearEnergyTable()
+{
+   fEnergyTable.clear();
+   fTableEmax       = 0.;
+   fTableXmax       = 0.;
+   fTableStepSize   = 0.;
+   fTableNEnergy    = 0;
+   fTableNThickness = 0;
+}
@@ -7,6 +7,7 @@
 #include "Globals.h"
 #include "TSceptar.h"
 #include "TGRSIOptions.h"
+#include "TWaveformKernels.h"
 
 /// \cond CLASSIMP
 ClassImp(TSceptarHit)
@@ -133,37 +134,24 @@ void TSceptarHit::Print(Option_t*) const
 bool TSceptarHit::AnalyzeWaveform()
 {
 	// Calculates the cfd time from the waveform
-	bool error = false;
 	if(fWaveform.empty()) {
 		return false; // Error!
 	}
 
-	std::vector<Int_t>   baselineCorrections(8, 0);
-	std::vector<Short_t> smoothedWaveform;
-
 	// all timing algorithms use interpolation with this many steps between two samples (all times are stored as
 	// integers)
 	unsigned int interpolationSteps  = 256;
-	int          delay               = 8;
+	unsigned int delay               = 8;
 	double       attenuation         = 24. / 64.;
-	int          halfsmoothingwindow = 0; // 2*halfsmoothingwindow + 1 = number of samples in moving window.
+	unsigned int halfsmoothingwindow = 0; // 2*halfsmoothingwindow + 1 = number of samples in moving window.
 
 	// baseline algorithm: correct each adc with average of first two samples in that adc
-	for(size_t i = 0; i < 8 && i < fWaveform.size(); ++i) {
-		baselineCorrections[i] = fWaveform[i];
-	}
-	for(size_t i = 8; i < 16 && i < fWaveform.size(); ++i) {
-		baselineCorrections[i - 8] =
-			((baselineCorrections[i - 8] + fWaveform[i]) + ((baselineCorrections[i - 8] + fWaveform[i]) > 0 ? 1 : -1)) >>
-			1;
-	}
-	for(size_t i = 0; i < fWaveform.size(); ++i) {
-		fWaveform[i] -= baselineCorrections[i % 8];
-	}
+	TWaveformKernels::CorrectBaseline(fWaveform.data(), fWaveform.size());
 
-	SetCfd(CalculateCfd(attenuation, delay, halfsmoothingwindow, interpolationSteps));
+	SetCfd(TWaveformKernels::Cfd(fWaveform.data(), fWaveform.size(), attenuation, delay, halfsmoothingwindow,
+				interpolationSteps, TWaveformKernels::ThreadWorkspace()));
 
-	return !error;
+	return true;
 }
 
 Int_t TSceptarHit::CalculateCfd(double attenuation, unsigned int delay, int halfsmoothingwindow,
@@ -179,56 +167,16 @@ Int_t TSceptarHit::CalculateCfdAndMonitor(double attenuation, unsigned int delay
 		unsigned int interpolationSteps, std::vector<Short_t>& monitor)
 {
 	// Used when calculating the CFD from the waveform
-
-	Short_t monitormax = 0;
-
-	bool armed = false;
-
-	Int_t cfd = 0;
-
-	std::vector<Short_t> smoothedWaveform;
-
 	if(fWaveform.empty()) {
 		return INT_MAX; // Error!
 	}
 
-	if(static_cast<unsigned int>(fWaveform.size()) > delay + 1) {
-
-		if(halfsmoothingwindow > 0) {
-			smoothedWaveform = TSceptarHit::CalculateSmoothedWaveform(halfsmoothingwindow);
-		} else {
-			smoothedWaveform = fWaveform;
-		}
-
-		monitor.resize(smoothedWaveform.size() - delay);
-		monitor[0] = attenuation * smoothedWaveform[delay] - smoothedWaveform[0];
-		if(monitor[0] > monitormax) {
-			armed      = true;
-			monitormax = monitor[0];
-		}
-
-		for(unsigned int i = delay + 1; i < smoothedWaveform.size(); ++i) {
-			monitor[i - delay] = attenuation * smoothedWaveform[i] - smoothedWaveform[i - delay];
-			if(monitor[i - delay] > monitormax) {
-				armed      = true;
-				monitormax = monitor[i - delay];
-			} else {
-				if(armed && monitor[i - delay] < 0) {
-					armed = false;
-					if(monitor[i - delay - 1] - monitor[i - delay] != 0) {
-						// Linear interpolation.
-						cfd = (i - delay - 1) * interpolationSteps +
-							(monitor[i - delay - 1] * interpolationSteps) / (monitor[i - delay - 1] - monitor[i - delay]);
-					} else {
-						// Should be impossible, since monitor[i-delay-1] => 0 and monitor[i-delay] > 0
-						cfd = 0;
-					}
-				}
-			}
-		}
-	} else {
-		monitor.resize(0);
-	}
+	TWaveformKernels::TWorkspace& workspace   = TWaveformKernels::ThreadWorkspace();
+	size_t                        monitorSize = 0;
+	Int_t cfd = TWaveformKernels::Cfd(fWaveform.data(), fWaveform.size(), attenuation, delay,
+			halfsmoothingwindow > 0 ? halfsmoothingwindow : 0, interpolationSteps, workspace, &monitorSize);
+	const Short_t* monitorData = workspace.Monitor(monitorSize);
+	monitor.assign(monitorData, monitorData + monitorSize);
 
 	return cfd;
 }
@@ -241,14 +189,9 @@ std::vector<Short_t> TSceptarHit::CalculateSmoothedWaveform(unsigned int halfsmo
 		return std::vector<Short_t>(); // Error!
 	}
 
-	std::vector<Short_t> smoothedWaveform(std::max(static_cast<size_t>(0), fWaveform.size() - 2 * halfsmoothingwindow),
-			0);
-
-	for(size_t i = halfsmoothingwindow; i < fWaveform.size() - halfsmoothingwindow; ++i) {
-		for(int j = -static_cast<int>(halfsmoothingwindow); j <= static_cast<int>(halfsmoothingwindow); ++j) {
-			smoothedWaveform[i - halfsmoothingwindow] += fWaveform[i + j];
-		}
-	}
+	std::vector<Short_t> smoothedWaveform(fWaveform.size(), 0);
+	smoothedWaveform.resize(
+			TWaveformKernels::Smooth(fWaveform.data(), fWaveform.size(), halfsmoothingwindow, smoothedWaveform.data()));
 
 	return smoothedWaveform;
 }
@@ -257,7 +200,7 @@ std::vector<Short_t> TSceptarHit::CalculateCfdMonitor(double attenuation, int de
 {
 	// Used when calculating the CFD from the waveform
 
-	if(fWaveform.empty()) {
+	if(fWaveform.empty() || delay < 0) {
 		return std::vector<Short_t>(); // Error!
 	}
 
@@ -269,11 +212,9 @@ std::vector<Short_t> TSceptarHit::CalculateCfdMonitor(double attenuation, int de
 		smoothedWaveform = fWaveform;
 	}
 
-	std::vector<Short_t> monitor(std::max(static_cast<size_t>(0), smoothedWaveform.size() - delay), 0);
-
-	for(size_t i = delay; i < smoothedWaveform.size(); ++i) {
-		monitor[i - delay] = attenuation * smoothedWaveform[i] - smoothedWaveform[i - delay];
-	}
+	std::vector<Short_t> monitor(smoothedWaveform.size(), 0);
+	monitor.resize(TWaveformKernels::CfdMonitor(smoothedWaveform.data(), smoothedWaveform.size(), attenuation, delay,
+				monitor.data()));
 
 	return monitor;
 }
@@ -1,6 +1,8 @@
 
 #include "TSiLi.h"
 #include "TGRSIOptions.h"
+#include "TGRSIRandom.h"
+#include "TWaveformFitter.h"
 
 /// \cond CLASSIMP
 ClassImp(TSiLi)
@@ -92,6 +94,19 @@ void TSiLi::AddFragment(const std::shared_ptr<const TFragment>& frag, TChannel*
    fSiLiHits.push_back(std::move(hit));
 }
 
+void TSiLi::AddWaveformFits(TWaveformFitter& fitter)
+{
+   /// Adds the waveform fits the hits skipped when they were built (see TWaveformFitter).
+   for(auto& hit : fSiLiHits) {
+      if(!hit.HasWave()) {
+         continue;
+      }
+      TSiLiHit* siliHit = &hit;
+      fitter.AddFit(hit.GetWaveform(), [siliHit](TPulseAnalyzer& pulse) { siliHit->SetWavefit(pulse); },
+                    sili_noise_fac);
+   }
+}
+
 // For mapping you may want to us -position.X() to account for looking upstream
 TVector3 TSiLi::GetPosition(int ring, int sector, bool smear)
 {
@@ -107,9 +122,9 @@ TVector3 TSiLi::GetPosition(int ring, int sector, bool smear)
    if(smear) {
       double sep = ring_width * 0.025;
       double r1 = radius - ring_width * 0.5 + sep, r2 = radius + ring_width * 0.5 - sep;
-      radius        = sqrt(gRandom->Uniform(r1 * r1, r2 * r2));
+      radius        = sqrt(TGRSIRandom::Uniform(r1 * r1, r2 * r2));
       double sepphi = sep / radius;
-      phi           = gRandom->Uniform(phi - phi_width * 0.5 + sepphi, phi + phi_width * 0.5 - sepphi);
+      phi           = TGRSIRandom::Uniform(phi - phi_width * 0.5 + sepphi, phi + phi_width * 0.5 - sepphi);
    }
 
    return TVector3(cos(phi) * radius, sin(phi) * radius, dist);
@@ -1,5 +1,6 @@
 #include "TSiLi.h"
 #include "TSiLiHit.h"
+#include "TWaveformFitter.h"
 
 /// \cond CLASSIMP
 ClassImp(TSiLiHit)
@@ -15,7 +16,9 @@ TSiLiHit::TSiLiHit(const TFragment& frag) : TGRSIDetectorHit(frag)
 
    fFitCharge = frag.GetCharge();
    //   if(TGRSIRunInfo::IsWaveformFitting()) // commented out as TGRSIRunInfo seems to be broken
-   SetWavefit(frag);
+   if(!TWaveformFitter::DeferFits()) { // otherwise TSiLi::AddWaveformFits fits a whole block of events
+      SetWavefit(frag);
+   }
 }
 
 TSiLiHit::~TSiLiHit() = default;
@@ -73,6 +76,18 @@ void TSiLiHit::SetWavefit(const TFragment& frag)
    }
 }
 
+void TSiLiHit::SetWavefit(TPulseAnalyzer& pulse)
+{
+   /// Fits the waveform of this hit in pulse (set up with TSiLi::sili_noise_fac) and sets the fit results.
+   if(FitPulseAnalyzer(&pulse, TSiLi::FitSiLiShape, GetChannel()) != 0) {
+      fTimeFit   = pulse.Get_wpar_T0();
+      fFitBase   = pulse.Get_wpar_baselinefin();
+      fFitCharge = pulse.Get_wpar_amplitude();
+      fSig2Noise = pulse.get_sig2noise();
+      fSmirnov   = pulse.GetsiliSmirnov();
+   }
+}
+
 // Broken up for external analysis script use
 TPulseAnalyzer* TSiLiHit::FitFrag(const TFragment& frag, int ShapeFit, int segment)
 {
@@ -2,7 +2,7 @@
 
 #include <iostream>
 
-#include "TRandom.h"
+#include "TGRSIRandom.h"
 #include "TMath.h"
 #include "TClass.h"
 #include "TInterpreter.h"
@@ -346,8 +346,8 @@ TVector3 TTigress::GetPosition(int DetNbr, int CryNbr, int SegNbr, double dist,
 	}
 		
 	if(smear && SegNbr==0){
-		double   x, y, r = sqrt(gRandom->Uniform(0, 400));
-		gRandom->Circle(x, y, r);
+		double   x, y, r = sqrt(TGRSIRandom::Uniform(0, 400));
+		TGRSIRandom::Circle(x, y, r);
 		return fPositionVectors[BackPos][DetNbr][CryNbr][SegNbr] + fCloverCross[DetNbr][0]*x + fCloverCross[DetNbr][1]*y;
 	}
 
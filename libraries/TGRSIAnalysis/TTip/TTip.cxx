@@ -7,6 +7,8 @@
 #include "TClass.h"
 
 #include "TGRSIRunInfo.h"
+#include "TGRSIOptions.h"
+#include "TWaveformFitter.h"
 
 /// \cond CLASSIMP
 ClassImp(TTip)
@@ -58,6 +60,27 @@ void TTip::AddFragment(const std::shared_ptr<const TFragment>& frag, TChannel* c
    fTipHits.push_back(std::move(dethit)); // Once we are done with it we can move the memory
 }
 
+void TTip::AddWaveformFits(TWaveformFitter& fitter)
+{
+   /// Adds the waveform fits the hits skipped when they were built (see TWaveformFitter).
+   if(!TGRSIOptions::AnalysisOptions()->IsWaveformFitting()) {
+      return;
+   }
+   for(auto& hit : fTipHits) {
+      if(!hit.HasWave()) {
+         continue;
+      }
+      // unlike the constructor (which fits the hit before its numbering is set up and thus never knows it's a CsI)
+      // we know the type of the hit here, so CsI hits get the PID fit
+      TTipHit* tipHit = &hit;
+      if(hit.IsCsI()) {
+         fitter.AddFit(hit.GetWaveform(), [tipHit](TPulseAnalyzer& pulse) { tipHit->SetPID(pulse); });
+      } else {
+         fitter.AddFit(hit.GetWaveform(), [tipHit](TPulseAnalyzer& pulse) { tipHit->SetWavefit(pulse); });
+      }
+   }
+}
+
 void TTip::Print(Option_t*) const
 {
    /// Prints out TTip members, currently only prints the multiplicity.
@@ -1,6 +1,7 @@
 #include "TTip.h"
 #include "TTipHit.h"
 #include "TGRSIOptions.h"
+#include "TWaveformFitter.h"
 
 ////////////////////////////////////////////////////////////
 //
@@ -26,6 +27,10 @@ TTipHit::TTipHit()
 TTipHit::TTipHit(const TFragment& frag) : TGRSIDetectorHit(frag)
 {
    // SetVariables(frag);
+   if(TWaveformFitter::DeferFits()) {
+      // the waveforms are fitted for a whole block of events (see TTip::AddWaveformFits)
+      return;
+   }
    if(TGRSIOptions::AnalysisOptions()->IsWaveformFitting() && !IsCsI()) {
       SetWavefit(frag);
    } else if(TGRSIOptions::AnalysisOptions()->IsWaveformFitting() && IsCsI()) {
@@ -81,17 +86,29 @@ void TTipHit::SetWavefit(const TFragment& frag)
 {
    TPulseAnalyzer pulse(frag);
    if(pulse.IsSet()) {
-      fTimeFit   = pulse.fit_newT0();
-      fSig2Noise = pulse.get_sig2noise();
+      SetWavefit(pulse);
    }
 }
 
+void TTipHit::SetWavefit(TPulseAnalyzer& pulse)
+{
+   /// Sets the fit time and signal to noise ratio from a pulse analyzer set up with the waveform of this hit.
+   fTimeFit   = pulse.fit_newT0();
+   fSig2Noise = pulse.get_sig2noise();
+}
+
 void TTipHit::SetPID(const TFragment& frag)
 {
    TPulseAnalyzer pulse(frag);
    if(pulse.IsSet()) {
-      fPID     = pulse.CsIPID();
-      fTimeFit = pulse.CsIt0();
-      fChiSq   = pulse.GetCsIChiSq();
+      SetPID(pulse);
    }
 }
+
+void TTipHit::SetPID(TPulseAnalyzer& pulse)
+{
+   /// Sets the PID, fit time and chi-square from the CsI fit of a pulse analyzer set up with the waveform of this hit.
+   fPID     = pulse.CsIPID();
+   fTimeFit = pulse.CsIt0();
+   fChiSq   = pulse.GetCsIChiSq();
+}
@@ -9,6 +9,7 @@
 #include "TGRSIOptions.h"
 #include "TChannel.h"
 #include "GValue.h"
+#include "TWaveformKernels.h"
 
 /// \cond CLASSIMP
 ClassImp(TZeroDegreeHit)
@@ -91,7 +92,7 @@ Int_t TZeroDegreeHit::GetRemainder() const
 
 Double_t TZeroDegreeHit::GetTime(const ETimeFlag&, Option_t*) const
 {
-   Double_t  dTime = GetTimeStamp() * 10. + GetRemainder() + (GetCfd() + gRandom->Uniform()) / 256.;
+   Double_t  dTime = GetTimeStamp() * 10. + GetRemainder() + (GetCfd() + Dither(TGRSIRandom::kCfd)) / 256.;
    TChannel* chan  = GetChannel();
    if(chan == nullptr) {
       Error("GetTime", "No TChannel exists for address 0x%08x", GetAddress());
@@ -132,39 +133,41 @@ void TZeroDegreeHit::Print(Option_t*) const
 bool TZeroDegreeHit::AnalyzeWaveform()
 {
    /// Calculates the cfd time from the waveform
-   bool error = false;
    if(fWaveform.empty()) {
       return false; // Error!
    }
-
-   std::vector<Int_t>   baselineCorrections(8, 0);
-   std::vector<Short_t> smoothedWaveform;
+   TWaveformKernels::TWorkspace& workspace = TWaveformKernels::ThreadWorkspace();
+   size_t                        size      = fWaveform.size();
 
    // all timing algorithms use interpolation with this many steps between two samples (all times are stored as
    // integers)
    unsigned int interpolationSteps  = 256;
-   int          delay               = 2;
+   unsigned int delay               = 2;
    double       attenuation         = 24. / 64.;
-   int          halfsmoothingwindow = 0; // 2*halfsmoothingwindow + 1 = number of samples in moving window.
+   unsigned int halfsmoothingwindow = 0; // 2*halfsmoothingwindow + 1 = number of samples in moving window.
 
    // baseline algorithm: correct each adc with average of first two samples in that adc
-   for(size_t i = 0; i < 8 && i < fWaveform.size(); ++i) {
-      baselineCorrections[i] = fWaveform[i];
-   }
-   for(size_t i = 8; i < 16 && i < fWaveform.size(); ++i) {
-      baselineCorrections[i - 8] =
-         ((baselineCorrections[i - 8] + fWaveform[i]) + ((baselineCorrections[i - 8] + fWaveform[i]) > 0 ? 1 : -1)) >>
-         1;
-   }
-   for(size_t i = 0; i < fWaveform.size(); ++i) {
-      fWaveform[i] -= baselineCorrections[i % 8];
-   }
+   TWaveformKernels::CorrectBaseline(fWaveform.data(), size);
 
-   SetCfd(CalculateCfd(attenuation, delay, halfsmoothingwindow, interpolationSteps));
+   size_t monitorSize = 0;
+   Int_t  cfd         = TWaveformKernels::Cfd(fWaveform.data(), size, attenuation, delay, halfsmoothingwindow,
+                                             interpolationSteps, workspace, &monitorSize);
+   if(TGRSIOptions::Get()->Debug()) {
+      const Short_t* monitor = workspace.Monitor(monitorSize);
+      fCfdMonitor.assign(monitor, monitor + monitorSize);
+   }
+   // correct for remainder between the 100MHz timestamp and the 125MHz start of the waveform
+   // we save this in the upper bits, otherwise we can't correct the waveform themselves
+   SetCfd((cfd & 0x3fffff) | (fCfd & 0x7c00000));
 
-   SetCharge(CalculatePartialSum().back());
+   Int_t* partialSums = workspace.Sums(size);
+   TWaveformKernels::PartialSum(fWaveform.data(), size, partialSums);
+   if(TGRSIOptions::Get()->Debug()) {
+      fPartialSum.assign(partialSums, partialSums + size);
+   }
+   SetCharge(partialSums[size - 1]);
 
-   return !error;
+   return true;
 }
 
 Int_t TZeroDegreeHit::CalculateCfd(double attenuation, unsigned int delay, int halfsmoothingwindow,
@@ -180,56 +183,17 @@ Int_t TZeroDegreeHit::CalculateCfdAndMonitor(double attenuation, unsigned int de
                                              unsigned int interpolationSteps, std::vector<Short_t>& monitor)
 {
    /// Used when calculating the CFD from the waveform
-
-   Short_t monitormax = 0;
-
-   bool armed = false;
-
-   Int_t cfd = 0;
-
-   std::vector<Short_t> smoothedWaveform;
-
    if(fWaveform.empty()) {
       return INT_MAX; // Error!
    }
 
-   if(static_cast<unsigned int>(fWaveform.size()) > delay + 1) {
-
-      if(halfsmoothingwindow > 0) {
-         smoothedWaveform = TZeroDegreeHit::CalculateSmoothedWaveform(halfsmoothingwindow);
-      } else {
-         smoothedWaveform = fWaveform;
-      }
-
-      monitor.resize(smoothedWaveform.size() - delay);
-      monitor[0] = attenuation * smoothedWaveform[delay] - smoothedWaveform[0];
-      if(monitor[0] > monitormax) {
-         armed      = true;
-         monitormax = monitor[0];
-      }
-
-      for(unsigned int i = delay + 1; i < smoothedWaveform.size(); ++i) {
-         monitor[i - delay] = attenuation * smoothedWaveform[i] - smoothedWaveform[i - delay];
-         if(monitor[i - delay] > monitormax) {
-            armed      = true;
-            monitormax = monitor[i - delay];
-         } else {
-            if(armed && monitor[i - delay] < 0) {
-               armed = false;
-               if(monitor[i - delay - 1] - monitor[i - delay] != 0) {
-                  // Linear interpolation.
-                  cfd = (i - delay - 1) * interpolationSteps +
-                        (monitor[i - delay - 1] * interpolationSteps) / (monitor[i - delay - 1] - monitor[i - delay]);
-               } else {
-                  // Should be impossible, since monitor[i-delay-1] => 0 and monitor[i-delay] > 0
-                  cfd = 0;
-               }
-            }
-         }
-      }
-   } else {
-      monitor.resize(0);
-   }
+   TWaveformKernels::TWorkspace& workspace   = TWaveformKernels::ThreadWorkspace();
+   size_t                        monitorSize = 0;
+   Int_t cfd = TWaveformKernels::Cfd(fWaveform.data(), fWaveform.size(), attenuation, delay,
+                                     halfsmoothingwindow > 0 ? halfsmoothingwindow : 0, interpolationSteps, workspace,
+                                     &monitorSize);
+   const Short_t* monitorData = workspace.Monitor(monitorSize);
+   monitor.assign(monitorData, monitorData + monitorSize);
 
    if(TGRSIOptions::Get()->Debug()) {
       fCfdMonitor = monitor;
@@ -250,14 +214,9 @@ std::vector<Short_t> TZeroDegreeHit::CalculateSmoothedWaveform(unsigned int half
       return std::vector<Short_t>(); // Error!
    }
 
-   std::vector<Short_t> smoothedWaveform(std::max(static_cast<size_t>(0), fWaveform.size() - 2 * halfsmoothingwindow),
-                                         0);
-
-   for(size_t i = halfsmoothingwindow; i < fWaveform.size() - halfsmoothingwindow; ++i) {
-      for(int j = -static_cast<int>(halfsmoothingwindow); j <= static_cast<int>(halfsmoothingwindow); ++j) {
-         smoothedWaveform[i - halfsmoothingwindow] += fWaveform[i + j];
-      }
-   }
+   std::vector<Short_t> smoothedWaveform(fWaveform.size(), 0);
+   smoothedWaveform.resize(
+      TWaveformKernels::Smooth(fWaveform.data(), fWaveform.size(), halfsmoothingwindow, smoothedWaveform.data()));
 
    return smoothedWaveform;
 }
@@ -266,7 +225,7 @@ std::vector<Short_t> TZeroDegreeHit::CalculateCfdMonitor(double attenuation, int
 {
    /// Used when calculating the CFD from the waveform
 
-   if(fWaveform.empty()) {
+   if(fWaveform.empty() || delay < 0) {
       return std::vector<Short_t>(); // Error!
    }
 
@@ -278,11 +237,9 @@ std::vector<Short_t> TZeroDegreeHit::CalculateCfdMonitor(double attenuation, int
       smoothedWaveform = fWaveform;
    }
 
-   std::vector<Short_t> monitor(std::max(static_cast<size_t>(0), smoothedWaveform.size() - delay), 0);
-
-   for(size_t i = delay; i < smoothedWaveform.size(); ++i) {
-      monitor[i - delay] = attenuation * smoothedWaveform[i] - smoothedWaveform[i - delay];
-   }
+   std::vector<Short_t> monitor(smoothedWaveform.size(), 0);
+   monitor.resize(TWaveformKernels::CfdMonitor(smoothedWaveform.data(), smoothedWaveform.size(), attenuation, delay,
+                                               monitor.data()));
 
    return monitor;
 }
@@ -295,13 +252,7 @@ std::vector<Int_t> TZeroDegreeHit::CalculatePartialSum()
    }
 
    std::vector<Int_t> partialSums(fWaveform.size(), 0);
-
-   if(!fWaveform.empty()) {
-      partialSums[0] = fWaveform.at(0);
-      for(size_t i = 1; i < fWaveform.size(); ++i) {
-         partialSums[i] = partialSums[i - 1] + fWaveform[i];
-      }
-   }
+   TWaveformKernels::PartialSum(fWaveform.data(), fWaveform.size(), partialSums.data());
 
    if(TGRSIOptions::Get()->Debug()) {
       fPartialSum = partialSums;
@@ -10,10 +10,14 @@
 #include <vector>
 #include <sstream>
 #include <algorithm>
+#include <atomic>
+#include <mutex>
 
 #include "TFile.h"
 #include "TKey.h"
 
+#include "TGRSIRandom.h"
+
 /*
  * Author:  P.C. Bender, <pcbend@gmail.com>
  *
@@ -33,6 +37,62 @@ std::map<int, TChannel*>* TChannel::fChannelNumberMap = new std::map<int, TChann
 std::string TChannel::fFileName;
 std::string TChannel::fFileData;
 
+namespace {
+/// Dense lookup table for channel addresses below 2^24, kept in sync with fChannelMap. The upper 16 bits of the
+/// address select a page of 256 channels. Pages are only allocated once a channel on them is added and are never
+/// freed, so the table can be read by any number of threads without locking.
+const unsigned int kLookupPageBits = 8;
+const unsigned int kLookupPageSize = 1u << kLookupPageBits;
+const unsigned int kLookupMaxAddress = 1u << 24;
+
+std::atomic<std::atomic<TChannel*>*> gLookupPages[kLookupMaxAddress >> kLookupPageBits];
+std::mutex                           gLookupMutex; ///< only needed to allocate pages
+
+void SetLookup(unsigned int address, TChannel* chan)
+{
+   if(address >= kLookupMaxAddress) {
+      return;
+   }
+   std::atomic<TChannel*>* page = gLookupPages[address >> kLookupPageBits].load(std::memory_order_acquire);
+   if(page == nullptr) {
+      std::lock_guard<std::mutex> lock(gLookupMutex);
+      page = gLookupPages[address >> kLookupPageBits].load(std::memory_order_acquire);
+      if(page == nullptr) {
+         page = new std::atomic<TChannel*>[kLookupPageSize];
+         for(unsigned int i = 0; i < kLookupPageSize; ++i) {
+            page[i].store(nullptr, std::memory_order_relaxed);
+         }
+         gLookupPages[address >> kLookupPageBits].store(page, std::memory_order_release);
+      }
+   }
+   page[address & (kLookupPageSize - 1)].store(chan, std::memory_order_release);
+}
+
+void ClearLookup()
+{
+   for(auto& entry : gLookupPages) {
+      std::atomic<TChannel*>* page = entry.load(std::memory_order_acquire);
+      if(page == nullptr) {
+         continue;
+      }
+      for(unsigned int i = 0; i < kLookupPageSize; ++i) {
+         page[i].store(nullptr, std::memory_order_release);
+      }
+   }
+}
+
+/// Evaluates the polynomial with coefficients coeff (low to high order) at x using Horner's method.
+template <typename T>
+inline double Horner(const std::vector<T>& coeff, double x)
+{
+   double result = coeff.back();
+   for(size_t i = coeff.size() - 1; i > 0; --i) {
+      result = result * x + coeff[i - 1];
+   }
+   return result;
+}
+} // namespace
+
 TChannel::TChannel()
 {
    Clear();
@@ -143,6 +203,7 @@ void TChannel::DeleteAllChannels()
    }
    fChannelMap->clear();
    fChannelNumberMap->clear();
+   ClearLookup();
 }
 
 void TChannel::AddChannel(TChannel* chan, Option_t* opt)
@@ -174,6 +235,7 @@ void TChannel::AddChannel(TChannel* chan, Option_t* opt)
    } else {
       // We need to update the channel maps to correspond to the new channel that has been added.
       fChannelMap->insert(std::make_pair(chan->GetAddress(), chan));
+      SetLookup(chan->GetAddress(), chan);
       if((chan->GetNumber() != 0) && (fChannelNumberMap->count(chan->GetNumber()) == 0)) {
          fChannelNumberMap->insert(std::make_pair(chan->GetNumber(), chan));
       }
@@ -307,16 +369,23 @@ void TChannel::Clear(Option_t*)
 
 TChannel* TChannel::GetChannel(unsigned int temp_address)
 {
-   /// Returns the TChannel at the specified address. If the address doesn't exist, returns an empty gChannel.
+   /// Returns the TChannel at the specified address. If the address doesn't exist, returns nullptr.
+   /// Addresses below 2^24 (i.e. all GRIFFIN and TIGRESS addresses) are found in a dense lookup table, so this is
+   /// cheap enough to be called for every fragment and hit, and safe to call from several threads.
+
+   if(temp_address < kLookupMaxAddress) {
+      std::atomic<TChannel*>* page = gLookupPages[temp_address >> kLookupPageBits].load(std::memory_order_acquire);
+      if(page == nullptr) {
+         return nullptr;
+      }
+      return page[temp_address & (kLookupPageSize - 1)].load(std::memory_order_acquire);
+   }
 
-   TChannel* chan = nullptr;
-   //    if(temp_address == 0 || temp_address == 0xffffffff) {//default (nullptr) address, return 0;
-   //	      return chan;
-   //    }
-   if(fChannelMap->count(temp_address) == 1) { // found channel
-      chan = fChannelMap->at(temp_address);
+   auto it = fChannelMap->find(temp_address);
+   if(it != fChannelMap->end()) { // found channel
+      return it->second;
    }
-   return chan;
+   return nullptr;
 }
 
 TChannel* TChannel::GetChannelByNumber(int temp_num)
@@ -455,7 +524,7 @@ double TChannel::CalibrateENG(int charge, int temp_int)
 
    // We need to add a random number between 0 and 1 before calibrating to avoid
    // binning issues.
-   return CalibrateENG((static_cast<double>(charge) + gRandom->Uniform()) / static_cast<double>(temp_int));
+   return CalibrateENG((static_cast<double>(charge) + TGRSIRandom::Uniform()) / static_cast<double>(temp_int));
 }
 
 double TChannel::CalibrateENG(double charge, int temp_int)
@@ -488,17 +557,13 @@ double TChannel::CalibrateENG(double charge)
    if(fENGCoefficients.Value().empty()) {
       return charge;
    }
-   double cal_chg = fENGCoefficients.Value()[0];
-   for(size_t i = 1; i < fENGCoefficients.Value().size(); i++) {
-      cal_chg += fENGCoefficients.Value()[i] * pow((charge), i);
-   }
-   return cal_chg;
+   return Horner(fENGCoefficients.Value(), charge);
 }
 
 double TChannel::CalibrateCFD(int cfd)
 {
    /// Calibrates the CFD properly.
-   return CalibrateCFD(static_cast<double>(cfd) + gRandom->Uniform());
+   return CalibrateCFD(static_cast<double>(cfd) + TGRSIRandom::Uniform());
 }
 
 double TChannel::CalibrateCFD(double cfd)
@@ -509,18 +574,13 @@ double TChannel::CalibrateCFD(double cfd)
       return cfd;
    }
 
-   double cal_cfd = 0.0;
-   for(size_t i = 0; i < fCFDCoefficients.Value().size(); i++) {
-      cal_cfd += fCFDCoefficients.Value()[i] * pow(cfd, i);
-   }
-
-   return cal_cfd;
+   return Horner(fCFDCoefficients.Value(), cfd);
 }
 
 double TChannel::CalibrateLED(int led)
 {
    /// Calibrates the LED
-   return CalibrateLED(static_cast<double>(led) + gRandom->Uniform());
+   return CalibrateLED(static_cast<double>(led) + TGRSIRandom::Uniform());
 }
 
 double TChannel::CalibrateLED(double led)
@@ -531,11 +591,7 @@ double TChannel::CalibrateLED(double led)
       return led;
    }
 
-   double cal_led = 0.0;
-   for(size_t i = 0; i < fLEDCoefficients.Value().size(); i++) {
-      cal_led += fLEDCoefficients.Value()[i] * pow(led, i);
-   }
-   return cal_led;
+   return Horner(fLEDCoefficients.Value(), led);
 }
 
 double TChannel::CalibrateTIME(int chg)
@@ -556,11 +612,9 @@ double TChannel::CalibrateTIME(double energy)
       return 0.0000;
    }
 
-   double timeCorrection = 0.0;
-
-   timeCorrection = fTIMECoefficients.Value().at(0) + (fTIMECoefficients.Value().at(1) * pow(energy, fTIMECoefficients.Value().at(2)));
+   const std::vector<double>& coeff = fTIMECoefficients.Value();
 
-   return timeCorrection;
+   return coeff[0] + coeff[1] * pow(energy, coeff[2]);
 }
 
 double TChannel::CalibrateEFF(double)
@@ -0,0 +1,117 @@
+#include "TGRSIRandom.h"
+
+#include <atomic>
+#include <cmath>
+#include <cstdint>
+
+#include "TMath.h"
+
+#include "TGRSIOptions.h"
+
+namespace {
+std::atomic<uint64_t> gSeed(0x4a6f68616e6e6573ULL);
+std::atomic<uint64_t> gSeedGeneration(0); ///< changed by SetSeed, so that threads re-seed their generators
+std::atomic<uint64_t> gThreadCounter(0);  ///< gives each thread a different stream
+
+inline uint64_t SplitMix64(uint64_t& state)
+{
+   uint64_t z = (state += 0x9e3779b97f4a7c15ULL);
+   z          = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+   z          = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+   return z ^ (z >> 31);
+}
+
+inline uint64_t Rotl(uint64_t x, int k)
+{
+   return (x << k) | (x >> (64 - k));
+}
+
+inline Double_t ToDouble(uint64_t x)
+{
+   // the upper 53 bits give a uniformly distributed double in [0, 1)
+   return static_cast<Double_t>(x >> 11) * (1.0 / 9007199254740992.0);
+}
+
+/// xoshiro256+ (D. Blackman, S. Vigna), seeded with splitmix64 from the global seed and a per-thread stream number
+struct TThreadGenerator {
+   uint64_t fState[4];
+   uint64_t fGeneration;
+   uint64_t fStream;
+   bool     fSeeded{false};
+
+   void Seed()
+   {
+      if(!fSeeded) {
+         fStream = gThreadCounter.fetch_add(1, std::memory_order_relaxed);
+         fSeeded = true;
+      }
+      fGeneration     = gSeedGeneration.load(std::memory_order_acquire);
+      uint64_t state  = gSeed.load(std::memory_order_relaxed) ^ (fStream * 0xd1b54a32d192ed03ULL);
+      for(auto& s : fState) {
+         s = SplitMix64(state);
+      }
+   }
+
+   uint64_t Next()
+   {
+      if(!fSeeded || fGeneration != gSeedGeneration.load(std::memory_order_relaxed)) {
+         Seed();
+      }
+      const uint64_t result = fState[0] + fState[3];
+      const uint64_t t      = fState[1] << 17;
+      fState[2] ^= fState[0];
+      fState[3] ^= fState[1];
+      fState[1] ^= fState[2];
+      fState[0] ^= fState[3];
+      fState[2] ^= t;
+      fState[3] = Rotl(fState[3], 45);
+      return result;
+   }
+};
+
+thread_local TThreadGenerator gGenerator;
+} // namespace
+
+Double_t TGRSIRandom::Uniform()
+{
+   return ToDouble(gGenerator.Next());
+}
+
+Double_t TGRSIRandom::Uniform(Double_t low, Double_t high)
+{
+   return low + (high - low) * Uniform();
+}
+
+void TGRSIRandom::Circle(Double_t& x, Double_t& y, Double_t r)
+{
+   Double_t phi = Uniform(0., TMath::TwoPi());
+   x            = r * std::cos(phi);
+   y            = r * std::sin(phi);
+}
+
+Double_t TGRSIRandom::Dither(UInt_t address, Long64_t timeStamp, Long64_t value, UInt_t use)
+{
+   /// Returns a number in [0, 1) to be added to the integer value before it is calibrated. If deterministic dithering
+   /// is selected this only depends on address, timestamp, value, and use (and the seed), otherwise it is taken from
+   /// this thread's generator.
+   if(!TGRSIOptions::AnalysisOptions()->DeterministicDither()) {
+      return Uniform();
+   }
+   uint64_t state = gSeed.load(std::memory_order_relaxed) ^ (static_cast<uint64_t>(address) << 32 | use);
+   SplitMix64(state);
+   state ^= static_cast<uint64_t>(timeStamp);
+   SplitMix64(state);
+   state ^= static_cast<uint64_t>(value);
+   return ToDouble(SplitMix64(state));
+}
+
+void TGRSIRandom::SetSeed(ULong64_t seed)
+{
+   gSeed.store(seed, std::memory_order_relaxed);
+   gSeedGeneration.fetch_add(1, std::memory_order_release);
+}
+
+ULong64_t TGRSIRandom::GetSeed()
+{
+   return gSeed.load(std::memory_order_relaxed);
+}
@@ -1,5 +1,6 @@
 #include "TPPG.h"
 
+#include <algorithm>
 #include <iomanip>
 #include "TDirectory.h"
 
@@ -12,6 +13,144 @@ ClassImp(TPPG)
 
 TPPG* TPPG::fPPG = nullptr;
 
+////////////////////////////////////////////////////////////////////////////////
+///
+/// Flat copy of the PPG map: time stamps and new patterns of all PPG words in
+/// contiguous arrays, together with the time of the previous word with the
+/// same pattern, and the time of the last tape move (i.e. the cycle start),
+/// background, beam on, and decay word at or before each word. With these a
+/// lookup only has to find the current word.
+///
+/// The arrays are allocated with spare room, so that words can be appended
+/// (by one thread at a time) while other threads look up words. The new
+/// word is written first and then published by increasing fSize, readers
+/// only look at the first Size() words.
+///
+////////////////////////////////////////////////////////////////////////////////
+
+class TPPGTimeline {
+public:
+   TPPGTimeline(const TPPG::PPGMap_t& map, size_t capacity);
+   TPPGTimeline(const TPPGTimeline& rhs, size_t capacity);
+
+   bool   Append(ULong64_t time, EPpgPattern pat);
+   size_t Size() const { return fSize.load(std::memory_order_acquire); }
+   size_t Capacity() const { return fTime.size(); }
+   size_t Find(ULong64_t time) const;
+
+   static int PatternIndex(EPpgPattern pat);
+
+   std::vector<ULong64_t>   fTime;         ///< time stamps of all words (incl. the junk word at time 0)
+   std::vector<EPpgPattern> fPattern;      ///< new pattern of all words
+   std::vector<ULong64_t>   fPreviousSame; ///< time of the previous word with the same pattern (0 if there is none)
+   std::vector<ULong64_t>   fLast[4];      ///< time of the last word of each pattern at or before each word
+
+private:
+   std::atomic<size_t>              fSize{0};  ///< number of words, the vectors are allocated with capacity entries
+   std::map<EPpgPattern, ULong64_t> fLastTime; ///< time of the last word of each pattern, only used by Append
+};
+
+namespace {
+/// the last word found by this thread, so that lookups at increasing times only have to step forward
+struct TPPGCursor {
+   const TPPGTimeline* fTimeline{nullptr};
+   size_t              fRow{0};
+};
+
+thread_local TPPGCursor gCursor;
+
+/// minimum number of words a timeline has room for
+const size_t kMinTimelineCapacity = 1024;
+} // namespace
+
+TPPGTimeline::TPPGTimeline(const TPPG::PPGMap_t& map, size_t capacity)
+   : fTime(capacity), fPattern(capacity), fPreviousSame(capacity)
+{
+   for(auto& last : fLast) {
+      last.resize(capacity);
+   }
+   for(const auto& ppg : map) {
+      Append(ppg.first, ppg.second->GetNewPPG());
+   }
+}
+
+TPPGTimeline::TPPGTimeline(const TPPGTimeline& rhs, size_t capacity)
+   : fTime(capacity), fPattern(capacity), fPreviousSame(capacity), fLastTime(rhs.fLastTime)
+{
+   /// Copies rhs into a timeline with room for capacity words.
+   size_t size = rhs.Size();
+   std::copy(rhs.fTime.begin(), rhs.fTime.begin() + size, fTime.begin());
+   std::copy(rhs.fPattern.begin(), rhs.fPattern.begin() + size, fPattern.begin());
+   std::copy(rhs.fPreviousSame.begin(), rhs.fPreviousSame.begin() + size, fPreviousSame.begin());
+   for(int i = 0; i < 4; ++i) {
+      fLast[i].resize(capacity);
+      std::copy(rhs.fLast[i].begin(), rhs.fLast[i].begin() + size, fLast[i].begin());
+   }
+   fSize.store(size, std::memory_order_release);
+}
+
+bool TPPGTimeline::Append(ULong64_t time, EPpgPattern pat)
+{
+   /// Appends a word, returns false if the timeline is full or the word is earlier than the last one.
+   size_t size = fSize.load(std::memory_order_relaxed);
+   if(size == Capacity() || (size > 0 && time < fTime[size - 1])) {
+      return false;
+   }
+   fTime[size]    = time;
+   fPattern[size] = pat;
+   if(size == 0) {
+      // the first word is the junk word at time 0 which is never returned as last status (see GetLastStatusTime)
+      fPreviousSame[size] = 0;
+      for(auto& last : fLast) {
+         last[size] = 0;
+      }
+   } else {
+      fPreviousSame[size] = fLastTime[pat];
+      fLastTime[pat]      = time;
+      int index           = PatternIndex(pat);
+      for(int i = 0; i < 4; ++i) {
+         fLast[i][size] = (index == i ? time : fLast[i][size - 1]);
+      }
+   }
+   fSize.store(size + 1, std::memory_order_release);
+   return true;
+}
+
+int TPPGTimeline::PatternIndex(EPpgPattern pat)
+{
+   switch(pat) {
+	case EPpgPattern::kTapeMove: return 0;
+	case EPpgPattern::kBackground: return 1;
+	case EPpgPattern::kBeamOn: return 2;
+	case EPpgPattern::kDecay: return 3;
+   default: return -1;
+   }
+}
+
+size_t TPPGTimeline::Find(ULong64_t time) const
+{
+   /// Returns the index of the last word at or before "time". Starts at the word this thread found last and checks
+   /// it and the next word, only if that fails a binary search is done. The cursor is only a hint, it is checked
+   /// before it is used, so it doesn't matter if it belongs to a timeline that has since been replaced.
+   size_t row  = 0;
+   size_t size = Size();
+   if(gCursor.fTimeline == this && gCursor.fRow < size && fTime[gCursor.fRow] <= time) {
+      row = gCursor.fRow;
+      if(row + 1 < size && fTime[row + 1] <= time) {
+         ++row;
+         if(row + 1 < size && fTime[row + 1] <= time) {
+            row = std::upper_bound(fTime.begin() + row + 1, fTime.begin() + size, time) - fTime.begin() - 1;
+         }
+      }
+   } else {
+      // fTime[0] is always 0, so the upper bound is never the first word
+      row = std::upper_bound(fTime.begin(), fTime.begin() + size, time) - fTime.begin() - 1;
+   }
+   gCursor.fTimeline = this;
+   gCursor.fRow      = row;
+   return row;
+}
+
 TPPGData::TPPGData()
 {
    Clear();
@@ -74,6 +213,7 @@ TPPG::TPPG(const TPPG& rhs) : TObject()
 TPPG::~TPPG()
 {
    Clear();
+   InvalidateTimeline();
    PPGMap_t::iterator ppgit;
    if(fPPGStatusMap != nullptr) {
       for(ppgit = fPPGStatusMap->begin(); ppgit != fPPGStatusMap->end(); ppgit++) {
@@ -139,34 +279,74 @@ Bool_t TPPG::MapIsEmpty() const
 void TPPG::AddData(TPPGData* pat)
 {
    /// Adds a PPG status word at a given time in the current run. Makes a copy of the pointer to
-   /// store in the map.
-   fPPGStatusMap->insert(std::make_pair(pat->GetTimeStamp(), new TPPGData(*pat)));
+   /// store in the map. This can be called while other threads look up the status.
+   std::lock_guard<std::mutex> lock(fTimelineMutex);
+   auto inserted = fPPGStatusMap->insert(std::make_pair(pat->GetTimeStamp(), new TPPGData(*pat)));
    fCycleLength = 0;
    fNumberOfCycleLengths.clear();
+   std::shared_ptr<TPPGTimeline> timeline = std::atomic_load(&fTimeline);
+   if(!inserted.second || timeline == nullptr || timeline->Append(pat->GetTimeStamp(), pat->GetNewPPG())) {
+      return;
+   }
+   // the timeline is full or the word is out of order, replace it (readers keep the old one alive while they use it)
+   if(timeline->Size() > 0 && pat->GetTimeStamp() >= timeline->fTime[timeline->Size() - 1]) {
+      auto newTimeline = std::make_shared<TPPGTimeline>(*timeline, 2 * timeline->Capacity());
+      newTimeline->Append(pat->GetTimeStamp(), pat->GetNewPPG());
+      std::atomic_store(&fTimeline, newTimeline);
+   } else {
+      std::atomic_store(&fTimeline, std::make_shared<TPPGTimeline>(
+                                       *fPPGStatusMap, std::max(2 * fPPGStatusMap->size(), kMinTimelineCapacity)));
+   }
+}
+
+std::shared_ptr<const TPPGTimeline> TPPG::Timeline() const
+{
+   /// Returns the flat copy of the map, building it if it doesn't exist yet. The caller has to keep the returned
+   /// pointer for as long as it uses the timeline.
+   std::shared_ptr<TPPGTimeline> timeline = std::atomic_load(&fTimeline);
+   if(timeline != nullptr) {
+      return timeline;
+   }
+   std::lock_guard<std::mutex> lock(fTimelineMutex);
+   timeline = std::atomic_load(&fTimeline);
+   if(timeline == nullptr) {
+      timeline = std::make_shared<TPPGTimeline>(*fPPGStatusMap,
+                                                std::max(2 * fPPGStatusMap->size(), kMinTimelineCapacity));
+      std::atomic_store(&fTimeline, timeline);
+   }
+   return timeline;
+}
+
+void TPPG::InvalidateTimeline()
+{
+   /// Has to be called whenever the map is changed other than through AddData. Like changing the map itself, this
+   /// must not happen while other threads are using this TPPG.
+   std::atomic_store(&fTimeline, std::shared_ptr<TPPGTimeline>());
 }
 
 ULong64_t TPPG::GetLastStatusTime(ULong64_t time, EPpgPattern pat) const
 {
    /// Gets the last time that a status was given. If the EPpgPattern kJunk is passed, the
    /// current status at the time "time" is looked for. 
-   if(MapIsEmpty()) {
+   // the map is checked through the timeline, as AddData might be changing the map
+   std::shared_ptr<const TPPGTimeline> timeline = Timeline();
+   if(timeline->Size() <= 1) {
       printf("Empty\n");
       return 0;
    }
 
-   auto               curppg_it = --(fPPGStatusMap->upper_bound(time));
-   PPGMap_t::iterator ppg_it;
+   size_t row = timeline->Find(time);
    if(pat == EPpgPattern::kJunk) {
-      for(ppg_it = curppg_it; ppg_it != fPPGStatusMap->begin(); --ppg_it) {
-         if(curppg_it->second->GetNewPPG() == ppg_it->second->GetNewPPG() && curppg_it != ppg_it) {
-            return ppg_it->first;
-         }
-      }
-   } else {
-      for(ppg_it = curppg_it; ppg_it != fPPGStatusMap->begin(); --ppg_it) {
-			if(pat == ppg_it->second->GetNewPPG()) {
-				return ppg_it->first;
-			}
+      return timeline->fPreviousSame[row];
+   }
+   int index = TPPGTimeline::PatternIndex(pat);
+   if(index >= 0) {
+      return timeline->fLast[index][row];
+   }
+   // unknown pattern, nothing precomputed for it, so we search backwards (the first word is skipped)
+   for(; row > 0; --row) {
+      if(timeline->fPattern[row] == pat) {
+         return timeline->fTime[row];
       }
    }
    // printf("No previous status\n");
@@ -176,12 +356,12 @@ ULong64_t TPPG::GetLastStatusTime(ULong64_t time, EPpgPattern pat) const
 EPpgPattern TPPG::GetStatus(ULong64_t time) const
 {
    /// Returns the current status of the PPG at the time "time".
-   if(MapIsEmpty()) {
+   std::shared_ptr<const TPPGTimeline> timeline = Timeline();
+   if(timeline->Size() <= 1) {
       printf("Empty\n");
    }
-   // The upper_bound and lower_bound functions always return an iterator to the NEXT map element. We back off by one
-   // because we want to know what the last PPG event was.
-   return ((--(fPPGStatusMap->upper_bound(time)))->second->GetNewPPG());
+   // We want to know what the last PPG event at or before "time" was.
+   return timeline->fPattern[timeline->Find(time)];
 }
 
 void TPPG::Print(Option_t* opt) const
@@ -419,6 +599,7 @@ bool TPPG::Correct(bool verbose)
             // if they are, we change the status of the one fCycleLength ago to match the current status
             if(it->second->GetNewPPG() == (++prev)->second->GetOldPPG()) {
                (--prev)->second->SetNewPPG(it->second->GetNewPPG());
+               InvalidateTimeline();
             } else if(verbose) {
                printf(DBLUE "PPG at %lld already exist with status 0x%x (current status is 0x%x)." RESET_COLOR "\n",
                       (*it).first - fCycleLength, static_cast<std::underlying_type<EPpgPattern>::type>(prev->second->GetNewPPG()),
@@ -435,6 +616,7 @@ bool TPPG::Correct(bool verbose)
             printf("inserting new ppg data at %lld\n", new_data->GetTimeStamp());
          }
          it = fPPGStatusMap->insert(std::make_pair(new_data->GetTimeStamp(), new_data)).first;
+         InvalidateTimeline();
          --it;
       }
    }
@@ -498,6 +680,7 @@ void TPPG::Streamer(TBuffer& R__b)
    if(R__b.IsReading()) {
       R__b.ReadClassBuffer(TPPG::Class(), this);
       fCurrIterator = fPPGStatusMap->begin();
+      InvalidateTimeline();
    } else {
       R__b.WriteClassBuffer(TPPG::Class(), this);
    }
@@ -1,11 +1,16 @@
 #include "TParsingDiagnostics.h"
 
+#include <algorithm>
 #include <fstream>
+#include <limits>
 
 #include "TChannel.h"
 
 TParsingDiagnostics* TParsingDiagnostics::fParsingDiagnostics = nullptr;
 
+const UInt_t  TParsingDiagnostics::kDirectAddresses;
+const Short_t TParsingDiagnostics::kMaxDetectorTypes;
+
 TParsingDiagnostics::TParsingDiagnostics() : TObject()
 {
    fIdHist         = nullptr;
@@ -25,6 +30,7 @@ TParsingDiagnostics::~TParsingDiagnostics()
 
 void TParsingDiagnostics::Copy(TObject& obj) const
 {
+   FoldCounters();
    static_cast<TParsingDiagnostics&>(obj).fPPGCycleLength         = fPPGCycleLength;
    static_cast<TParsingDiagnostics&>(obj).fNumberOfGoodFragments  = fNumberOfGoodFragments;
    static_cast<TParsingDiagnostics&>(obj).fNumberOfBadFragments   = fNumberOfBadFragments;
@@ -59,10 +65,15 @@ void TParsingDiagnostics::Clear(Option_t*)
    fMaxNetworkPacketNumber = 0;
    fNumberOfNetworkPackets = 0;
    fNumberOfHits.clear();
+   fChannelCounters.clear();
+   fDirectSlots.clear();
+   fSlots.clear();
+   fGoodFragmentCounts.clear();
 }
 
 void TParsingDiagnostics::Print(Option_t*) const
 {
+   FoldCounters();
    std::cout<<"Total run time of this (sub-)run is "<<fMaxMidasTimeStamp - fMinMidasTimeStamp<<" s"<<std::endl
             <<"PPG cycle is "<<fPPGCycleLength / 1e5<<" ms long."<<std::endl
             <<"Found "<<fNumberOfNetworkPackets<<" network packets in range "<<fMinNetworkPacketNumber<<" - "
@@ -101,30 +112,35 @@ void TParsingDiagnostics::Print(Option_t*) const
 void TParsingDiagnostics::GoodFragment(const std::shared_ptr<const TFragment>& frag)
 {
    /// increment the counter of good fragments for this detector type and check if any trigger ids have been lost
-   fNumberOfGoodFragments[frag->GetDetectorType()]++;
-
-   UInt_t channelAddress = frag->GetAddress();
-   UInt_t channelId      = frag->GetChannelId();
-   long   timeStamp      = frag->GetTimeStamp();
-	
-   // check if this is a new minimum/maximum of the channel id
-   if(fMinChannelId.find(channelAddress) == fMinChannelId.end()) { // check if this channel has been found before
-      fMinChannelId[channelAddress] = channelId;
-      fMaxChannelId[channelAddress] = channelId;
-   } else {
-      if(channelId < fMinChannelId[channelAddress]) {
-         fMinChannelId[channelAddress] = channelId;
-      }
-      if(channelId > fMaxChannelId[channelAddress]) {
-         fMaxChannelId[channelAddress] = channelId;
+   Short_t detType = frag->GetDetectorType();
+   if(detType >= 0 && detType < kMaxDetectorTypes) {
+      if(fGoodFragmentCounts.empty()) {
+         fGoodFragmentCounts.resize(kMaxDetectorTypes, 0);
       }
+      ++fGoodFragmentCounts[detType];
+   } else {
+      fNumberOfGoodFragments[detType]++;
    }
 
-   // count the number of hits for this channel
-   if(fNumberOfHits.find(channelAddress) == fNumberOfHits.end()) {
-      fNumberOfHits[channelAddress] = 0;
+   UInt_t channelId = frag->GetChannelId();
+   long   timeStamp = frag->GetTimeStamp();
+
+   // count the hits and dead time of this channel, and update its minimum/maximum channel id and timestamp
+   TChannelCounters& counters = Counters(frag->GetAddress());
+   ++counters.fNumberOfHits;
+   counters.fDeadTime += frag->GetDeadTime();
+   if(channelId < counters.fMinChannelId) {
+      counters.fMinChannelId = channelId;
+   }
+   if(channelId > counters.fMaxChannelId) {
+      counters.fMaxChannelId = channelId;
+   }
+   if(timeStamp < counters.fMinTimeStamp) {
+      counters.fMinTimeStamp = timeStamp;
+   }
+   if(timeStamp > counters.fMaxTimeStamp) {
+      counters.fMaxTimeStamp = timeStamp;
    }
-   ++fNumberOfHits[channelAddress];
 
    // check if this is a new minimum/maximum network packet id
    if(frag->GetNetworkPacketNumber() > 0) {
@@ -137,26 +153,129 @@ void TParsingDiagnostics::GoodFragment(const std::shared_ptr<const TFragment>& f
       }
    }
 
-   // increment the dead time and set per channel min/max timestamps
-   if(fDeadTime.find(channelAddress) == fDeadTime.end()) {
-      fDeadTime[channelAddress]     = frag->GetDeadTime();
-      fMinTimeStamp[channelAddress] = timeStamp;
-      fMaxTimeStamp[channelAddress] = timeStamp;
+   if(fMinMidasTimeStamp == 0 || frag->GetMidasTimeStamp() < fMinMidasTimeStamp) {
+      fMinMidasTimeStamp = frag->GetMidasTimeStamp();
+   }
+   if(fMaxMidasTimeStamp == 0 || frag->GetMidasTimeStamp() > fMaxMidasTimeStamp) {
+      fMaxMidasTimeStamp = frag->GetMidasTimeStamp();
+   }
+}
+
+TParsingDiagnostics::TChannelCounters& TParsingDiagnostics::Counters(UInt_t address)
+{
+   /// Returns the counters of this channel address, creating them if this is the first fragment of the address.
+   Int_t* slot = nullptr;
+   if(address < kDirectAddresses) {
+      if(fDirectSlots.empty()) {
+         fDirectSlots.resize(kDirectAddresses, -1);
+      }
+      slot = &fDirectSlots[address];
    } else {
-      fDeadTime[channelAddress] += frag->GetDeadTime();
-      if(timeStamp < fMinTimeStamp[channelAddress]) {
-         fMinTimeStamp[channelAddress] = timeStamp;
+      auto it = fSlots.find(address);
+      if(it == fSlots.end()) {
+         it = fSlots.insert(std::make_pair(address, -1)).first;
       }
-      if(timeStamp > fMaxTimeStamp[channelAddress]) {
-         fMaxTimeStamp[channelAddress] = timeStamp;
+      slot = &(it->second);
+   }
+   if(*slot < 0) {
+      *slot = fChannelCounters.size();
+      fChannelCounters.push_back(TChannelCounters{address, std::numeric_limits<UInt_t>::max(), 0, 0, 0,
+                                                  std::numeric_limits<long>::max(), std::numeric_limits<long>::min()});
+   }
+   return fChannelCounters[*slot];
+}
+
+void TParsingDiagnostics::FoldCounters() const
+{
+   /// Folds the dense counters filled by GoodFragment into the maps and resets them. This only moves the counts from
+   /// one place to the other, so it's done for const objects as well (e.g. before printing).
+   auto* self = const_cast<TParsingDiagnostics*>(this);
+
+   for(size_t detType = 0; detType < fGoodFragmentCounts.size(); ++detType) {
+      if(fGoodFragmentCounts[detType] > 0) {
+         self->fNumberOfGoodFragments[detType] += fGoodFragmentCounts[detType];
       }
    }
 
-   if(fMinMidasTimeStamp == 0 || frag->GetMidasTimeStamp() < fMinMidasTimeStamp) {
-      fMinMidasTimeStamp = frag->GetMidasTimeStamp();
+   for(const auto& counters : fChannelCounters) {
+      UInt_t address = counters.fAddress;
+      self->fNumberOfHits[address] += counters.fNumberOfHits;
+      self->fDeadTime[address] += counters.fDeadTime;
+      // the min/max maps always have the same channels as the deadtime map
+      auto minId = self->fMinChannelId.insert(std::make_pair(address, counters.fMinChannelId)).first;
+      auto maxId = self->fMaxChannelId.insert(std::make_pair(address, counters.fMaxChannelId)).first;
+      auto minTs = self->fMinTimeStamp.insert(std::make_pair(address, counters.fMinTimeStamp)).first;
+      auto maxTs = self->fMaxTimeStamp.insert(std::make_pair(address, counters.fMaxTimeStamp)).first;
+      minId->second = std::min(minId->second, counters.fMinChannelId);
+      maxId->second = std::max(maxId->second, counters.fMaxChannelId);
+      minTs->second = std::min(minTs->second, counters.fMinTimeStamp);
+      maxTs->second = std::max(maxTs->second, counters.fMaxTimeStamp);
    }
-   if(fMaxMidasTimeStamp == 0 || frag->GetMidasTimeStamp() > fMaxMidasTimeStamp) {
-      fMaxMidasTimeStamp = frag->GetMidasTimeStamp();
+
+   self->fGoodFragmentCounts.clear();
+   self->fChannelCounters.clear();
+   self->fDirectSlots.clear();
+   self->fSlots.clear();
+}
+
+Int_t TParsingDiagnostics::Write(const char* name, Int_t option, Int_t bufsize) const
+{
+   /// Folds the dense counters into the maps before writing.
+   FoldCounters();
+   return TObject::Write(name, option, bufsize);
+}
+
+void TParsingDiagnostics::Add(const TParsingDiagnostics& other)
+{
+   /// adds the diagnostics of another instance (e.g. from one of several unpacking threads) to this one
+   FoldCounters();
+   other.FoldCounters();
+   for(const auto& it : other.fNumberOfGoodFragments) {
+      fNumberOfGoodFragments[it.first] += it.second;
+   }
+   for(const auto& it : other.fNumberOfBadFragments) {
+      fNumberOfBadFragments[it.first] += it.second;
+   }
+   for(const auto& it : other.fNumberOfHits) {
+      fNumberOfHits[it.first] += it.second;
+   }
+   for(const auto& it : other.fMinChannelId) {
+      if(fMinChannelId.find(it.first) == fMinChannelId.end() || it.second < fMinChannelId[it.first]) {
+         fMinChannelId[it.first] = it.second;
+      }
+   }
+   for(const auto& it : other.fMaxChannelId) {
+      if(fMaxChannelId.find(it.first) == fMaxChannelId.end() || it.second > fMaxChannelId[it.first]) {
+         fMaxChannelId[it.first] = it.second;
+      }
+   }
+   for(const auto& it : other.fDeadTime) {
+      fDeadTime[it.first] += it.second;
+   }
+   for(const auto& it : other.fMinTimeStamp) {
+      if(fMinTimeStamp.find(it.first) == fMinTimeStamp.end() || it.second < fMinTimeStamp[it.first]) {
+         fMinTimeStamp[it.first] = it.second;
+      }
+   }
+   for(const auto& it : other.fMaxTimeStamp) {
+      if(fMaxTimeStamp.find(it.first) == fMaxTimeStamp.end() || it.second > fMaxTimeStamp[it.first]) {
+         fMaxTimeStamp[it.first] = it.second;
+      }
+   }
+
+   if(other.fMinMidasTimeStamp != 0 && (fMinMidasTimeStamp == 0 || other.fMinMidasTimeStamp < fMinMidasTimeStamp)) {
+      fMinMidasTimeStamp = other.fMinMidasTimeStamp;
+   }
+   if(other.fMaxMidasTimeStamp != 0 && (fMaxMidasTimeStamp == 0 || other.fMaxMidasTimeStamp > fMaxMidasTimeStamp)) {
+      fMaxMidasTimeStamp = other.fMaxMidasTimeStamp;
+   }
+
+   fNumberOfNetworkPackets += other.fNumberOfNetworkPackets;
+   if(other.fMinNetworkPacketNumber < fMinNetworkPacketNumber) {
+      fMinNetworkPacketNumber = other.fMinNetworkPacketNumber;
+   }
+   if(other.fMaxNetworkPacketNumber > fMaxNetworkPacketNumber) {
+      fMaxNetworkPacketNumber = other.fMaxNetworkPacketNumber;
    }
 }
 
@@ -171,6 +290,7 @@ void TParsingDiagnostics::ReadPPG(TPPG* ppg)
 
 void TParsingDiagnostics::Draw(Option_t* opt)
 {
+   FoldCounters();
    UInt_t minChannel = fNumberOfHits.begin()->first;
    UInt_t maxChannel = std::prev(fNumberOfHits.end())->first;
 
@@ -200,6 +320,7 @@ void TParsingDiagnostics::Draw(Option_t* opt)
 
 void TParsingDiagnostics::WriteToFile(const char* fileName) const
 {
+   FoldCounters();
    std::ofstream statsOut(fileName);
    statsOut<<std::endl
            <<"Run time to the nearest second = "<<fMaxMidasTimeStamp - fMinMidasTimeStamp<<std::endl
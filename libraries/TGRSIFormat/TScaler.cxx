@@ -1,11 +1,15 @@
 #include "TScaler.h"
 
+#include <algorithm>
 #include <iomanip>
+#include <numeric>
 
 #include "TROOT.h"
+#include "TKey.h"
 
 /// \cond CLASSIMP
 ClassImp(TScalerData)
+ClassImp(TScalerIndex)
 ClassImp(TScaler)
 /// \endcond
 
@@ -48,20 +52,154 @@ void TScalerData::Print(Option_t*) const
    printf("\n");
 }
 
+void TScalerIndex::Clear(Option_t*)
+{
+   fAddresses.clear();
+   fFirstRow.clear();
+   fTimeStamps.clear();
+   fScalers.clear();
+   fWidth       = 0;
+   fTreeEntries = 0;
+   fUnsortedAddresses.clear();
+   fUnsortedTimeStamps.clear();
+   fUnsortedOffsets.clear();
+   fUnsortedScalers.clear();
+}
+
+void TScalerIndex::Print(Option_t*) const
+{
+   printf("scaler index of %lld tree entries: %lu readouts of %lu addresses with %u scalers each\n", fTreeEntries,
+          fTimeStamps.size(), fAddresses.size(), fWidth);
+}
+
+void TScalerIndex::Add(const TScalerData* data)
+{
+   /// Adds a readout to the index, Finalize has to be called after the last readout has been added.
+   fUnsortedAddresses.push_back(data->GetAddress());
+   fUnsortedTimeStamps.push_back(data->GetTimeStamp());
+   fUnsortedOffsets.push_back(fUnsortedScalers.size());
+   for(size_t i = 0; i < data->GetScaler().size(); ++i) {
+      fUnsortedScalers.push_back(data->GetScaler(i));
+   }
+}
+
+void TScalerIndex::Finalize(Long64_t treeEntries)
+{
+   /// Sorts the readouts added by address and time and stores them column-wise. If an address has more than one
+   /// readout with the same timestamp, the one added last is kept.
+   size_t nofReadouts = fUnsortedAddresses.size();
+   fUnsortedOffsets.push_back(fUnsortedScalers.size());
+
+   std::vector<size_t> order(nofReadouts);
+   std::iota(order.begin(), order.end(), 0);
+   std::stable_sort(order.begin(), order.end(), [this](size_t a, size_t b) {
+      if(fUnsortedAddresses[a] != fUnsortedAddresses[b]) {
+         return fUnsortedAddresses[a] < fUnsortedAddresses[b];
+      }
+      return fUnsortedTimeStamps[a] < fUnsortedTimeStamps[b];
+   });
+
+   fWidth = 0;
+   for(size_t i = 0; i < nofReadouts; ++i) {
+      fWidth = std::max(fWidth, static_cast<UInt_t>(fUnsortedOffsets[i + 1] - fUnsortedOffsets[i]));
+   }
+
+   fAddresses.clear();
+   fFirstRow.clear();
+   fTimeStamps.clear();
+   fScalers.clear();
+   fTimeStamps.reserve(nofReadouts);
+   fScalers.reserve(nofReadouts * fWidth);
+   for(size_t i = 0; i < nofReadouts; ++i) {
+      size_t readout = order[i];
+      UInt_t address = fUnsortedAddresses[readout];
+      if(fAddresses.empty() || fAddresses.back() != address) {
+         fAddresses.push_back(address);
+         fFirstRow.push_back(fTimeStamps.size());
+      } else if(fTimeStamps.back() == fUnsortedTimeStamps[readout]) {
+         // same address and time as the previous readout, which was added before this one, so we replace it
+         fTimeStamps.pop_back();
+         fScalers.resize(fScalers.size() - fWidth);
+      }
+      fTimeStamps.push_back(fUnsortedTimeStamps[readout]);
+      for(ULong64_t j = fUnsortedOffsets[readout]; j < fUnsortedOffsets[readout] + fWidth; ++j) {
+         fScalers.push_back(j < fUnsortedOffsets[readout + 1] ? fUnsortedScalers[j] : 0);
+      }
+   }
+   fFirstRow.push_back(fTimeStamps.size());
+   fTreeEntries = treeEntries;
+
+   fUnsortedAddresses.clear();
+   fUnsortedTimeStamps.clear();
+   fUnsortedOffsets.clear();
+   fUnsortedScalers.clear();
+}
+
+bool TScalerIndex::Range(UInt_t address, size_t& begin, size_t& end) const
+{
+   /// Sets begin and end to the rows of this address, returns false if the address doesn't exist.
+   auto it = std::lower_bound(fAddresses.begin(), fAddresses.end(), address);
+   if(it == fAddresses.end() || *it != address) {
+      return false;
+   }
+   size_t i = it - fAddresses.begin();
+   begin    = fFirstRow[i];
+   end      = fFirstRow[i + 1];
+   return true;
+}
+
+size_t TScalerIndex::LowerBound(size_t begin, size_t end, ULong64_t time) const
+{
+   /// Returns the first row in [begin, end) with a timestamp not before time, or end if there is none.
+   /// Scaler readouts are (almost) periodic, so we interpolate to get a first guess, search outwards from it with
+   /// growing steps until the time is bracketed, and finish with a binary search.
+   if(begin == end || time <= fTimeStamps[begin]) {
+      return begin;
+   }
+   size_t last = end - 1;
+   if(time > fTimeStamps[last]) {
+      return end;
+   }
+   // now fTimeStamps[begin] < time <= fTimeStamps[last]
+   size_t guess = begin + static_cast<size_t>(static_cast<double>(time - fTimeStamps[begin]) /
+                                              static_cast<double>(fTimeStamps[last] - fTimeStamps[begin]) *
+                                              static_cast<double>(last - begin));
+   guess       = std::min(std::max(guess, begin + 1), last);
+   size_t low  = guess - 1;
+   size_t high = guess;
+   size_t step = 1;
+   while(fTimeStamps[low] >= time) {
+      high = low;
+      low  = (low - begin > step) ? low - step : begin;
+      step *= 2;
+   }
+   while(fTimeStamps[high] < time) {
+      low  = high;
+      high = (last - high > step) ? high + step : last;
+      step *= 2;
+   }
+   // fTimeStamps[low] < time <= fTimeStamps[high]
+   return std::lower_bound(fTimeStamps.begin() + low + 1, fTimeStamps.begin() + high, time) - fTimeStamps.begin();
+}
+
+std::vector<UInt_t> TScalerIndex::GetScaler(size_t row) const
+{
+   return std::vector<UInt_t>(fScalers.begin() + row * fWidth, fScalers.begin() + (row + 1) * fWidth);
+}
+
 TScaler::TScaler(bool loadIntoMap)
 {
    /// This constructor tries to find the "ScalerTree" and uses it (if requested) to load the scaler data into the map.
-   ///\param[in] loadIntoMap Flag telling TScaler to load all scaler data into fScalerMap.
+   /// If the file contains an index written by WriteIndex, that index is used, otherwise the index is built on the first
+   /// query (or right away if loadIntoMap is set).
+   ///\param[in] loadIntoMap Flag telling TScaler to load all scaler data into the index right away.
    Clear();
    fTree = static_cast<TTree*>(gROOT->FindObject("ScalerTree"));
    if(fTree != nullptr) {
       fEntries = fTree->GetEntries();
       fTree->SetBranchAddress("TScalerData", &fScalerData);
-      if(loadIntoMap) {
-         for(Long64_t entry = 0; entry < fEntries; ++entry) {
-            fTree->GetEntry(entry);
-            fScalerMap[fScalerData->GetAddress()][fScalerData->GetTimeStamp()] = fScalerData->GetScaler();
-         }
+      if(!ReadIndex() && loadIntoMap) {
+         BuildIndex();
       }
    }
 }
@@ -73,11 +211,8 @@ TScaler::TScaler(TTree* tree, bool loadIntoMap)
    if(fTree != nullptr) {
       fEntries = fTree->GetEntries();
       fTree->SetBranchAddress("TScalerData", &fScalerData);
-      if(loadIntoMap) {
-         for(Long64_t entry = 0; entry < fEntries; ++entry) {
-            fTree->GetEntry(entry);
-            fScalerMap[fScalerData->GetAddress()][fScalerData->GetTimeStamp()] = fScalerData->GetScaler();
-         }
+      if(!ReadIndex() && loadIntoMap) {
+         BuildIndex();
       }
    }
 }
@@ -100,7 +235,7 @@ TScaler::~TScaler()
    fPPG = nullptr;
    fHist.clear();
    fHistRange.clear();
-   fScalerMap.clear();
+   fIndex.Clear();
 }
 
 void TScaler::Copy(TObject& obj) const
@@ -113,7 +248,7 @@ void TScaler::Copy(TObject& obj) const
    static_cast<TScaler&>(obj).fNumberOfTimePeriods      = fNumberOfTimePeriods;
    static_cast<TScaler&>(obj).fTotalTimePeriod          = fTotalTimePeriod;
    static_cast<TScaler&>(obj).fTotalNumberOfTimePeriods = fTotalNumberOfTimePeriods;
-   static_cast<TScaler&>(obj).fScalerMap                = fScalerMap;
+   static_cast<TScaler&>(obj).fIndex                    = fIndex;
 }
 
 std::vector<UInt_t> TScaler::GetScaler(UInt_t address, ULong64_t time) const
@@ -125,50 +260,40 @@ std::vector<UInt_t> TScaler::GetScaler(UInt_t address, ULong64_t time) const
       printf("Empty\n");
       return std::vector<UInt_t>(0);
    }
-   if(!fScalerMap.empty()) {
-      // Check that this address exists
-      if(fScalerMap.find(address) == fScalerMap.end()) {
-         return std::vector<UInt_t>();
-      }
-      auto currIt = fScalerMap.find(address)->second.lower_bound(time);
-      // if the time is after our last entry, we return the last entry
-      if(currIt == fScalerMap.find(address)->second.end()) {
-         return std::prev(fScalerMap.find(address)->second.end())->second;
-      }
-      // The lower_bound function returns an iterator to the NEXT map element or the current map element if the time is
-      // a perfect match.
-      return currIt->second;
+   BuildIndex();
+   // Check that this address exists
+   size_t begin;
+   size_t end;
+   if(!fIndex.Range(address, begin, end)) {
+      return std::vector<UInt_t>();
    }
-   // loop through the tree and find the right entry
-   for(Long64_t entry = 0; entry < fEntries; ++entry) {
-      fTree->GetEntry(entry);
-      // got the exact time match, so we return the current value
-      if(fScalerData->GetAddress() == address && fScalerData->GetTimeStamp() == time) {
-         return fScalerData->GetScaler();
-      }
-      // got a scaler that is later than our requested time, so we need to find the previous time and return that one
-      if(fScalerData->GetAddress() == address && fScalerData->GetTimeStamp() > time) {
-         for(--entry; entry >= 0; --entry) {
-            if(fScalerData->GetAddress() == address) {
-               return fScalerData->GetScaler();
-            }
-         }
-         // if we failed to find any previous data we return a vector of zeros
-         return std::vector<UInt_t>(4, 0);
-      }
+   size_t row = fIndex.LowerBound(begin, end, time);
+   // if the time is after our last entry, we return the last entry
+   if(row == end) {
+      --row;
    }
-   // failed to find any matching time so we just return the very last value (or should we search for the last value of
-   // this address?)
-   return fScalerData->GetScaler();
+   return fIndex.GetScaler(row);
 }
 
 UInt_t TScaler::GetScaler(UInt_t address, ULong64_t time, size_t index) const
 {
-   std::vector<UInt_t> values = GetScaler(address, time);
-   if(index < values.size()) {
-      return values[index];
+   /// Same as GetScaler(address, time)[index], but without copying the scaler values (returns 0 if the address or
+   /// index don't exist).
+   if(fTree == nullptr || fEntries == 0) {
+      printf("Empty\n");
+      return 0;
    }
-   return 0;
+   BuildIndex();
+   size_t begin;
+   size_t end;
+   if(!fIndex.Range(address, begin, end)) {
+      return 0;
+   }
+   size_t row = fIndex.LowerBound(begin, end, time);
+   if(row == end) {
+      --row;
+   }
+   return fIndex.GetScaler(row, index);
 }
 
 UInt_t TScaler::GetScalerDifference(UInt_t address, ULong64_t time, size_t index) const
@@ -182,58 +307,87 @@ UInt_t TScaler::GetScalerDifference(UInt_t address, ULong64_t time, size_t index
       printf("Empty\n");
       return 0;
    }
-   if(!fScalerMap.empty()) {
-      // Check that this address exists
-      if(fScalerMap.find(address) == fScalerMap.end()) {
-         return 0;
-      }
-      auto currIt = fScalerMap.find(address)->second.lower_bound(time);
-      // if the time is after our last entry, we return the last entry divided by the number of entries
-      if(currIt == fScalerMap.find(address)->second.end()) {
-         return std::prev(fScalerMap.find(address)->second.end())->second[index] /
-                fScalerMap.find(address)->second.size();
-      }
-      // if this is the before or at the first scaler, we just return the first scaler
-      if(currIt == fScalerMap.find(address)->second.begin()) {
-         return fScalerMap.find(address)->second.begin()->second[index];
-      }
-      // otherwise we return the scaler minus the previous scaler
-      return (currIt->second[index]) - (std::prev(currIt)->second[index]);
+   BuildIndex();
+   // Check that this address exists
+   size_t begin;
+   size_t end;
+   if(!fIndex.Range(address, begin, end)) {
+      return 0;
+   }
+   size_t row = fIndex.LowerBound(begin, end, time);
+   // if the time is after our last entry, we return the last entry divided by the number of entries
+   if(row == end) {
+      return fIndex.GetScaler(end - 1, index) / (end - begin);
+   }
+   // if this is the before or at the first scaler, we just return the first scaler
+   if(row == begin) {
+      return fIndex.GetScaler(begin, index);
+   }
+   // otherwise we return the scaler minus the previous scaler
+   return fIndex.GetScaler(row, index) - fIndex.GetScaler(row - 1, index);
+}
+
+void TScaler::BuildIndex() const
+{
+   /// Reads all scaler data from the tree into the index (if that hasn't been done already).
+   if(!fIndex.Empty() || fTree == nullptr || fEntries == 0) {
+      return;
    }
-   // loop through the tree and find the right entry
    for(Long64_t entry = 0; entry < fEntries; ++entry) {
       fTree->GetEntry(entry);
-      // got the exact time match, so we look for the previous value
-      if(fScalerData->GetAddress() == address && fScalerData->GetTimeStamp() == time) {
-         UInt_t currentValue = fScalerData->GetScaler(index);
-         for(--entry; entry >= 0; --entry) {
-            if(fScalerData->GetAddress() == address) {
-               return currentValue - fScalerData->GetScaler(index);
-            }
-         }
-         return currentValue;
-      }
-      // got a scaler that is later than our requested time, so we need to find the previous time and return that one
-      if(fScalerData->GetAddress() == address && fScalerData->GetTimeStamp() > time) {
-         for(--entry; entry >= 0; --entry) {
-            if(fScalerData->GetAddress() == address) {
-               // got the current entry, so we look for the previous value
-               UInt_t currentValue = fScalerData->GetScaler(index);
-               for(--entry; entry >= 0; --entry) {
-                  if(fScalerData->GetAddress() == address) {
-                     return currentValue - fScalerData->GetScaler(index);
-                  }
-               }
-               // failed to find a previous entry, so we return the current value
-               return currentValue;
-            }
-         }
-         // if we failed to find any previous data we return zero
-         return 0;
-      }
+      fIndex.Add(fScalerData);
+   }
+   fIndex.Finalize(fEntries);
+}
+
+bool TScaler::ReadIndex()
+{
+   /// Reads the index from the directory of the tree, if it has been written there and matches the tree.
+   if(fTree == nullptr || fTree->GetDirectory() == nullptr) {
+      return false;
+   }
+   auto* index = dynamic_cast<TScalerIndex*>(fTree->GetDirectory()->Get("TScalerIndex"));
+   if(index == nullptr) {
+      return false;
+   }
+   bool valid = (index->GetTreeEntries() == fEntries);
+   if(valid) {
+      fIndex = *index;
    }
-   // failed to find any matching time, so we return 0 (???)
-   return 0;
+   delete index;
+   return valid;
+}
+
+bool TScaler::WriteIndex(TFile* file)
+{
+   /// Writes the index to the file (by default the file of the scaler tree), so that it is read instead of built the
+   /// next time this file is used.
+   BuildIndex();
+   if(fIndex.Empty()) {
+      return false;
+   }
+   if(file == nullptr && fTree != nullptr) {
+      file = fTree->GetCurrentFile();
+   }
+   if(file == nullptr) {
+      printf("No file opened to write to.\n");
+      return false;
+   }
+   TDirectory* oldDir    = gDirectory;
+   std::string oldOption = file->GetOption();
+   if(oldOption == "READ") {
+      file->ReOpen("UPDATE");
+   }
+   file->cd();
+   fIndex.Write("TScalerIndex", TObject::kOverwrite);
+   printf("Writing TScalerIndex to %s\n", file->GetName());
+   if(oldOption == "READ") {
+      printf("  Returning %s to \"%s\" mode.\n", file->GetName(), oldOption.c_str());
+      file->ReOpen("READ");
+   }
+   oldDir->cd();
+
+   return true;
 }
 
 void TScaler::Clear(Option_t*)
@@ -260,7 +414,7 @@ void TScaler::Clear(Option_t*)
       }
    }
    fHistRange.clear();
-   fScalerMap.clear();
+   fIndex.Clear();
 }
 
 TH1D* TScaler::Draw(UInt_t address, size_t index, Option_t* option)
@@ -510,18 +664,16 @@ ULong64_t TScaler::GetTimePeriod(UInt_t address)
    /// that occurs most often.
    /// Returns 0 if the address doesn't exist in the map.
    if(fTimePeriod[address] == 0) {
-      ULong64_t previousValue = 0;
-      for(Long64_t entry = 0; entry < fEntries; ++entry) {
-         fTree->GetEntry(entry);
-         if(fScalerData->GetAddress() == address) {
-            // fill the difference between the current and the next scaler (if we found a previous value and that one is
-            // smaller than the current one)
-            if(previousValue != 0 && previousValue < fScalerData->GetTimeStamp()) {
-               // compare timestamp of current element with that of the previous element
-               ULong64_t diff = fScalerData->GetTimeStamp() - previousValue;
+      BuildIndex();
+      size_t begin;
+      size_t end;
+      if(fIndex.Range(address, begin, end)) {
+         // the readouts of this address are sorted by time, so we only need to compare each with the previous one
+         for(size_t row = begin + 1; row < end; ++row) {
+            if(fIndex.GetTimeStamp(row - 1) != 0) {
+               ULong64_t diff = fIndex.GetTimeStamp(row) - fIndex.GetTimeStamp(row - 1);
                fNumberOfTimePeriods[address][diff]++;
             }
-            previousValue = fScalerData->GetTimeStamp();
          }
       }
       int counter = 0;
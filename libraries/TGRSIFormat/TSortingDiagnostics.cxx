@@ -1,5 +1,6 @@
 #include "TSortingDiagnostics.h"
 
+#include <algorithm>
 #include <fstream>
 #include <string>
 
@@ -23,24 +24,26 @@ TSortingDiagnostics::~TSortingDiagnostics() = default;
 void TSortingDiagnostics::Copy(TObject& obj) const
 {
    static_cast<TSortingDiagnostics&>(obj).fFragmentsOutOfOrder = fFragmentsOutOfOrder;
+   static_cast<TSortingDiagnostics&>(obj).fSortDepth           = fSortDepth;
+   static_cast<TSortingDiagnostics&>(obj).fAdaptiveSortDepth   = fAdaptiveSortDepth;
 }
 
 void TSortingDiagnostics::Clear(Option_t*)
 {
    fFragmentsOutOfOrder.clear();
+   fSortDepth         = 0;
+   fAdaptiveSortDepth = false;
 }
 
 void TSortingDiagnostics::OutOfOrder(long newFragTS, long oldFragTS, long newEntry)
 {
    fFragmentsOutOfOrder[oldFragTS] = std::make_pair(oldFragTS - newFragTS, newEntry);
-   // try and find a timestamp before newFragTS
-   size_t entry = 0;
-   if(!fPreviousTimeStamps.empty()) {
-      for(entry = fPreviousTimeStamps.size() - 1; entry > 0; --entry) {
-         if(fPreviousTimeStamps[entry] < newFragTS) {
-            break;
-         }
-      }
+   // find the last saved timestamp at or before newFragTS, the saved timestamps are a running maximum (see
+   // AddTimeStamp), so they are sorted and we can use a binary search
+   size_t entry = std::upper_bound(fPreviousTimeStamps.begin(), fPreviousTimeStamps.end(), newFragTS) -
+                  fPreviousTimeStamps.begin();
+   if(entry > 0) {
+      --entry;
    }
    long entryDiff = newEntry - (entry * TGRSIOptions::Get()->SortDepth());
    if(entryDiff > fMaxEntryDiff) {
@@ -53,6 +56,9 @@ void TSortingDiagnostics::Print(Option_t* opt) const
    TString option = opt;
    option.ToUpper();
    std::string color;
+   if(fAdaptiveSortDepth) {
+      std::cout<<"Adaptive sort depth went up to "<<fSortDepth<<" fragments."<<std::endl;
+   }
    if(fFragmentsOutOfOrder.empty()) {
       if(option.EqualTo("ERROR")) {
          color = DGREEN;
@@ -79,5 +85,6 @@ void TSortingDiagnostics::WriteToFile(const char* fileName) const
    statsOut<<std::endl
            <<"Number of fragments out of order = "<<NumberOfFragmentsOutOfOrder()<<std::endl
            <<"Maximum entry difference = "<<fMaxEntryDiff<<std::endl
+           <<(fAdaptiveSortDepth ? "Largest adaptive sort depth = " : "Sort depth = ")<<fSortDepth<<std::endl
            <<std::endl;
 }
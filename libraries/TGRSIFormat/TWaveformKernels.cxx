@@ -0,0 +1,187 @@
+#include "TWaveformKernels.h"
+
+TWaveformKernels::TWorkspace& TWaveformKernels::ThreadWorkspace()
+{
+   thread_local TWorkspace workspace;
+   return workspace;
+}
+
+void TWaveformKernels::CorrectBaseline(Short_t* wave, size_t n, size_t nofAdcs)
+{
+   /// Corrects the samples of each of the nofAdcs interleaved ADCs with the (rounded) average of the first two samples
+   /// of that ADC.
+   if(nofAdcs == 0 || nofAdcs > 64) {
+      return;
+   }
+   Int_t baseline[64] = {0};
+   for(size_t i = 0; i < nofAdcs && i < n; ++i) {
+      baseline[i] = wave[i];
+   }
+   for(size_t i = nofAdcs; i < 2 * nofAdcs && i < n; ++i) {
+      Int_t sum               = baseline[i - nofAdcs] + wave[i];
+      baseline[i - nofAdcs] = (sum + (sum > 0 ? 1 : -1)) >> 1;
+   }
+   // whole blocks of nofAdcs samples first, this inner loop vectorizes
+   size_t i = 0;
+   for(; i + nofAdcs <= n; i += nofAdcs) {
+      for(size_t j = 0; j < nofAdcs; ++j) {
+         wave[i + j] -= baseline[j];
+      }
+   }
+   for(size_t j = 0; i < n; ++i, ++j) {
+      wave[i] -= baseline[j];
+   }
+}
+
+void TWaveformKernels::Moments(const Short_t* wave, size_t n, Long64_t& sum, Long64_t& sumOfSquares)
+{
+   /// Calculates the sum and the sum of squares of the first n samples (e.g. for the mean and standard deviation of
+   /// the baseline).
+   Long64_t s  = 0;
+   Long64_t s2 = 0;
+   for(size_t i = 0; i < n; ++i) {
+      s += wave[i];
+      s2 += static_cast<Int_t>(wave[i]) * wave[i];
+   }
+   sum          = s;
+   sumOfSquares = s2;
+}
+
+void TWaveformKernels::RunningSum(const Short_t* wave, size_t n, size_t window, Int_t* sums)
+{
+   /// Fills sums with the n - window + 1 sums of window consecutive samples, sums[i] being the sum of samples i to
+   /// i + window - 1. Uses one addition and one subtraction per sample instead of window additions.
+   if(window > n) {
+      return;
+   }
+   Int_t sum = 0;
+   for(size_t i = 0; i < window; ++i) {
+      sum += wave[i];
+   }
+   sums[0] = sum;
+   for(size_t i = window; i < n; ++i) {
+      sum += wave[i] - wave[i - window];
+      sums[i - window + 1] = sum;
+   }
+}
+
+size_t TWaveformKernels::Smooth(const Short_t* wave, size_t n, unsigned int halfWindow, Short_t* smoothed)
+{
+   /// Moving sum over 2*halfWindow + 1 samples, truncated to 16 bit like the smoothed waveforms of the detector hits
+   /// always were. Returns the number of smoothed samples (n - 2*halfWindow).
+   size_t window = 2 * static_cast<size_t>(halfWindow) + 1;
+   if(window > n) {
+      return 0;
+   }
+   Int_t sum = 0;
+   for(size_t i = 0; i < window; ++i) {
+      sum += wave[i];
+   }
+   smoothed[0] = static_cast<Short_t>(sum);
+   for(size_t i = window; i < n; ++i) {
+      sum += wave[i] - wave[i - window];
+      smoothed[i - window + 1] = static_cast<Short_t>(sum);
+   }
+   return n - window + 1;
+}
+
+size_t TWaveformKernels::CfdMonitor(const Short_t* wave, size_t n, double attenuation, unsigned int delay,
+                                    Short_t* monitor)
+{
+   /// Fills monitor with attenuation*wave[i + delay] - wave[i] and returns the number of monitor samples (n - delay).
+   if(n <= delay) {
+      return 0;
+   }
+   size_t size = n - delay;
+   for(size_t i = 0; i < size; ++i) {
+      monitor[i] = static_cast<Short_t>(attenuation * wave[i + delay] - wave[i]);
+   }
+   return size;
+}
+
+Int_t TWaveformKernels::CfdZeroCrossing(const Short_t* monitor, size_t n, unsigned int interpolationSteps)
+{
+   /// Returns the (linearly interpolated) time of the last zero crossing of the monitor after it was armed by a new
+   /// maximum, in units of 1/interpolationSteps samples, or 0 if there is none.
+   if(n == 0) {
+      return 0;
+   }
+   Short_t monitorMax = 0;
+   bool    armed      = false;
+   Int_t   cfd        = 0;
+   if(monitor[0] > monitorMax) {
+      armed      = true;
+      monitorMax = monitor[0];
+   }
+   for(size_t i = 1; i < n; ++i) {
+      if(monitor[i] > monitorMax) {
+         armed      = true;
+         monitorMax = monitor[i];
+      } else if(armed && monitor[i] < 0) {
+         armed = false;
+         if(monitor[i - 1] - monitor[i] != 0) {
+            // Linear interpolation.
+            cfd = (i - 1) * interpolationSteps + (monitor[i - 1] * interpolationSteps) / (monitor[i - 1] - monitor[i]);
+         } else {
+            // Should be impossible, since monitor[i-1] => 0 and monitor[i] < 0
+            cfd = 0;
+         }
+      }
+   }
+   return cfd;
+}
+
+Int_t TWaveformKernels::Cfd(const Short_t* wave, size_t n, double attenuation, unsigned int delay,
+                            unsigned int halfWindow, unsigned int interpolationSteps, TWorkspace& workspace,
+                            size_t* monitorSize)
+{
+   /// Smooths the waveform (if halfWindow > 0), calculates the CFD monitor in workspace.Monitor(), and returns the
+   /// time of its zero crossing (see CfdZeroCrossing). If monitorSize is given, it's set to the number of monitor
+   /// samples.
+   size_t size = 0;
+   if(n > delay + 1) {
+      const Short_t* input = wave;
+      size_t         m     = n;
+      if(halfWindow > 0) {
+         Short_t* smoothed = workspace.Smoothed(n);
+         m                 = Smooth(wave, n, halfWindow, smoothed);
+         input             = smoothed;
+      }
+      size = CfdMonitor(input, m, attenuation, delay, workspace.Monitor(n));
+   }
+   if(monitorSize != nullptr) {
+      *monitorSize = size;
+   }
+   return CfdZeroCrossing(workspace.Monitor(size), size, interpolationSteps);
+}
+
+void TWaveformKernels::PartialSum(const Short_t* wave, size_t n, Int_t* sums)
+{
+   /// Fills sums with the running integral of the waveform.
+   Int_t sum = 0;
+   for(size_t i = 0; i < n; ++i) {
+      sum += wave[i];
+      sums[i] = sum;
+   }
+}
+
+Int_t TWaveformKernels::Psd(const Short_t* wave, const Int_t* partialSums, size_t n, double fraction,
+                            unsigned int interpolationSteps)
+{
+   /// Returns the time (in units of 1/interpolationSteps samples) when the partial sum reaches fraction of the total
+   /// sum, or -1 if there are no samples.
+   if(n == 0) {
+      return -1;
+   }
+   Int_t  psd       = 0;
+   double threshold = fraction * partialSums[n - 1];
+   if(partialSums[0] < threshold) {
+      for(size_t i = 1; i < n; ++i) {
+         if(partialSums[i] >= threshold) {
+            psd = i * interpolationSteps - ((partialSums[i] - threshold) * interpolationSteps) / wave[i];
+            break;
+         }
+      }
+   }
+   return psd;
+}
@@ -30,10 +30,51 @@
 #include "TSystem.h"
 #include "TH2.h"
 #include "TStyle.h"
+#include "TBranch.h"
 /// \cond CLASSIMP
 ClassImp(TGRSISelector)
 /// \endcond
 
+namespace {
+void EnableBranch(TBranch* branch)
+{
+   /// enables the branch and all its sub-branches
+   branch->ResetBit(kDoNotProcess);
+   TIter next(branch->GetListOfBranches());
+   while(TBranch* sub = static_cast<TBranch*>(next())) {
+      EnableBranch(sub);
+   }
+}
+
+bool EnableMembers(TBranch* branch, const std::vector<std::string>& members)
+{
+   /// Enables all sub-branches of the split branch that hold one of the members (e.g. "fAddress" matches
+   /// "fGriffinHits.fAddress"), and their parents. Returns true if any sub-branch was enabled.
+   bool  enabled = false;
+   TIter next(branch->GetListOfBranches());
+   while(TBranch* sub = static_cast<TBranch*>(next())) {
+      std::string name = sub->GetName();
+      bool        match = false;
+      for(const auto& member : members) {
+         if(name == member ||
+            (name.size() > member.size() && name.compare(name.size() - member.size(), member.size(), member) == 0 &&
+             name[name.size() - member.size() - 1] == '.')) {
+            match = true;
+            break;
+         }
+      }
+      if(match) {
+         EnableBranch(sub);
+         enabled = true;
+      } else if(EnableMembers(sub, members)) {
+         sub->ResetBit(kDoNotProcess);
+         enabled = true;
+      }
+   }
+   return enabled;
+}
+} // namespace
+
 void TGRSISelector::Begin(TTree* /*tree*/)
 {
    /// The Begin() function is called at the start of the query.
@@ -132,7 +173,17 @@ Bool_t TGRSISelector::Process(Long64_t entry)
       //   TChannel::WriteCalFile();
    }
 
-   fChain->GetEntry(entry);
+   fCurrentEntry = entry;
+   if(fBranchRequests.empty()) {
+      fChain->GetEntry(entry);
+   } else {
+      for(auto& request : fBranchRequests) {
+         if(!request.second.fLazy && request.second.fBranch != nullptr) {
+            request.second.fBranch->GetEntry(entry);
+            request.second.fLoadedEntry = entry;
+         }
+      }
+   }
    FillHistograms();
 
    return kTRUE;
@@ -178,6 +229,7 @@ void TGRSISelector::Init(TTree* tree)
    }
    fChain = tree;
    InitializeBranches(tree);
+   ApplyBranchRequests();
 }
 
 Bool_t TGRSISelector::Notify()
@@ -188,5 +240,88 @@ Bool_t TGRSISelector::Notify()
    /// to the generated code, but the routine can be extended by the
    /// user if needed. The return value is currently not used.
 
+   ApplyBranchRequests();
    return kTRUE;
 }
+
+void TGRSISelector::UseBranch(const std::string& name, const std::vector<std::string>& members, bool lazy)
+{
+   /// Declares a branch (i.e. detector class) FillHistograms needs, meant to be called from InitializeBranches. Once
+   /// any branch has been declared, only the declared branches are read, all others are disabled.
+   /// If members are given (e.g. {"fAddress", "fCharge", "fTimeStamp", "fCfd"}), only these members of the split
+   /// branch are read, all other members (including those of the detector itself) keep their default values.
+   /// A lazy branch isn't read by Process, but only when LoadBranch(name) is called for the current entry, e.g.
+   /// TSceptar only after a condition on TGriffin is fulfilled. Until then it still holds the previously read entry.
+   TBranchRequest& request = fBranchRequests[name];
+   request.fMembers        = members;
+   request.fLazy           = lazy;
+   request.fLoadedEntry    = -1;
+}
+
+bool TGRSISelector::LoadBranch(const std::string& name)
+{
+   /// Reads the current entry of a branch declared via UseBranch, if it hasn't been read yet. Returns false if the
+   /// branch wasn't declared or doesn't exist in the current tree.
+   auto it = fBranchRequests.find(name);
+   if(it == fBranchRequests.end() || it->second.fBranch == nullptr) {
+      return false;
+   }
+   if(it->second.fLoadedEntry != fCurrentEntry) {
+      it->second.fBranch->GetEntry(fCurrentEntry);
+      it->second.fLoadedEntry = fCurrentEntry;
+   }
+   return true;
+}
+
+TH2* TGRSISelector::CreateMatrix(const char* name, const char* title, Int_t nbinsx, Double_t xlow, Double_t xup,
+                                 Int_t nbinsy, Double_t ylow, Double_t yup)
+{
+   /// Creates a matrix for unweighted fills, as a TH2I if compact matrices were requested (--compact-matrices), and as
+   /// a TH2D otherwise. A TH2I needs half the memory of a TH2D, both on the workers and when the outputs are merged.
+   if(TGRSIOptions::AnalysisOptions()->CompactMatrices()) {
+      return new TH2I(name, title, nbinsx, xlow, xup, nbinsy, ylow, yup);
+   }
+   return new TH2D(name, title, nbinsx, xlow, xup, nbinsy, ylow, yup);
+}
+
+GHSym* TGRSISelector::CreateSymMatrix(const char* name, const char* title, Int_t nbins, Double_t low, Double_t up)
+{
+   /// Creates a symmetric matrix (only one triangle is stored), as a GHSymI if compact matrices were requested
+   /// (--compact-matrices), and as a GHSymD otherwise.
+   if(TGRSIOptions::AnalysisOptions()->CompactMatrices()) {
+      return new GHSymI(name, title, nbins, low, up);
+   }
+   return new GHSymD(name, title, nbins, low, up);
+}
+
+void TGRSISelector::ApplyBranchRequests()
+{
+   /// Disables all branches that weren't declared via UseBranch and finds the declared branches in the current tree.
+   /// Has to be done for each new tree (i.e. in Init and Notify).
+   if(fBranchRequests.empty() || fChain == nullptr) {
+      return;
+   }
+   TTree* tree = fChain->GetTree();
+   if(tree == nullptr) {
+      // a chain that hasn't loaded a tree yet, we'll be called again from Notify
+      return;
+   }
+
+   tree->SetBranchStatus("*", 0);
+   for(auto& request : fBranchRequests) {
+      request.second.fBranch      = tree->GetBranch(request.first.c_str());
+      request.second.fLoadedEntry = -1;
+      if(request.second.fBranch == nullptr) {
+         std::cout<<"Warning, branch \""<<request.first<<"\" not found, it won't be read!"<<std::endl;
+         continue;
+      }
+      // the sub-branches of the detector branches aren't prefixed with the name of the detector, so we can't use
+      // TTree::SetBranchStatus for them
+      if(request.second.fMembers.empty()) {
+         EnableBranch(request.second.fBranch);
+      } else {
+         request.second.fBranch->ResetBit(kDoNotProcess);
+         EnableMembers(request.second.fBranch, request.second.fMembers);
+      }
+   }
+}
@@ -25,6 +25,8 @@ void TAnalysisOptions::Clear(Option_t*)
    fStaticWindow          = false;
    fWaveformFitting       = false;
    fIsCorrectingCrossTalk = true;
+   fDeterministicDither   = false;
+   fCompactMatrices       = false;
 }
 
 void TAnalysisOptions::Print(Option_t*) const
@@ -35,6 +37,8 @@ void TAnalysisOptions::Print(Option_t*) const
             <<BLUE<<"fStaticWindow: "<<DCYAN<<fStaticWindow<<std::endl
             <<BLUE<<"fWaveformFitting: "<<DCYAN<<fWaveformFitting<<std::endl
             <<BLUE<<"fIsCorrectingCrossTalk: "<<DCYAN<<fIsCorrectingCrossTalk<<std::endl
+            <<BLUE<<"fDeterministicDither: "<<DCYAN<<fDeterministicDither<<std::endl
+            <<BLUE<<"fCompactMatrices: "<<DCYAN<<fCompactMatrices<<std::endl
             <<RESET_COLOR<<std::endl;
 }
 
@@ -94,8 +94,20 @@ void TGRSIOptions::Clear(Option_t*)
 
    fFragmentWriteQueueSize = 10000000;
    fAnalysisWriteQueueSize = 1000000;
-
-   fTimeSortInput = false;
+   fLockFreeQueues         = false;
+   fFragmentBatchSize      = 1;
+   fUnpackingThreads       = 1;
+   fFragmentPoolSize       = 100000;
+   fDetBuildingThreads     = 1;
+   fHistogramThreads       = 1;
+   fReadingThreads         = 1;
+   fWaveformFittingThreads = 0;
+
+   fTimeSortInput     = false;
+   fMultisetSorting   = false;
+   fAdaptiveSortDepth = false;
+   fMaxSortDepth      = 2000000;
+   fOutOfOrderRate    = 1e-6;
 
    fSeparateOutOfOrder    = false;
 
@@ -152,9 +164,21 @@ void TGRSIOptions::Print(Option_t*) const
             <<std::endl
             <<"fFragmentWriteQueueSize: "<<fFragmentWriteQueueSize<<std::endl
             <<"fAnalysisWriteQueueSize: "<<fAnalysisWriteQueueSize<<std::endl
+            <<"fLockFreeQueues: "<<fLockFreeQueues<<std::endl
+            <<"fFragmentBatchSize: "<<fFragmentBatchSize<<std::endl
+            <<"fUnpackingThreads: "<<fUnpackingThreads<<std::endl
+            <<"fFragmentPoolSize: "<<fFragmentPoolSize<<std::endl
+            <<"fDetBuildingThreads: "<<fDetBuildingThreads<<std::endl
+            <<"fHistogramThreads: "<<fHistogramThreads<<std::endl
+            <<"fReadingThreads: "<<fReadingThreads<<std::endl
+            <<"fWaveformFittingThreads: "<<fWaveformFittingThreads<<std::endl
             <<std::endl
             <<"fTimeSortInput: "<<fTimeSortInput<<std::endl
             <<"fSortDepth: "<<fSortDepth<<std::endl
+            <<"fMultisetSorting: "<<fMultisetSorting<<std::endl
+            <<"fAdaptiveSortDepth: "<<fAdaptiveSortDepth<<std::endl
+            <<"fMaxSortDepth: "<<fMaxSortDepth<<std::endl
+            <<"fOutOfOrderRate: "<<fOutOfOrderRate<<std::endl
             <<std::endl
             <<"fSeparateOutOfOrder: "<<fSeparateOutOfOrder<<std::endl
             <<std::endl
@@ -226,6 +250,10 @@ void TGRSIOptions::Load(int argc, char** argv)
 		.description("fit waveforms using SFU algorithms");
 	parser.option("is-correcting-cross-talk", &fAnalysisOptions->fIsCorrectingCrossTalk, false).takes_argument()
 		.description("Correct cross-talk");
+	parser.option("deterministic-dither", &fAnalysisOptions->fDeterministicDither, false)
+		.description("derive dithers of charges and times from address and timestamp (output independent of threads)");
+	parser.option("compact-matrices", &fAnalysisOptions->fCompactMatrices, false)
+		.description("create large matrices of selectors with integer bins (halves memory use and merging on PROOF)");
 
 	// program specific options
 	if(program.compare("grsisort") == 0) {
@@ -245,6 +273,16 @@ void TGRSIOptions::Load(int argc, char** argv)
 		parser.option("sort-depth", &fSortDepth, true)
 			.description("Number of events to hold when sorting by time/trigger_id")
 			.default_value(200000);
+		parser.option("multiset-sorting", &fMultisetSorting, true)
+			.description("sort fragments with a std::multiset instead of merging sorted runs (slower, same events)");
+		parser.option("adaptive-sort-depth", &fAdaptiveSortDepth, true)
+			.description("adapt the sort depth (starting at --sort-depth) to the disorder of the timestamps/trigger ids");
+		parser.option("max-sort-depth", &fMaxSortDepth, true)
+			.description("maximum sort depth with --adaptive-sort-depth")
+			.default_value(2000000);
+		parser.option("out-of-order-rate", &fOutOfOrderRate, true)
+			.description("fraction of fragments the adaptive sort depth may leave out of order")
+			.default_value(1e-6);
 		parser.option("s sort", &fSortRoot, true).description("Attempt to loop through root files.");
 
 		parser.option("q quit", &fCloseAfterSort, true).description("Run in batch mode");
@@ -278,6 +316,29 @@ void TGRSIOptions::Load(int argc, char** argv)
 		parser.option("analysis-size", &fAnalysisWriteQueueSize, true)
 			.description("size of analysis write queue")
 			.default_value(1000000);
+		parser.option("lock-free-queues", &fLockFreeQueues, true)
+			.description("use lock-free ring buffers for the queues between loops (at most 65536 slots each, allocated up front)");
+		parser.option("fragment-batch-size", &fFragmentBatchSize, true)
+			.description("number of fragments passed between loops at once, e.g. 2048 for offline sorting (1 = no batching)")
+			.default_value(1);
+		parser.option("unpacking-threads", &fUnpackingThreads, true)
+			.description("number of threads used to unpack midas events (1 = serial unpacking)")
+			.default_value(1);
+		parser.option("fragment-pool-size", &fFragmentPoolSize, true)
+			.description("maximum number of fragments recycled by each unpacking thread (0 = no recycling)")
+			.default_value(100000);
+		parser.option("detector-building-threads", &fDetBuildingThreads, true)
+			.description("number of threads used to build detectors from events (1 = single thread)")
+			.default_value(1);
+		parser.option("histogram-threads", &fHistogramThreads, true)
+			.description("number of threads used to fill the fragment and analysis histograms (1 = single thread)")
+			.default_value(1);
+		parser.option("reading-threads", &fReadingThreads, true)
+			.description("number of threads used to read and decompress fragments from fragment trees (1 = single thread)")
+			.default_value(1);
+		parser.option("waveform-fitting-threads", &fWaveformFittingThreads, true)
+			.description("number of threads used to fit the waveforms of blocks of events (0 = fit each hit when it is built)")
+			.default_value(0);
 
 		parser.option("column-width", &fColumnWidth, true).description("width of one column of status").default_value(20);
 		parser.option("status-width", &fStatusWidth, true)
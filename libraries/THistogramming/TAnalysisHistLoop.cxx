@@ -26,6 +26,7 @@ TAnalysisHistLoop::TAnalysisHistLoop(std::string name)
    : StoppableThread(name), fOutputFile(nullptr), fOutputFilename("last.root"),
      fInputQueue(std::make_shared<ThreadsafeQueue<std::shared_ptr<TUnpackedEvent>>>())
 {
+   fCompiledHistograms.SetNumberOfThreads(TGRSIOptions::Get()->HistogramThreads());
    LoadLibrary(TGRSIOptions::Get()->AnalysisHistogramLib());
 }
 
@@ -121,6 +122,8 @@ std::string TAnalysisHistLoop::GetLibraryName() const
 
 TList* TAnalysisHistLoop::GetObjects()
 {
+   // with several filling threads the histograms in this list are only updated when merging
+   fCompiledHistograms.MergeShards();
    return fCompiledHistograms.GetObjects();
 }
 
@@ -3,6 +3,7 @@
 #include <algorithm>
 #include <fstream>
 #include <iostream>
+#include <map>
 #include <utility>
 
 #include <sys/stat.h>
@@ -16,16 +17,34 @@
 
 #include "GValue.h"
 #include "GRootCommands.h"
+#include "TGRSIOptions.h"
 #include "TPreserveGDirectory.h"
 
 using void_alias = void*;
 
 TCompiledHistograms::TCompiledHistograms()
    : fLibname(""), fFunc_name(""), fLibrary(nullptr), fFunc(nullptr), fLast_modified(0), fLast_checked(0),
-     fCheck_every(5), fDefault_directory(nullptr), fObj(&fObjects, &fGates, fCut_files)
+     fCheck_every(5), fDefault_directory(nullptr), fObj(&fObjects, &fGates, fCut_files), fNumberOfThreads(1),
+     fLibraryGeneration(0)
 {
 }
 
+TCompiledHistograms::~TCompiledHistograms()
+{
+   StopWorkers();
+}
+
+TCompiledHistograms::THistogramShard::THistogramShard(const std::string& name, TList* gates,
+                                                      std::vector<TFile*>& cutFiles)
+   : fDirectory(nullptr), fObj(&fObjects, gates, cutFiles, nullptr, name.c_str())
+{
+   // the shard directory lives in memory, so that its histograms never end up in the output file
+   TPreserveGDirectory preserve;
+   gROOT->cd();
+   fDirectory = new TDirectory(name.c_str(), name.c_str());
+   fObj.SetDirectory(fDirectory);
+}
+
 TCompiledHistograms::TCompiledHistograms(std::string input_lib, std::string func_name) : TCompiledHistograms()
 {
 
@@ -47,6 +66,25 @@ void TCompiledHistograms::ClearHistograms()
 {
    std::lock_guard<std::mutex> lock(fMutex);
 
+   for(auto& shard : fShards) {
+      std::lock_guard<std::mutex> shardLock(shard->fMutex);
+      TIter                       shardNext(&shard->fObjects);
+      TObject*                    shardObj;
+      while((shardObj = shardNext()) != nullptr) {
+         if(shardObj->InheritsFrom(TH1::Class())) {
+            static_cast<TH1*>(shardObj)->Reset();
+         } else if(shardObj->InheritsFrom(TDirectory::Class())) {
+            TIter    dirnext(static_cast<TDirectory*>(shardObj)->GetList());
+            TObject* dirobj;
+            while((dirobj = dirnext()) != nullptr) {
+               if(dirobj->InheritsFrom(TH1::Class())) {
+                  static_cast<TH1*>(dirobj)->Reset();
+               }
+            }
+         }
+      }
+   }
+
    TIter    next(&fObjects);
    TObject* obj;
    while((obj = next()) != nullptr) {
@@ -83,6 +121,10 @@ bool TCompiledHistograms::file_exists()
 
 Int_t TCompiledHistograms::Write(const char*, Int_t, Int_t)
 {
+   // all queued fragments/events have to be histogrammed before we write
+   StopWorkers();
+   MergeShards();
+
    fObjects.Sort();
 
    TIter    next(&fObjects);
@@ -133,10 +175,15 @@ void TCompiledHistograms::swap_lib(TCompiledHistograms& other)
    std::swap(fLast_modified, other.fLast_modified);
    std::swap(fLast_checked, other.fLast_checked);
    std::swap(fCheck_every, other.fCheck_every);
+   ++fLibraryGeneration;
 }
 
 void TCompiledHistograms::Fill(std::shared_ptr<const TFragment> frag)
 {
+   if(fNumberOfThreads > 1) {
+      QueueJob({std::move(frag), nullptr});
+      return;
+   }
    std::lock_guard<std::mutex> lock(fMutex);
    if(time(nullptr) > fLast_checked + fCheck_every) {
       Reload();
@@ -157,6 +204,10 @@ void TCompiledHistograms::Fill(std::shared_ptr<const TFragment> frag)
 
 void TCompiledHistograms::Fill(std::shared_ptr<TUnpackedEvent> detectors)
 {
+   if(fNumberOfThreads > 1) {
+      QueueJob({nullptr, std::move(detectors)});
+      return;
+   }
    std::lock_guard<std::mutex> lock(fMutex);
    if(time(nullptr) > fLast_checked + fCheck_every) {
       Reload();
@@ -175,6 +226,172 @@ void TCompiledHistograms::Fill(std::shared_ptr<TUnpackedEvent> detectors)
    fObj.SetDetectors(nullptr);
 }
 
+void TCompiledHistograms::QueueJob(TFillJob job)
+{
+   /// Hands the fragment/event to the filling threads, starting them if necessary.
+   {
+      std::lock_guard<std::mutex> lock(fMutex);
+      if(time(nullptr) > fLast_checked + fCheck_every) {
+         Reload();
+      }
+
+      if(!fLibrary || (fFunc == nullptr) || (fDefault_directory == nullptr)) {
+         return;
+      }
+
+      if(fWorkers.empty()) {
+         StartWorkers();
+      }
+   }
+
+   fJobQueue->Push(std::move(job));
+}
+
+void TCompiledHistograms::StartWorkers()
+{
+   /// Starts the filling threads, each with its own shard of the histograms. Must be called with fMutex locked.
+   // histograms are created in the filling threads
+   ROOT::EnableThreadSafety();
+
+   EQueueType type = TGRSIOptions::Get()->LockFreeQueues() ? EQueueType::kMPMC : EQueueType::kMutex;
+   fJobQueue       = std::make_shared<ThreadsafeQueue<TFillJob>>("histogram_job_queue", 1024 * fNumberOfThreads, type);
+
+   while(fShards.size() < static_cast<size_t>(fNumberOfThreads)) {
+      fShards.emplace_back(new THistogramShard(Form("%s_shard_%d", fFunc_name.c_str(), static_cast<int>(fShards.size())),
+                                               &fGates, fCut_files));
+   }
+   for(int i = 0; i < fNumberOfThreads; ++i) {
+      fWorkers.emplace_back(&TCompiledHistograms::FillingThread, this, fShards[i].get());
+   }
+}
+
+void TCompiledHistograms::StopWorkers()
+{
+   /// Waits until the filling threads have histogrammed all queued fragments/events and stops them. They are started
+   /// again by the next call to Fill.
+   if(fWorkers.empty()) {
+      return;
+   }
+   fJobQueue->SetFinished();
+   for(auto& worker : fWorkers) {
+      worker.join();
+   }
+   fWorkers.clear();
+}
+
+void TCompiledHistograms::FillingThread(THistogramShard* shard)
+{
+   /// Runs the user function for each fragment/event in the job queue on the histograms of this shard, until the job
+   /// queue is finished.
+   size_t                           generation = 0;
+   std::shared_ptr<DynamicLibrary> library; // keeps the library loaded while we use its function
+   void (*func)(TRuntimeObjects&) = nullptr;
+
+   TFillJob job;
+   while(true) {
+      if(fJobQueue->Pop(job, 100) < 0) {
+         if(fJobQueue->IsFinished()) {
+            break;
+         }
+         continue;
+      }
+      if(func == nullptr || generation != fLibraryGeneration.load()) {
+         std::lock_guard<std::mutex> lock(fMutex);
+         generation = fLibraryGeneration.load();
+         library    = fLibrary;
+         func       = fFunc;
+      }
+      if(func == nullptr) {
+         continue;
+      }
+
+      std::lock_guard<std::mutex> lock(shard->fMutex);
+      shard->fDirectory->cd();
+      if(job.fFragment) {
+         shard->fObj.SetFragment(std::move(job.fFragment));
+         func(shard->fObj);
+         shard->fObj.SetFragment(nullptr);
+      } else {
+         shard->fObj.SetDetectors(std::move(job.fDetectors));
+         func(shard->fObj);
+         shard->fObj.SetDetectors(nullptr);
+      }
+      job = TFillJob();
+   }
+}
+
+void TCompiledHistograms::MergeShards()
+{
+   /// Adds up the histograms of all filling threads into GetObjects(). The histograms in GetObjects() only hold the
+   /// merged content, so they are reset first. This can be called while the threads are filling (e.g. to look at the
+   /// online histograms), in which case fragments/events still waiting in the queue are missing.
+   std::lock_guard<std::mutex> lock(fMutex);
+   if(fShards.empty()) {
+      return;
+   }
+
+   // locking all shards gives a consistent snapshot
+   std::vector<std::unique_lock<std::mutex>> shardLocks;
+   std::vector<TList*>                       sources;
+   for(auto& shard : fShards) {
+      shardLocks.emplace_back(shard->fMutex);
+      sources.push_back(&shard->fObjects);
+   }
+
+   TPreserveGDirectory preserve;
+   MergeObjects(&fObjects, sources, fDefault_directory);
+}
+
+void TCompiledHistograms::MergeObjects(TList* target, const std::vector<TList*>& sources, TDirectory* directory)
+{
+   /// Merges the histograms in the source lists into the histograms of the same name in target, creating them if
+   /// necessary. Directories are merged recursively.
+   std::map<std::string, std::vector<TH1*>>   histograms;
+   std::map<std::string, std::vector<TList*>> directories;
+   for(auto* source : sources) {
+      TIter    next(source);
+      TObject* obj;
+      while((obj = next()) != nullptr) {
+         if(obj->InheritsFrom(TH1::Class())) {
+            histograms[obj->GetName()].push_back(static_cast<TH1*>(obj));
+         } else if(obj->InheritsFrom(TDirectory::Class())) {
+            directories[obj->GetName()].push_back(static_cast<TDirectory*>(obj)->GetList());
+         }
+      }
+   }
+
+   for(auto& hist : histograms) {
+      TH1* merged = static_cast<TH1*>(target->FindObject(hist.first.c_str()));
+      if(merged == nullptr) {
+         merged = static_cast<TH1*>(hist.second[0]->Clone());
+         merged->SetDirectory(directory);
+         // for sub-directories the target is the list of the directory, which SetDirectory already added us to
+         if(directory == nullptr || target != directory->GetList()) {
+            target->Add(merged);
+         }
+      }
+      merged->Reset();
+      // Merge instead of Add, because e.g. GHSym and GCube don't store their bins like a TH2/TH3
+      TList list;
+      for(auto* shardHist : hist.second) {
+         list.Add(shardHist);
+      }
+      merged->Merge(&list);
+   }
+
+   for(auto& dir : directories) {
+      TDirectory* merged = static_cast<TDirectory*>(target->FindObject(dir.first.c_str()));
+      if(merged == nullptr) {
+         if(directory != nullptr) {
+            directory->cd();
+         }
+         merged = new TDirectory(dir.first.c_str(), dir.first.c_str());
+         target->Add(merged);
+      }
+      MergeObjects(merged->GetList(), dir.second, merged);
+   }
+}
+
 void TCompiledHistograms::AddCutFile(TFile* cut_file)
 {
    if(cut_file != nullptr) {
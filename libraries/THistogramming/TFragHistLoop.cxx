@@ -1,3 +1,4 @@
+#include <algorithm>
 #include <utility>
 
 #include "TFragHistLoop.h"
@@ -24,8 +25,10 @@ TFragHistLoop* TFragHistLoop::Get(std::string name)
 
 TFragHistLoop::TFragHistLoop(std::string name)
    : StoppableThread(name), fOutputFile(nullptr), fOutputFilename("last.root"),
-     fInputQueue(std::make_shared<ThreadsafeQueue<std::shared_ptr<const TFragment>>>())
+     fInputQueue(std::make_shared<ThreadsafeQueue<std::shared_ptr<const TFragment>>>()),
+     fBatchSize(std::max(TGRSIOptions::Get()->FragmentBatchSize(), static_cast<size_t>(1)))
 {
+   fCompiledHistograms.SetNumberOfThreads(TGRSIOptions::Get()->HistogramThreads());
    LoadLibrary(TGRSIOptions::Get()->FragmentHistogramLib());
 }
 
@@ -44,16 +47,19 @@ void TFragHistLoop::ClearQueue()
 
 bool TFragHistLoop::Iteration()
 {
-   std::shared_ptr<const TFragment> event;
-   fInputSize = fInputQueue->Pop(event);
+   fInputBatch.clear();
+   fInputSize = fInputQueue->PopBatch(fInputBatch, fBatchSize);
 
-   if(event) {
+   if(!fInputBatch.empty()) {
       if(fOutputFile == nullptr) {
          OpenFile();
       }
 
-      fCompiledHistograms.Fill(event);
-      ++fItemsPopped;
+      for(const auto& event : fInputBatch) {
+         fCompiledHistograms.Fill(event);
+         ++fItemsPopped;
+      }
+      fInputBatch.clear();
       return true;
    }
    if(fInputQueue->IsFinished()) {
@@ -121,6 +127,8 @@ std::string TFragHistLoop::GetLibraryName() const
 
 TList* TFragHistLoop::GetObjects()
 {
+   // with several filling threads the histograms in this list are only updated when merging
+   fCompiledHistograms.MergeShards();
    return fCompiledHistograms.GetObjects();
 }
 
@@ -1,6 +1,8 @@
 #include "TRuntimeObjects.h"
 
+#include <cmath>
 #include <iostream>
+#include <limits>
 #include <utility>
 
 #include "TClass.h"
@@ -18,6 +20,9 @@
 #include "GValue.h"
 
 std::map<std::string, TRuntimeObjects*> TRuntimeObjects::fRuntimeMap;
+std::vector<TRuntimeObjects::THistogramSpec> TRuntimeObjects::fHandleSpecs;
+std::unordered_map<std::string, int>         TRuntimeObjects::fHandleIndex;
+std::mutex                                   TRuntimeObjects::fHandleMutex;
 
 TRuntimeObjects::TRuntimeObjects(std::shared_ptr<const TFragment> frag, TList* objects, TList* gates,
                                  std::vector<TFile*>& cut_files, TDirectory* directory, const char* name)
@@ -49,13 +54,13 @@ TRuntimeObjects::TRuntimeObjects(TList* objects, TList* gates, std::vector<TFile
 
 TH1* TRuntimeObjects::FillHistogram(const char* name, int bins, double low, double high, double value, double weight)
 {
-   TH1* hist = static_cast<TH1*>(GetObjects().FindObject(name));
+   TH1* hist = static_cast<TH1*>(FindIndexedObject(name));
    if(hist == nullptr) {
       hist = new GH1D(name, name, bins, low, high);
       if(fDirectory != nullptr) {
          hist->SetDirectory(fDirectory);
       }
-      GetObjects().Add(hist);
+      AddIndexedObject(hist);
    }
    if(!(std::isnan(value))) {
       hist->Fill(value, weight);
@@ -66,13 +71,13 @@ TH1* TRuntimeObjects::FillHistogram(const char* name, int bins, double low, doub
 TH2* TRuntimeObjects::FillHistogram(const char* name, int Xbins, double Xlow, double Xhigh, double Xvalue, int Ybins,
                                     double Ylow, double Yhigh, double Yvalue, double weight)
 {
-   TH2* hist = static_cast<TH2*>(GetObjects().FindObject(name));
+   TH2* hist = static_cast<TH2*>(FindIndexedObject(name));
    if(hist == nullptr) {
       hist = new GH2D(name, name, Xbins, Xlow, Xhigh, Ybins, Ylow, Yhigh);
       if(fDirectory != nullptr) {
          hist->SetDirectory(fDirectory);
       }
-      GetObjects().Add(hist);
+      AddIndexedObject(hist);
    }
    if(!std::isnan(Xvalue) && !std::isnan(Yvalue)) {
       hist->Fill(Xvalue, Yvalue, weight);
@@ -83,13 +88,13 @@ TH2* TRuntimeObjects::FillHistogram(const char* name, int Xbins, double Xlow, do
 TProfile* TRuntimeObjects::FillProfileHist(const char* name, int Xbins, double Xlow, double Xhigh, double Xvalue,
                                            double Yvalue)
 {
-   TProfile* prof = static_cast<TProfile*>(GetObjects().FindObject(name));
+   TProfile* prof = static_cast<TProfile*>(FindIndexedObject(name));
    if(prof == nullptr) {
       prof = new TProfile(name, name, Xbins, Xlow, Xhigh);
       if(fDirectory != nullptr) {
          prof->SetDirectory(fDirectory);
       }
-      GetObjects().Add(prof);
+      AddIndexedObject(prof);
    }
    if(!(std::isnan(Xvalue))) {
       if(!(std::isnan(Yvalue))) {
@@ -102,13 +107,13 @@ TProfile* TRuntimeObjects::FillProfileHist(const char* name, int Xbins, double X
 TH2* TRuntimeObjects::FillHistogramSym(const char* name, int Xbins, double Xlow, double Xhigh, double Xvalue, int Ybins,
                                        double Ylow, double Yhigh, double Yvalue)
 {
-   TH2* hist = static_cast<TH2*>(GetObjects().FindObject(name));
+   TH2* hist = static_cast<TH2*>(FindIndexedObject(name));
    if(hist == nullptr) {
       hist = new GH2D(name, name, Xbins, Xlow, Xhigh, Ybins, Ylow, Yhigh);
       if(fDirectory != nullptr) {
          hist->SetDirectory(fDirectory);
       }
-      GetObjects().Add(hist);
+      AddIndexedObject(hist);
    }
 
    if(!(std::isnan(Xvalue))) {
@@ -125,17 +130,13 @@ TDirectory* TRuntimeObjects::FillHistogram(const char* dirname, const char* name
                                            double value, double weight)
 {
 
-   TDirectory* dir = static_cast<TDirectory*>(GetObjects().FindObject(dirname));
-   if(dir == nullptr) {
-      dir = new TDirectory(dirname, dirname);
-      GetObjects().Add(dir);
-   }
+   TDirectory* dir = FindIndexedDirectory(dirname);
    dir->cd();
-   TH1* hist = static_cast<TH1*>(dir->FindObject(name));
+   TH1* hist = static_cast<TH1*>(FindIndexedObject(dir, dirname, name));
    if(hist == nullptr) {
       hist = new GH1D(name, name, bins, low, high);
       hist->SetDirectory(dir);
-      dir->Add(hist);
+      AddIndexedObject(dir, dirname, hist);
    }
 
    if(!std::isnan(value)) {
@@ -178,17 +179,13 @@ TDirectory* TRuntimeObjects::FillHistogram(const char* dirname, const char* name
                                            double Xvalue, int Ybins, double Ylow, double Yhigh, double Yvalue,
                                            double weight)
 {
-   TDirectory* dir = static_cast<TDirectory*>(GetObjects().FindObject(dirname));
-   if(dir == nullptr) {
-      dir = new TDirectory(dirname, dirname);
-      GetObjects().Add(dir);
-   }
+   TDirectory* dir = FindIndexedDirectory(dirname);
    dir->cd();
-   TH2* hist = static_cast<TH2*>(dir->FindObject(name));
+   TH2* hist = static_cast<TH2*>(FindIndexedObject(dir, dirname, name));
    if(hist == nullptr) {
       hist = new GH2D(name, name, Xbins, Xlow, Xhigh, Ybins, Ylow, Yhigh);
       hist->SetDirectory(dir);
-      dir->Add(hist);
+      AddIndexedObject(dir, dirname, hist);
    }
 
    if(!std::isnan(Xvalue) && !std::isnan(Yvalue)) {
@@ -202,7 +199,7 @@ TDirectory* TRuntimeObjects::FillHistogram(const char* dirname, const char* name
                   hist = new GH2D(name.c_str(),name.c_str(),
                   Xbins, Xlow, Xhigh,
                   Ybins, Ylow, Yhigh);
-                  GetObjects().Add(hist);
+                  AddIndexedObject(hist);
                   }
                   hist->Fill(Xvalue, Yvalue);
                   return hist;*/
@@ -212,17 +209,13 @@ TDirectory* TRuntimeObjects::FillProfileHist(const char* dirname, const char* na
                                              double Xhigh, double Xvalue, double Yvalue)
 {
 
-   TDirectory* dir = static_cast<TDirectory*>(GetObjects().FindObject(dirname));
-   if(dir == nullptr) {
-      dir = new TDirectory(dirname, dirname);
-      GetObjects().Add(dir);
-   }
+   TDirectory* dir = FindIndexedDirectory(dirname);
    dir->cd();
-   TProfile* prof = static_cast<TProfile*>(dir->FindObject(name));
+   TProfile* prof = static_cast<TProfile*>(FindIndexedObject(dir, dirname, name));
    if(prof == nullptr) {
       prof = new TProfile(name, name, Xbins, Xlow, Xhigh);
       prof->SetDirectory(dir);
-      dir->Add(prof);
+      AddIndexedObject(dir, dirname, prof);
    }
 
    if(!(std::isnan(Xvalue))) {
@@ -238,17 +231,13 @@ TDirectory* TRuntimeObjects::FillHistogramSym(const char* dirname, const char* n
                                               double Xhigh, double Xvalue, int Ybins, double Ylow, double Yhigh,
                                               double Yvalue)
 {
-   TDirectory* dir = static_cast<TDirectory*>(GetObjects().FindObject(dirname));
-   if(dir == nullptr) {
-      dir = new TDirectory(dirname, dirname);
-      GetObjects().Add(dir);
-   }
+   TDirectory* dir = FindIndexedDirectory(dirname);
    dir->cd();
-   TH2* hist = static_cast<TH2*>(dir->FindObject(name));
+   TH2* hist = static_cast<TH2*>(FindIndexedObject(dir, dirname, name));
    if(hist == nullptr) {
       hist = new GH2D(name, name, Xbins, Xlow, Xhigh, Ybins, Ylow, Yhigh);
       hist->SetDirectory(dir);
-      dir->Add(hist);
+      AddIndexedObject(dir, dirname, hist);
    }
    if(!(std::isnan(Xvalue))) {
       if(!(std::isnan(Yvalue))) {
@@ -264,13 +253,249 @@ TDirectory* TRuntimeObjects::FillHistogramSym(const char* dirname, const char* n
                   hist = new GH2D(name.c_str(),name.c_str(),
                   Xbins, Xlow, Xhigh,
                   Ybins, Ylow, Yhigh);
-                  GetObjects().Add(hist);
+                  AddIndexedObject(hist);
                   }
                   hist->Fill(Xvalue, Yvalue);
                   return hist;*/
 }
 //-------------------------------------------------------------------------
 
+int TRuntimeObjects::GetHistogramHandle(const char* name, int bins, double low, double high)
+{
+   return RegisterHandle({"", name, EHistogramType::k1D, bins, low, high, 0, 0., 0.});
+}
+
+int TRuntimeObjects::GetHistogramHandle(const char* name, int Xbins, double Xlow, double Xhigh, int Ybins, double Ylow,
+                                        double Yhigh)
+{
+   return RegisterHandle({"", name, EHistogramType::k2D, Xbins, Xlow, Xhigh, Ybins, Ylow, Yhigh});
+}
+
+int TRuntimeObjects::GetProfileHistHandle(const char* name, int Xbins, double Xlow, double Xhigh)
+{
+   return RegisterHandle({"", name, EHistogramType::kProfile, Xbins, Xlow, Xhigh, 0, 0., 0.});
+}
+
+int TRuntimeObjects::GetHistogramSymHandle(const char* name, int Xbins, double Xlow, double Xhigh, int Ybins,
+                                           double Ylow, double Yhigh)
+{
+   return RegisterHandle({"", name, EHistogramType::kSym, Xbins, Xlow, Xhigh, Ybins, Ylow, Yhigh});
+}
+
+int TRuntimeObjects::GetHistogramHandle(const char* dirname, const char* name, int bins, double low, double high)
+{
+   return RegisterHandle({dirname, name, EHistogramType::k1D, bins, low, high, 0, 0., 0.});
+}
+
+int TRuntimeObjects::GetHistogramHandle(const char* dirname, const char* name, int Xbins, double Xlow, double Xhigh,
+                                        int Ybins, double Ylow, double Yhigh)
+{
+   return RegisterHandle({dirname, name, EHistogramType::k2D, Xbins, Xlow, Xhigh, Ybins, Ylow, Yhigh});
+}
+
+int TRuntimeObjects::GetProfileHistHandle(const char* dirname, const char* name, int Xbins, double Xlow, double Xhigh)
+{
+   return RegisterHandle({dirname, name, EHistogramType::kProfile, Xbins, Xlow, Xhigh, 0, 0., 0.});
+}
+
+int TRuntimeObjects::GetHistogramSymHandle(const char* dirname, const char* name, int Xbins, double Xlow, double Xhigh,
+                                           int Ybins, double Ylow, double Yhigh)
+{
+   return RegisterHandle({dirname, name, EHistogramType::kSym, Xbins, Xlow, Xhigh, Ybins, Ylow, Yhigh});
+}
+
+int TRuntimeObjects::RegisterHandle(const THistogramSpec& spec)
+{
+   /// Returns the handle of the histogram, registering it if this is the first request for it. Requesting the same
+   /// name (and dirname) again returns the same handle. The histogram is created right away in this instance.
+   int handle;
+   {
+      std::lock_guard<std::mutex> lock(fHandleMutex);
+      std::string                 key = spec.fDirname;
+      key.push_back('\0');
+      key.append(spec.fName);
+      auto it = fHandleIndex.find(key);
+      if(it != fHandleIndex.end()) {
+         handle = it->second;
+      } else {
+         handle = static_cast<int>(fHandleSpecs.size());
+         fHandleSpecs.push_back(spec);
+         fHandleIndex.emplace(std::move(key), handle);
+      }
+   }
+   ResolveHandle(handle);
+   return handle;
+}
+
+TH1* TRuntimeObjects::ResolveHandle(int handle)
+{
+   /// Returns the histogram of the handle in this instance, creating it if necessary.
+   if(handle < 0) {
+      return nullptr;
+   }
+   if(static_cast<size_t>(handle) < fHandleObjects.size() && fHandleObjects[handle].first != nullptr) {
+      return fHandleObjects[handle].first;
+   }
+
+   THistogramSpec spec;
+   {
+      std::lock_guard<std::mutex> lock(fHandleMutex);
+      if(static_cast<size_t>(handle) >= fHandleSpecs.size()) {
+         return nullptr;
+      }
+      spec = fHandleSpecs[handle];
+   }
+
+   // NaN values are never filled, so the Fill functions only find or create the histogram
+   const double nan  = std::numeric_limits<double>::quiet_NaN();
+   TH1*         hist = nullptr;
+   if(spec.fDirname.empty()) {
+      switch(spec.fType) {
+		case EHistogramType::k1D:
+         hist = FillHistogram(spec.fName.c_str(), spec.fXbins, spec.fXlow, spec.fXhigh, nan);
+         break;
+		case EHistogramType::k2D:
+         hist = FillHistogram(spec.fName.c_str(), spec.fXbins, spec.fXlow, spec.fXhigh, nan, spec.fYbins, spec.fYlow,
+                              spec.fYhigh, nan);
+         break;
+		case EHistogramType::kSym:
+         hist = FillHistogramSym(spec.fName.c_str(), spec.fXbins, spec.fXlow, spec.fXhigh, nan, spec.fYbins,
+                                 spec.fYlow, spec.fYhigh, nan);
+         break;
+		case EHistogramType::kProfile:
+         hist = FillProfileHist(spec.fName.c_str(), spec.fXbins, spec.fXlow, spec.fXhigh, nan, nan);
+         break;
+      }
+   } else {
+      const char* dirname = spec.fDirname.c_str();
+      const char* name    = spec.fName.c_str();
+      TDirectory* dir     = nullptr;
+      switch(spec.fType) {
+		case EHistogramType::k1D:
+         dir = FillHistogram(dirname, name, spec.fXbins, spec.fXlow, spec.fXhigh, nan);
+         break;
+		case EHistogramType::k2D:
+         dir = FillHistogram(dirname, name, spec.fXbins, spec.fXlow, spec.fXhigh, nan, spec.fYbins, spec.fYlow,
+                             spec.fYhigh, nan);
+         break;
+		case EHistogramType::kSym:
+         dir = FillHistogramSym(dirname, name, spec.fXbins, spec.fXlow, spec.fXhigh, nan, spec.fYbins, spec.fYlow,
+                                spec.fYhigh, nan);
+         break;
+		case EHistogramType::kProfile:
+         dir = FillProfileHist(dirname, name, spec.fXbins, spec.fXlow, spec.fXhigh, nan, nan);
+         break;
+      }
+      hist = static_cast<TH1*>(FindIndexedObject(dir, dirname, name));
+   }
+
+   if(static_cast<size_t>(handle) >= fHandleObjects.size()) {
+      fHandleObjects.resize(handle + 1, std::make_pair(nullptr, EHistogramType::k1D));
+   }
+   fHandleObjects[handle] = std::make_pair(hist, spec.fType);
+   return hist;
+}
+
+TH1* TRuntimeObjects::GetHistogram(int handle)
+{
+   return ResolveHandle(handle);
+}
+
+void TRuntimeObjects::Fill1D(int handle, double value, double weight)
+{
+   TH1* hist = ResolveHandle(handle);
+   if(hist == nullptr || fHandleObjects[handle].second != EHistogramType::k1D) {
+      return;
+   }
+   if(!std::isnan(value)) {
+      hist->Fill(value, weight);
+   }
+}
+
+void TRuntimeObjects::Fill2D(int handle, double Xvalue, double Yvalue, double weight)
+{
+   /// Fills the histogram of the handle, for a symmetric histogram both (X, Y) and (Y, X) are filled.
+   TH1* hist = ResolveHandle(handle);
+   if(hist == nullptr || std::isnan(Xvalue) || std::isnan(Yvalue)) {
+      return;
+   }
+   switch(fHandleObjects[handle].second) {
+	case EHistogramType::k1D: break;
+	case EHistogramType::k2D: static_cast<TH2*>(hist)->Fill(Xvalue, Yvalue, weight); break;
+	case EHistogramType::kSym:
+      static_cast<TH2*>(hist)->Fill(Xvalue, Yvalue, weight);
+      static_cast<TH2*>(hist)->Fill(Yvalue, Xvalue, weight);
+      break;
+	case EHistogramType::kProfile: static_cast<TProfile*>(hist)->Fill(Xvalue, Yvalue, weight); break;
+   }
+}
+
+TObject* TRuntimeObjects::FindIndexedObject(const char* name)
+{
+   /// Finds the object in GetObjects() via the index. Objects that were added to the list by hand are not indexed
+   /// yet, so if the name is not in the index we search the list and add what we find.
+   fKey.assign(name);
+   auto it = fObjectIndex.find(fKey);
+   if(it != fObjectIndex.end()) {
+      return it->second;
+   }
+   TObject* obj = GetObjects().FindObject(name);
+   if(obj != nullptr) {
+      fObjectIndex.emplace(fKey, obj);
+   }
+   return obj;
+}
+
+TDirectory* TRuntimeObjects::FindIndexedDirectory(const char* dirname)
+{
+   TDirectory* dir = static_cast<TDirectory*>(FindIndexedObject(dirname));
+   if(dir == nullptr) {
+      dir = new TDirectory(dirname, dirname);
+      AddIndexedObject(dir);
+   }
+   return dir;
+}
+
+TObject* TRuntimeObjects::FindIndexedObject(TDirectory* dir, const char* dirname, const char* name)
+{
+   // dirname and name are joined by '\0', so the key can't be mistaken for a name in GetObjects()
+   fKey.assign(dirname);
+   fKey.push_back('\0');
+   fKey.append(name);
+   auto it = fObjectIndex.find(fKey);
+   if(it != fObjectIndex.end()) {
+      return it->second;
+   }
+   TObject* obj = dir->FindObject(name);
+   if(obj != nullptr) {
+      fObjectIndex.emplace(fKey, obj);
+   }
+   return obj;
+}
+
+void TRuntimeObjects::AddIndexedObject(TObject* obj)
+{
+   GetObjects().Add(obj);
+   fObjectIndex[obj->GetName()] = obj;
+}
+
+void TRuntimeObjects::AddIndexedObject(TDirectory* dir, const char* dirname, TObject* obj)
+{
+   dir->Add(obj);
+   fKey.assign(dirname);
+   fKey.push_back('\0');
+   fKey.append(obj->GetName());
+   fObjectIndex[fKey] = obj;
+}
+
+void TRuntimeObjects::ClearIndex()
+{
+   /// Forgets all indexed objects and the histograms of all handles in this instance, they are searched for in
+   /// GetObjects() again on their next use.
+   fObjectIndex.clear();
+   fHandleObjects.clear();
+}
+
 TList& TRuntimeObjects::GetObjects()
 {
    return *fObjects;
@@ -16,7 +16,8 @@
 
 TDataLoop::TDataLoop(std::string name, TRawFile* source)
    : StoppableThread(name), fSource(source), fSelfStopping(true),
-     fOutputQueue(std::make_shared<ThreadsafeQueue<std::shared_ptr<TRawEvent>>>("midas_queue"))
+     fOutputQueue(std::make_shared<ThreadsafeQueue<std::shared_ptr<TRawEvent>>>(
+        "midas_queue", 50000, TGRSIOptions::Get()->LockFreeQueues() ? EQueueType::kSPSC : EQueueType::kMutex))
 #ifdef HAS_XML
      , fOdb(nullptr)
 #endif
@@ -3,7 +3,10 @@
 #include <chrono>
 #include <thread>
 
+#include "TROOT.h"
+
 #include "TUnpackedEvent.h"
+#include "TWaveformFitter.h"
 
 ClassImp(TDetBuildingLoop)
 
@@ -21,48 +24,162 @@ TDetBuildingLoop* TDetBuildingLoop::Get(std::string name)
 
 TDetBuildingLoop::TDetBuildingLoop(std::string name)
    : StoppableThread(name),
-     fInputQueue(std::make_shared<ThreadsafeQueue<std::vector<std::shared_ptr<const TFragment>>>>())
+     fInputQueue(std::make_shared<ThreadsafeQueue<std::vector<std::shared_ptr<const TFragment>>>>()),
+     fStartWorkers(true)
 {
 }
 
-TDetBuildingLoop::~TDetBuildingLoop() = default;
+TDetBuildingLoop::~TDetBuildingLoop()
+{
+   // the loop might have been stopped before the input was finished, the building threads still need to be joined
+   fWorkerPool.Abort();
+}
 
 bool TDetBuildingLoop::Iteration()
 {
+   if(fStartWorkers) {
+      StartWorkers();
+      fStartWorkers = false;
+   }
+   if(fWorkerPool.Running()) {
+      // pass on what the building threads have finished, waiting for them if too many events are in flight
+      CollectJobs(fWorkerPool.Full());
+      if(fWorkerPool.Full()) {
+         return true;
+      }
+   }
+
    std::vector<std::shared_ptr<const TFragment>> frags;
 
-   fInputSize = fInputQueue->Pop(frags);
+   fInputSize = fInputQueue->Pop(frags, fWorkerPool.Running() ? 0 : 1000);
    if(fInputSize < 0) {
       fInputSize = 0;
    }
 
    if(frags.empty()) {
       if(fInputQueue->IsFinished()) {
+         if(fWorkerPool.Running()) {
+            StopWorkers();
+         }
+         if(fFitter) {
+            FitEvents();
+            fFitter.reset();
+         }
          for(const auto& outQueue : fOutputQueues) {
             outQueue->SetFinished();
          }
          return false;
       }
-      std::this_thread::sleep_for(std::chrono::milliseconds(1000));
+      // don't keep events waiting for their fits while there is no input
+      FitEvents();
+      if(!fWorkerPool.Running()) {
+         std::this_thread::sleep_for(std::chrono::milliseconds(1000));
+      } else {
+         CollectJobs(true);
+      }
       return true;
    }
    ++fItemsPopped;
 
+   if(fWorkerPool.Running()) {
+      auto job        = std::make_shared<TDetBuildingJob>();
+      job->fFragments = std::move(frags);
+      fWorkerPool.Dispatch(std::move(job));
+      return true;
+   }
+
    std::shared_ptr<TUnpackedEvent> outputEvent = std::make_shared<TUnpackedEvent>();
    for(const auto& frag : frags) {
       // passes ownership of all TFragments, no need to delete here
       outputEvent->AddRawData(frag);
    }
    outputEvent->Build();
+   PushEvent(outputEvent);
+
+   return true;
+}
+
+void TDetBuildingLoop::PushEvent(const std::shared_ptr<TUnpackedEvent>& event)
+{
+   if(fFitter) {
+      fFitEvents.push_back(event);
+      if(fFitEvents.size() >= fFitBlockSize) {
+         FitEvents();
+      }
+      return;
+   }
    for(const auto& outQueue : fOutputQueues) {
-      outQueue->Push(outputEvent);
+      outQueue->Push(event);
    }
+}
 
-   return true;
+void TDetBuildingLoop::FitEvents()
+{
+   /// Fits the waveforms of all events waiting for it and passes them on.
+   if(fFitEvents.empty()) {
+      return;
+   }
+   for(const auto& event : fFitEvents) {
+      event->AddWaveformFits(*fFitter);
+   }
+   fFitter->Fit();
+   for(const auto& event : fFitEvents) {
+      for(const auto& outQueue : fOutputQueues) {
+         outQueue->Push(event);
+      }
+   }
+   fFitEvents.clear();
+}
+
+void TDetBuildingLoop::StartWorkers()
+{
+   /// Starts the waveform fitting threads if requested, and the building threads if more than one was requested.
+   if(TGRSIOptions::Get()->WaveformFittingThreads() > 0) {
+      fFitter.reset(new TWaveformFitter(TGRSIOptions::Get()->WaveformFittingThreads() - 1));
+   }
+
+   int nofThreads = TGRSIOptions::Get()->DetBuildingThreads();
+   if(nofThreads < 2) {
+      return;
+   }
+   // detectors are created via their TClass in the building threads
+   ROOT::EnableThreadSafety();
+
+   fWorkerPool.Start("det_build", nofThreads, 256 * nofThreads, [this](size_t) { BuildingThread(); });
+}
+
+void TDetBuildingLoop::StopWorkers()
+{
+   /// Passes on all remaining events and stops the building threads.
+   fWorkerPool.Stop([this](TDetBuildingJob& job) { PushEvent(job.fEvent); });
+}
+
+void TDetBuildingLoop::CollectJobs(bool wait)
+{
+   /// Passes on all events built by the building threads that are next in line. If wait is true, we wait up to 10 ms
+   /// for an event to be finished.
+   fWorkerPool.Collect(wait, [this](TDetBuildingJob& job) { PushEvent(job.fEvent); });
+}
+
+void TDetBuildingLoop::BuildingThread()
+{
+   /// Builds events from the worker pool until the pool is stopped.
+   std::shared_ptr<TDetBuildingJob> job;
+   while(fWorkerPool.NextJob(job)) {
+      job->fEvent = std::make_shared<TUnpackedEvent>();
+      for(const auto& frag : job->fFragments) {
+         job->fEvent->AddRawData(frag);
+      }
+      job->fFragments.clear();
+      job->fEvent->Build();
+      fWorkerPool.JobDone(std::move(job));
+   }
 }
 
 void TDetBuildingLoop::ClearQueue()
 {
+   fFitEvents.clear();
+
    std::vector<std::shared_ptr<const TFragment>> rawEvent;
    while(fInputQueue->Size() != 0u) {
       fInputQueue->Pop(rawEvent);
@@ -3,6 +3,7 @@
 #include "TGRSIOptions.h"
 #include "TSortingDiagnostics.h"
 
+#include <algorithm>
 #include <chrono>
 #include <thread>
 
@@ -23,20 +24,25 @@ TEventBuildingLoop* TEventBuildingLoop::Get(std::string name, EBuildMode mode)
 
 TEventBuildingLoop::TEventBuildingLoop(std::string name, EBuildMode mode)
    : StoppableThread(name), fInputQueue(std::make_shared<ThreadsafeQueue<std::shared_ptr<const TFragment>>>()),
-     fOutputQueue(std::make_shared<ThreadsafeQueue<std::vector<std::shared_ptr<const TFragment>>>>()),
-     fOutOfOrderQueue(std::make_shared<ThreadsafeQueue<std::shared_ptr<const TFragment>>>()), fBuildMode(mode),
-     fSortingDepth(10000), fBuildWindow(200), fPreviousSortingDepthError(false)
+     fOutputQueue(std::make_shared<ThreadsafeQueue<std::vector<std::shared_ptr<const TFragment>>>>(
+        "event_build_queue", 50000, TGRSIOptions::Get()->LockFreeQueues() ? EQueueType::kSPSC : EQueueType::kMutex)),
+     fOutOfOrderQueue(std::make_shared<ThreadsafeQueue<std::shared_ptr<const TFragment>>>(
+        "out_of_order_queue", 50000, TGRSIOptions::Get()->LockFreeQueues() ? EQueueType::kSPSC : EQueueType::kMutex)),
+     fBuildMode(mode),
+     fSortingDepth(10000), fBuildWindow(200), fPreviousSortingDepthError(false),
+     fBatchSize(std::max(TGRSIOptions::Get()->FragmentBatchSize(), static_cast<size_t>(1))),
+     fMultisetSorting(TGRSIOptions::Get()->MultisetSorting()), fInputBatchPosition(0)
 {
 
    switch(fBuildMode) {
 	case EBuildMode::kTimestamp:
-      fOrdered = decltype(fOrdered)([](std::shared_ptr<const TFragment> a, std::shared_ptr<const TFragment> b) {
+      fOrdered = decltype(fOrdered)([](const std::shared_ptr<const TFragment>& a, const std::shared_ptr<const TFragment>& b) {
          return a->GetTimeStamp() < b->GetTimeStamp();
       });
       break;
 
 	case EBuildMode::kTriggerId:
-      fOrdered = decltype(fOrdered)([](std::shared_ptr<const TFragment> a, std::shared_ptr<const TFragment> b) {
+      fOrdered = decltype(fOrdered)([](const std::shared_ptr<const TFragment>& a, const std::shared_ptr<const TFragment>& b) {
          return a->GetTriggerId() < b->GetTriggerId();
       });
       break;
@@ -47,6 +53,9 @@ TEventBuildingLoop::~TEventBuildingLoop() = default;
 
 void TEventBuildingLoop::ClearQueue()
 {
+   fInputBatch.clear();
+   fInputBatchPosition = 0;
+
    std::shared_ptr<const TFragment> single_event;
    while(fInputQueue->Size() != 0u) {
       fInputQueue->Pop(single_event);
@@ -60,21 +69,34 @@ void TEventBuildingLoop::ClearQueue()
 
 bool TEventBuildingLoop::Iteration()
 {
-   // Pull something off of the input queue.
+   // Pull something off of the input queue, if we've used up the last batch of fragments.
+   if(fInputBatchPosition >= fInputBatch.size()) {
+      fInputBatch.clear();
+      fInputBatchPosition = 0;
+      fInputSize          = fInputQueue->PopBatch(fInputBatch, fBatchSize, 0);
+      if(fInputSize < 0) {
+         fInputSize = 0;
+      }
+   }
    std::shared_ptr<const TFragment> input_frag = nullptr;
-   fInputSize                                  = fInputQueue->Pop(input_frag, 0);
-   if(fInputSize < 0) {
-      fInputSize = 0;
+   if(fInputBatchPosition < fInputBatch.size()) {
+      input_frag = std::move(fInputBatch[fInputBatchPosition++]);
    }
 
    if(input_frag) {
       ++fItemsPopped;
-      fOrdered.insert(input_frag);
-      if(fOrdered.size() < fSortingDepth) {
+      if(fAdaptiveDepth && fAdaptiveDepth->Add(SortingKey(input_frag))) {
+         fSortingDepth = fAdaptiveDepth->Depth();
+      }
+      InsertSorted(std::move(input_frag));
+      if(SortedSize() < fSortingDepth) {
          // Got a new event, but we want to have more to sort
          return true;
       }
-      // Got a new event, and we have enough to sort.
+      // Got a new event, and we have enough to sort (more than enough if the adaptive sort depth was lowered).
+      while(SortedSize() > fSortingDepth) {
+         BuildNextFragment();
+      }
 
    } else {
       if(!fInputQueue->IsFinished()) {
@@ -82,11 +104,16 @@ bool TEventBuildingLoop::Iteration()
          std::this_thread::sleep_for(std::chrono::milliseconds(1000));
          return true;
       }
-      if(fOrdered.empty()) {
+      if(SortedSize() == 0) {
          // Parent is dead, and we have passed on all events
          if(!fNextEvent.empty()) {
             fOutputQueue->Push(fNextEvent);
          }
+         if(fAdaptiveDepth) {
+            TSortingDiagnostics::Get()->SetSortDepth(fAdaptiveDepth->LargestDepth(), true);
+         } else {
+            TSortingDiagnostics::Get()->SetSortDepth(fSortingDepth, false);
+         }
          fOutputQueue->SetFinished();
          return false;
       }
@@ -95,13 +122,76 @@ bool TEventBuildingLoop::Iteration()
    }
 
    // We have data, and we want to add it to the next fragment;
-   std::shared_ptr<const TFragment> next_fragment = *fOrdered.begin();
-   fOrdered.erase(fOrdered.begin());
+   BuildNextFragment();
+
+   return true;
+}
+
+void TEventBuildingLoop::SetSortDepth(int num_events)
+{
+   /// Sets the sort depth, with --adaptive-sort-depth this is the depth we start with.
+   fSortingDepth = num_events;
+   if(TGRSIOptions::Get()->AdaptiveSortDepth()) {
+      fAdaptiveDepth.reset(new TAdaptiveSortDepth(num_events, TGRSIOptions::Get()->MaxSortDepth(),
+                                                  TGRSIOptions::Get()->OutOfOrderRate()));
+      fSortingDepth = fAdaptiveDepth->Depth();
+   }
+}
+
+void TEventBuildingLoop::BuildNextFragment()
+{
+   /// adds the fragment with the lowest timestamp (trigger id) to the next event (or starts a new one)
+   std::shared_ptr<const TFragment> next_fragment = PopSorted();
    if(CheckBuildCondition(next_fragment)) {
       fNextEvent.push_back(next_fragment);
    }
+}
 
-   return true;
+std::string TEventBuildingLoop::SortDepthAdvice() const
+{
+   if(fAdaptiveDepth) {
+      std::stringstream ss;
+      ss<<"The adaptive sort depth will be increased (up to --max-sort-depth="<<fAdaptiveDepth->MaxDepth()<<")";
+      return ss.str();
+   }
+   return "Please increase sort depth with --sort-depth=N";
+}
+
+long TEventBuildingLoop::SortingKey(const std::shared_ptr<const TFragment>& frag) const
+{
+   if(fBuildMode == EBuildMode::kTriggerId) {
+      return frag->GetTriggerId();
+   }
+   return frag->GetTimeStamp();
+}
+
+size_t TEventBuildingLoop::SortedSize() const
+{
+   if(fMultisetSorting) {
+      return fOrdered.size();
+   }
+   return fSorter.Size();
+}
+
+void TEventBuildingLoop::InsertSorted(std::shared_ptr<const TFragment> frag)
+{
+   if(fMultisetSorting) {
+      fOrdered.insert(std::move(frag));
+      return;
+   }
+   long key = SortingKey(frag);
+   fSorter.Insert(key, std::move(frag));
+}
+
+std::shared_ptr<const TFragment> TEventBuildingLoop::PopSorted()
+{
+   /// returns the fragment with the lowest timestamp (trigger id), must not be called if no fragments are left
+   if(fMultisetSorting) {
+      std::shared_ptr<const TFragment> frag = *fOrdered.begin();
+      fOrdered.erase(fOrdered.begin());
+      return frag;
+   }
+   return fSorter.Pop();
 }
 
 bool TEventBuildingLoop::CheckBuildCondition(const std::shared_ptr<const TFragment>& frag)
@@ -137,7 +227,7 @@ bool TEventBuildingLoop::CheckTimestampCondition(const std::shared_ptr<const TFr
                   <<"Sorting depth of "<<fSortingDepth<<" was insufficient. timestamp: "<<timestamp
                   <<" Last: "<<event_start<<" \n"
                   <<"Not all events were built correctly"<<std::endl;
-         std::cerr<<"Please increase sort depth with --sort-depth=N"<<std::endl;
+         std::cerr<<SortDepthAdvice()<<std::endl;
          fPreviousSortingDepthError = true;
       }
       if(TGRSIOptions::Get()->SeparateOutOfOrder()) {
@@ -173,7 +263,7 @@ bool TEventBuildingLoop::CheckTriggerIdCondition(const std::shared_ptr<const TFr
                   <<"Not all events were built correctly"<<std::endl;
          std::cerr<<"Trigger id #"<<trigger_id<<" was incorrectly sorted before "
                   <<"trigger id #"<<current_trigger_id<<std::endl;
-         std::cerr<<"Please increase sort depth with --sort-depth=N"<<std::endl;
+         std::cerr<<SortDepthAdvice()<<std::endl;
          fPreviousSortingDepthError = true;
       }
       if(TGRSIOptions::Get()->SeparateOutOfOrder()) {
@@ -1,5 +1,6 @@
 #include "TFragWriteLoop.h"
 
+#include <algorithm>
 #include <sstream>
 #include <iomanip>
 #include <chrono>
@@ -16,6 +17,7 @@
 #include "TTreeFillMutex.h"
 #include "TAnalysisOptions.h"
 #include "TParsingDiagnostics.h"
+#include "TScalerQueue.h"
 
 #include "TBadFragment.h"
 
@@ -37,9 +39,11 @@ TFragWriteLoop* TFragWriteLoop::Get(std::string name, std::string fOutputFilenam
 
 TFragWriteLoop::TFragWriteLoop(std::string name, std::string fOutputFilename)
    : StoppableThread(name), fOutputFile(nullptr), fEventTree(nullptr), fBadEventTree(nullptr), fScalerTree(nullptr),
+     fDeadtimeScalerTree(nullptr),
      fInputQueue(std::make_shared<ThreadsafeQueue<std::shared_ptr<const TFragment>>>()),
      fBadInputQueue(std::make_shared<ThreadsafeQueue<std::shared_ptr<const TBadFragment>>>()),
-     fScalerInputQueue(std::make_shared<ThreadsafeQueue<std::shared_ptr<TEpicsFrag>>>())
+     fScalerInputQueue(std::make_shared<ThreadsafeQueue<std::shared_ptr<TEpicsFrag>>>()),
+     fBatchSize(std::max(TGRSIOptions::Get()->FragmentBatchSize(), static_cast<size_t>(1)))
 {
    if(fOutputFilename != "/dev/null") {
       TThread::Lock();
@@ -61,6 +65,10 @@ TFragWriteLoop::TFragWriteLoop(std::string name, std::string fOutputFilename)
       fScalerAddress = nullptr;
       fScalerTree->Branch("TEpicsFrag", &fScalerAddress);
 
+      fDeadtimeScalerTree    = new TTree("ScalerTree", "ScalerTree");
+      fDeadtimeScalerAddress = nullptr;
+      fDeadtimeScalerTree->Branch("TScalerData", &fDeadtimeScalerAddress);
+
       TThread::UnLock();
    }
 }
@@ -92,8 +100,8 @@ std::string TFragWriteLoop::EndStatus()
 
 bool TFragWriteLoop::Iteration()
 {
-   std::shared_ptr<const TFragment> event;
-   fInputSize = fInputQueue->Pop(event, 0);
+   fInputBatch.clear();
+   fInputSize = fInputQueue->PopBatch(fInputBatch, fBatchSize, 0);
    if(fInputSize < 0) {
       fInputSize = 0;
    }
@@ -104,13 +112,15 @@ bool TFragWriteLoop::Iteration()
    std::shared_ptr<TEpicsFrag> scaler;
    fScalerInputQueue->Pop(scaler, 0);
 
-   bool hasAnything    = event || badEvent || scaler;
+   bool hasAnything    = !fInputBatch.empty() || badEvent || scaler;
+   hasAnything         = WriteDeadtimeScalers() || hasAnything;
    bool allParentsDead = (fInputQueue->IsFinished() && fBadInputQueue->IsFinished() && fScalerInputQueue->IsFinished());
 
-   if(event != nullptr) {
+   for(const auto& event : fInputBatch) {
       WriteEvent(event);
       ++fItemsPopped;
    }
+   fInputBatch.clear();
 
    if(badEvent != nullptr) {
       WriteBadEvent(badEvent);
@@ -137,6 +147,12 @@ void TFragWriteLoop::Write()
       fEventTree->Write(fEventTree->GetName(), TObject::kOverwrite);
       fBadEventTree->Write(fBadEventTree->GetName(), TObject::kOverwrite);
       fScalerTree->Write(fScalerTree->GetName(), TObject::kOverwrite);
+      WriteDeadtimeScalers();
+      fDeadtimeScalerTree->Write(fDeadtimeScalerTree->GetName(), TObject::kOverwrite);
+      if(fDeadtimeScalerTree->GetEntries() > 0) {
+         // write the sorted scaler index next to the tree so TScaler doesn't have to rebuild it every time
+         TScaler(fDeadtimeScalerTree).WriteIndex(fOutputFile);
+      }
       if(GValue::Size() != 0) {
          GValue::Get()->Write();
       }
@@ -191,3 +207,21 @@ void TFragWriteLoop::WriteScaler(const std::shared_ptr<TEpicsFrag>& scaler)
       fScalerAddress = nullptr;
    }
 }
+
+bool TFragWriteLoop::WriteDeadtimeScalers()
+{
+   /// Moves all deadtime scalers from the deadtime scaler queue into the scaler tree, returns true if there were any.
+   bool         wroteAny = false;
+   TScalerData* scaler   = nullptr;
+   while((scaler = TDeadtimeScalerQueue::Get()->PopScaler()) != nullptr) {
+      if(fDeadtimeScalerTree != nullptr) {
+         fDeadtimeScalerAddress = scaler;
+         std::lock_guard<std::mutex> lock(ttree_fill_mutex);
+         fDeadtimeScalerTree->Fill();
+         fDeadtimeScalerAddress = nullptr;
+      }
+      delete scaler;
+      wroteAny = true;
+   }
+   return wroteAny;
+}
@@ -1,16 +1,27 @@
 #include "TFragmentChainLoop.h"
 
+#include <algorithm>
 #include <chrono>
 #include <thread>
 
+#include "TChainElement.h"
 #include "TClass.h"
 #include "TFile.h"
+#include "TROOT.h"
 #include "TThread.h"
 
 #include "TDetector.h"
 #include "GRootCommands.h"
 #include "TFragment.h"
 
+namespace {
+/// size of the tree cache of the input chain and of each reading thread, so that whole clusters of baskets are read
+/// (and decompressed) at once
+const Long64_t kCacheSize = 64 * 1024 * 1024;
+/// minimum number of entries read by a reading thread at once
+const long kMinChunkSize = 8192;
+} // namespace
+
 TFragmentChainLoop* TFragmentChainLoop::Get(std::string name, TChain* chain)
 {
    if(name.length() == 0) {
@@ -32,12 +43,17 @@ TFragmentChainLoop* TFragmentChainLoop::Get(std::string name, TChain* chain)
 
 TFragmentChainLoop::TFragmentChainLoop(std::string name, TChain* chain)
    : StoppableThread(name), fEntriesTotal(chain->GetEntries()), fInputChain(chain), fFragment(nullptr),
-     fSelfStopping(true)
+     fBatchSize(std::max(TGRSIOptions::Get()->FragmentBatchSize(), static_cast<size_t>(1))), fStartWorkers(true),
+     fChunkSize(std::max(static_cast<long>(fBatchSize), kMinChunkSize)), fSelfStopping(true)
 {
    SetupChain();
 }
 
-TFragmentChainLoop::~TFragmentChainLoop() = default;
+TFragmentChainLoop::~TFragmentChainLoop()
+{
+   // the loop might have been stopped before all entries were read, the reading threads still need to be joined
+   fWorkerPool.Abort();
+}
 
 void TFragmentChainLoop::ClearQueue()
 {
@@ -56,16 +72,24 @@ int TFragmentChainLoop::SetupChain()
    }
 
    fInputChain->SetBranchAddress("TFragment", &fFragment);
+   fInputChain->SetCacheSize(kCacheSize);
    return 0;
 }
 
 void TFragmentChainLoop::Restart()
 {
+   if(fWorkerPool.Running()) {
+      // drop everything that was read ahead, the reading threads are started again by the next iteration
+      fWorkerPool.Abort();
+      fStartWorkers = true;
+   }
+   fOutputBuffer.clear();
    fItemsPopped = 0;
 }
 
 void TFragmentChainLoop::OnEnd()
 {
+   FlushOutput();
    for(const auto& outQueue : fOutputQueues) {
       outQueue->SetFinished();
    }
@@ -73,7 +97,16 @@ void TFragmentChainLoop::OnEnd()
 
 bool TFragmentChainLoop::Iteration()
 {
+   if(fStartWorkers) {
+      StartWorkers();
+      fStartWorkers = false;
+   }
+   if(fWorkerPool.Running()) {
+      return ThreadedIteration();
+   }
+
    if(static_cast<long>(fItemsPopped) >= fEntriesTotal) {
+      FlushOutput();
       if(fSelfStopping) {
          return false;
       }
@@ -81,14 +114,146 @@ bool TFragmentChainLoop::Iteration()
       return true;
    }
 
-   std::shared_ptr<TFragment> frag = std::make_shared<TFragment>();
-   fInputChain->GetEntry(fItemsPopped++);
-   *frag = *fFragment;
-   frag->SetEntryNumber();
-   for(const auto& outQueue : fOutputQueues) {
-      outQueue->Push(frag);
+   // read a whole batch before checking back with the loop
+   long last = std::min(static_cast<long>(fItemsPopped + fBatchSize), fEntriesTotal);
+   while(static_cast<long>(fItemsPopped) < last) {
+      std::shared_ptr<TFragment> frag = std::make_shared<TFragment>();
+      fInputChain->GetEntry(fItemsPopped++);
+      *frag = *fFragment;
+      PushFragment(frag);
    }
    fInputSize = fEntriesTotal - fItemsPopped; // this way fInputSize+fItemsPopped gives the total number of entries
 
    return true;
 }
+
+bool TFragmentChainLoop::ThreadedIteration()
+{
+   /// Hands out chunks of entries to the reading threads and passes on the chunks they have read, in order.
+   auto nofChunks = static_cast<size_t>((fEntriesTotal + fChunkSize - 1) / fChunkSize);
+   while(fWorkerPool.JobsDispatched() < nofChunks && !fWorkerPool.Full()) {
+      fWorkerPool.Dispatch(std::make_shared<TFragmentChainJob>());
+   }
+
+   if(fWorkerPool.JobsCollected() >= nofChunks) {
+      FlushOutput();
+      if(fSelfStopping) {
+         StopWorkers();
+         return false;
+      }
+      std::this_thread::sleep_for(std::chrono::milliseconds(1000));
+      return true;
+   }
+
+   CollectJobs(true);
+   fInputSize = fEntriesTotal - fItemsPopped;
+
+   return true;
+}
+
+void TFragmentChainLoop::StartWorkers()
+{
+   /// Starts the reading threads if more than one was requested.
+   int nofThreads = TGRSIOptions::Get()->ReadingThreads();
+   if(nofThreads < 2 || fInputChain == nullptr) {
+      return;
+   }
+   // each reading thread opens its own files
+   ROOT::EnableThreadSafety();
+
+   fFileNames.clear();
+   TIter next(fInputChain->GetListOfFiles());
+   while(auto* element = static_cast<TChainElement*>(next())) {
+      fFileNames.emplace_back(element->GetTitle());
+   }
+
+   fWorkerPool.Start("chain", nofThreads, 4 * nofThreads, [this](size_t) { ReadingThread(); });
+}
+
+void TFragmentChainLoop::StopWorkers()
+{
+   /// Stops the reading threads, all chunks have to have been passed on already.
+   fWorkerPool.Stop([this](TFragmentChainJob& job) { PassOn(job); });
+}
+
+void TFragmentChainLoop::CollectJobs(bool wait)
+{
+   /// Passes on all chunks read by the reading threads that are next in line. If wait is true, we wait up to 10 ms for
+   /// a chunk to be finished.
+   fWorkerPool.Collect(wait, [this](TFragmentChainJob& job) { PassOn(job); });
+}
+
+void TFragmentChainLoop::PassOn(TFragmentChainJob& job)
+{
+   for(const auto& frag : job.fFragments) {
+      PushFragment(frag);
+   }
+   fItemsPopped += job.fFragments.size();
+}
+
+void TFragmentChainLoop::ReadingThread()
+{
+   /// Reads the chunks from the worker pool until the pool is stopped. Each reading thread has its own chain, so
+   /// the files are read and the baskets decompressed independently of the other threads.
+   TChain chain(fInputChain->GetName());
+   for(const auto& fileName : fFileNames) {
+      chain.Add(fileName.c_str());
+   }
+   TFragment* fragment = nullptr;
+   chain.SetBranchAddress("TFragment", &fragment);
+   chain.SetCacheSize(kCacheSize);
+
+   std::shared_ptr<TFragmentChainJob> job;
+   while(fWorkerPool.NextJob(job)) {
+      long first = static_cast<long>(job->fNumber) * fChunkSize;
+      long last  = std::min(first + fChunkSize, fEntriesTotal);
+      job->fFragments.reserve(last - first);
+      for(long entry = first; entry < last; ++entry) {
+         chain.GetEntry(entry);
+         std::shared_ptr<TFragment> frag = std::make_shared<TFragment>();
+         *frag                           = *fragment;
+         job->fFragments.push_back(std::move(frag));
+      }
+      fWorkerPool.JobDone(std::move(job));
+   }
+
+   chain.ResetBranchAddresses();
+   delete fragment;
+}
+
+void TFragmentChainLoop::PushFragment(const std::shared_ptr<TFragment>& frag)
+{
+   /// Numbers the fragment and pushes it to all output queues, or - if batching is enabled - adds it to the batch
+   /// that is pushed once it is full.
+   frag->SetEntryNumber();
+   if(fBatchSize == 1) {
+      for(const auto& outQueue : fOutputQueues) {
+         outQueue->Push(frag);
+      }
+      return;
+   }
+   fOutputBuffer.push_back(frag);
+   if(fOutputBuffer.size() >= fBatchSize) {
+      FlushOutput();
+   }
+}
+
+void TFragmentChainLoop::FlushOutput()
+{
+   /// Pushes the current batch of fragments to all output queues.
+   if(fOutputBuffer.empty()) {
+      return;
+   }
+   if(fOutputQueues.empty()) {
+      fOutputBuffer.clear();
+      return;
+   }
+   // all but the last queue get a copy, the last one gets the buffer itself
+   for(size_t i = 0; i + 1 < fOutputQueues.size(); ++i) {
+      std::vector<std::shared_ptr<const TFragment>> copy(fOutputBuffer);
+      fOutputQueues[i]->PushBatch(copy);
+   }
+   fOutputQueues.back()->PushBatch(fOutputBuffer);
+   fOutputBuffer.clear();
+   fOutputBuffer.reserve(fBatchSize);
+}
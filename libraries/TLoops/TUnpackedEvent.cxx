@@ -30,6 +30,13 @@ void TUnpackedEvent::Build()
    ClearRawData();
 }
 
+void TUnpackedEvent::AddWaveformFits(TWaveformFitter& fitter)
+{
+   for(const auto& det : fDetectors) {
+      det->AddWaveformFits(fitter);
+   }
+}
+
 void TUnpackedEvent::AddRawData(const std::shared_ptr<const TFragment>& frag)
 {
    fFragments.push_back(frag);
@@ -1,11 +1,13 @@
 #include "TUnpackingLoop.h"
 
 #include <chrono>
+#include <iostream>
 #include <thread>
 #include <sstream>
 #include <memory>
 
 #include "TGRSIOptions.h"
+#include "TGRSIRunInfo.h"
 #include "TLstEvent.h"
 #include "TMidasEvent.h"
 
@@ -24,11 +26,16 @@ TUnpackingLoop* TUnpackingLoop::Get(std::string name)
 
 TUnpackingLoop::TUnpackingLoop(std::string name)
    : StoppableThread(name), fInputQueue(std::make_shared<ThreadsafeQueue<std::shared_ptr<TRawEvent>>>()),
-     fFragsReadFromRaw(0), fGoodFragsRead(0), fEvaluateDataType(true), fDataType(EDataType::kMidas)
+     fFragsReadFromRaw(0), fGoodFragsRead(0), fEvaluateDataType(true), fDataType(EDataType::kMidas),
+     fNoWaveforms(false), fRecordDiag(true)
 {
 }
 
-TUnpackingLoop::~TUnpackingLoop() = default;
+TUnpackingLoop::~TUnpackingLoop()
+{
+   // the loop might have been stopped before the input was finished, the unpacking threads still need to be joined
+   fWorkerPool.Abort();
+}
 
 void TUnpackingLoop::ClearQueue()
 {
@@ -42,24 +49,44 @@ void TUnpackingLoop::ClearQueue()
 
 bool TUnpackingLoop::Iteration()
 {
+   if(fWorkerPool.Running()) {
+      // pass on what the unpacking threads have finished, waiting for them if too many events are in flight
+      CollectJobs(fWorkerPool.Full());
+      if(fWorkerPool.Full()) {
+         return true;
+      }
+   }
+
    std::shared_ptr<TRawEvent> event;
-   int                        error = fInputQueue->Pop(event);
+   int                        error = fInputQueue->Pop(event, fWorkerPool.Running() ? 0 : 1000);
    if(error < 0) {
       fInputSize = 0;
       if(fInputQueue->IsFinished()) {
          // Source is dead, push the last event and stop.
+         if(fWorkerPool.Running()) {
+            StopWorkers();
+         }
          fParser.SetFinished();
          BadOutputQueue()->SetFinished();
          ScalerOutputQueue()->SetFinished();
          return false;
       }
-      // Wait for the source to give more data.
-      std::this_thread::sleep_for(std::chrono::milliseconds(10));
+      // Pass on any batched fragments and wait for the source (or the unpacking threads) to give more data.
+      if(!fWorkerPool.Running()) {
+         fParser.FlushGoodOutput();
+         std::this_thread::sleep_for(std::chrono::milliseconds(10));
+      } else {
+         CollectJobs(true);
+         if(fWorkerPool.Idle()) {
+            fParser.FlushGoodOutput();
+         }
+      }
       return true;
    }
    if(fEvaluateDataType) {
       fDataType         = (event->IsA() == TLstEvent::Class()) ? EDataType::kLst : EDataType::kMidas;
       fEvaluateDataType = false;
+      StartWorkers();
    }
    if(fDataType == EDataType::kLst) {
       fParser.SetStatusVariables(&fItemsPopped, &fInputSize);
@@ -68,12 +95,104 @@ bool TUnpackingLoop::Iteration()
       ++fItemsPopped;
    }
 
+   if(fWorkerPool.Running()) {
+      Dispatch(event);
+      return true;
+   }
+
    fFragsReadFromRaw += event->Process(fParser);
    fGoodFragsRead += event->GoodFrags();
 
    return true;
 }
 
+void TUnpackingLoop::StartWorkers()
+{
+   /// Starts the unpacking threads if more than one was requested and the data can be unpacked in parallel.
+   int nofThreads = TGRSIOptions::Get()->UnpackingThreads();
+   if(nofThreads < 2) {
+      return;
+   }
+   // LST files are parsed as a single event, reconstructing time stamps and TIGRESS data rely on the previous event
+   if(fDataType != EDataType::kMidas || TGRSIOptions::Get()->ReconstructTimeStamp() || TGRSIRunInfo::Tigress()) {
+      std::cout<<"Can't unpack this data in parallel, using a single unpacking thread instead of "<<nofThreads
+               <<std::endl;
+      return;
+   }
+
+   for(int i = 0; i < nofThreads; ++i) {
+      fWorkerParsers.emplace_back(new TDataParser);
+      fWorkerDiagnostics.emplace_back(new TParsingDiagnostics);
+      fWorkerParsers.back()->SetNoWaveForms(fNoWaveforms);
+      fWorkerParsers.back()->SetRecordDiag(fRecordDiag);
+      fWorkerParsers.back()->SetDiagnostics(fWorkerDiagnostics.back().get());
+      fWorkerParsers.back()->SetDeferOutput();
+   }
+   fWorkerPool.Start("unpacking", nofThreads, 64 * nofThreads, [this](size_t index) { UnpackingThread(index); });
+}
+
+void TUnpackingLoop::StopWorkers()
+{
+   /// Passes on the output of all remaining events, stops the unpacking threads and adds their diagnostics and
+   /// fragment pool statistics to the global ones.
+   fWorkerPool.Stop([this](TUnpackingJob& job) { PassOn(job); });
+   for(const auto& diagnostics : fWorkerDiagnostics) {
+      TParsingDiagnostics::Get()->Add(*diagnostics);
+   }
+   for(const auto& parser : fWorkerParsers) {
+      fParser.FragmentPool().AddStatistics(parser->FragmentPool());
+   }
+   fWorkerDiagnostics.clear();
+   fWorkerParsers.clear();
+}
+
+void TUnpackingLoop::Dispatch(const std::shared_ptr<TRawEvent>& event)
+{
+   /// Hands data and EPICS events to the unpacking threads. All other events (e.g. the end-of-run ODB) go straight
+   /// to the reorder buffer and are processed by this thread when it's their turn, so all events are processed in
+   /// the order they were read.
+   auto job    = std::make_shared<TUnpackingJob>();
+   job->fEvent = event;
+
+   int eventId = static_cast<TMidasEvent*>(event.get())->GetEventId();
+   fWorkerPool.Dispatch(std::move(job), eventId == 1 || eventId == 4 || eventId == 5);
+}
+
+void TUnpackingLoop::CollectJobs(bool wait)
+{
+   /// Passes on the output of all events the unpacking threads are done with that are next in line. If wait is true,
+   /// we wait up to 10 ms for an event to be finished.
+   fWorkerPool.Collect(wait, [this](TUnpackingJob& job) { PassOn(job); });
+}
+
+void TUnpackingLoop::PassOn(TUnpackingJob& job)
+{
+   /// Passes on the output of an unpacked event, or processes the event if it wasn't handed to the unpacking threads.
+   if(job.fEvent) {
+      // not handed to the unpacking threads (see Dispatch)
+      fFragsReadFromRaw += job.fEvent->Process(fParser);
+      fGoodFragsRead += job.fEvent->GoodFrags();
+   } else {
+      fParser.ReplayDeferredOutput(job.fOutput);
+      fFragsReadFromRaw += job.fFragsRead;
+      fGoodFragsRead += job.fGoodFrags;
+   }
+}
+
+void TUnpackingLoop::UnpackingThread(size_t index)
+{
+   /// Unpacks events from the worker pool with its own parser until the pool is stopped.
+   TDataParser&                   parser = *(fWorkerParsers[index]);
+   std::shared_ptr<TUnpackingJob> job;
+   while(fWorkerPool.NextJob(job)) {
+      job->fFragsRead = job->fEvent->Process(parser);
+      job->fGoodFrags = job->fEvent->GoodFrags();
+      job->fEvent.reset();
+      parser.TakeDeferredOutput(job->fOutput);
+      fWorkerPool.JobDone(std::move(job));
+   }
+}
+
 std::string TUnpackingLoop::EndStatus()
 {
    std::stringstream ss;
@@ -83,6 +202,7 @@ std::string TUnpackingLoop::EndStatus()
    } else {
       ss<<"\rno fragments read from midas => none parsed!"<<std::endl;
    }
+   ss<<fParser.FragmentPool().Status();
    ss<<fParser.OutputQueueStatus();
    return ss.str();
 }
@@ -89,6 +89,7 @@ void TMidasEvent::Clear(Option_t*)
       free(fData);
    }
    fData = nullptr;
+   fKeepAlive.reset();
 
    fAllocatedByUs = false;
    fBanksN        = 0;
@@ -114,6 +115,14 @@ void TMidasEvent::SetData(uint32_t size, char* data)
    SwapBytes(false);
 }
 
+void TMidasEvent::SetData(uint32_t size, char* data, std::shared_ptr<void> keepAlive)
+{
+   // Sets the data in the TMidasEvent to an external buffer without copying it,
+   // keepAlive is held until the event is cleared so the buffer stays valid.
+   fKeepAlive = std::move(keepAlive);
+   SetData(size, data);
+}
+
 uint16_t TMidasEvent::GetEventId() const
 {
    return fEventHeader.fEventId;
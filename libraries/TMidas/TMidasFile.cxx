@@ -4,10 +4,16 @@
 #include <cstring>
 #include <sys/types.h>
 #include <sys/stat.h>
+#include <sys/mman.h>
 #include <fcntl.h>
+#include <poll.h>
+#include <unistd.h>
 #include <cerrno>
 #include <cassert>
 #include <cstdlib>
+#include <algorithm>
+#include <sstream>
+#include <vector>
 
 #ifdef HAVE_ZLIB
 #include <zlib.h>
@@ -24,6 +30,9 @@
 ClassImp(TMidasFile)
 /// \endcond
 
+/// size of the range ahead of the current position of a memory-mapped file that the kernel is asked to read in
+static const size_t kReadAheadSize = 64 * 1024 * 1024;
+
 TMidasFile::TMidasFile()
 {
    // Default Constructor
@@ -44,6 +53,10 @@ TMidasFile::TMidasFile()
    fOutFile   = -1;
    fOutGzFile = nullptr;
 
+   fMappedSize        = 0;
+   fMappedPosition    = 0;
+   fReadAheadPosition = 0;
+
    fMaxBufferSize = 1E6;
 
    currentEventNumber = 0;
@@ -88,13 +101,55 @@ static int hasSuffix(const char* name, const char* suffix)
    return static_cast<int>((s - name) + strlen(suffix) == strlen(name));
 }
 
+static std::string FirstInPath(const std::vector<std::string>& programs)
+{
+   // Returns the first of the programs that can be found in $PATH, or the last one if none are found.
+   const char* path = getenv("PATH");
+   if(path != nullptr) {
+      for(const auto& program : programs) {
+         std::stringstream str(path);
+         std::string       dir;
+         while(std::getline(str, dir, ':')) {
+            if(!dir.empty() && access((dir + "/" + program).c_str(), X_OK) == 0) {
+               return program;
+            }
+         }
+      }
+   }
+   return programs.back();
+}
+
+static std::string DecompressCommand(const char* name)
+{
+   // Returns the command to decompress the file to stdout (empty if the file isn't compressed).
+   // The block-parallel versions of gzip and bzip2 are used if they are installed.
+   if(hasSuffix(name, ".gz") != 0) {
+      return FirstInPath({"pigz", "gzip"}) + " -dc";
+   }
+   if(hasSuffix(name, ".bz2") != 0) {
+      return FirstInPath({"lbzip2", "pbzip2", "bzip2"}) + " -dc";
+   }
+   if(hasSuffix(name, ".zst") != 0) {
+      return "zstd -dc";
+   }
+   if(hasSuffix(name, ".lz4") != 0) {
+      return "lz4 -dc";
+   }
+   return "";
+}
+
 /// Open a midas .mid file with given file name.
 ///
 /// Remote files can be accessed using these special file names:
 /// - pipein://command - read data produced by given command, see examples below
 /// - ssh://username\@hostname/path/file.mid - read remote file through an ssh pipe
-/// - ssh://username\@hostname/path/file.mid.gz and file.mid.bz2 - same for compressed files
-/// - dccp://path/file.mid (also file.mid.gz and file.mid.bz2) - read data from dcache, requires dccp in the PATH
+/// - ssh://username\@hostname/path/file.mid.gz, .bz2, .zst, and .lz4 - same for compressed files
+/// - dccp://path/file.mid (also compressed) - read data from dcache, requires dccp in the PATH
+///
+/// Local uncompressed files are memory-mapped, the events read from them point into the mapping instead of holding
+/// a copy of the data. Compressed files are decompressed by a separate process (pigz/lbzip2/pbzip2 if available), or
+/// by zlib for .gz files if GRSISort was compiled with it. Pipes and compressed files are read ahead in large blocks
+/// by a background thread.
 ///
 /// Examples:
 /// - ./event_dump.exe /ladd/data9/t2km11/data/run02696.mid.gz - read normal compressed file
@@ -151,10 +206,8 @@ bool TMidasFile::Open(const char* filename)
       pipe += remoteFile;
       pipe += " bs=1024k";
 
-      if(hasSuffix(remoteFile, ".gz") != 0) {
-         pipe += " | gzip -dc";
-      } else if(hasSuffix(remoteFile, ".bz2") != 0) {
-         pipe += " | bzip2 -dc";
+      if(!DecompressCommand(remoteFile).empty()) {
+         pipe += " | " + DecompressCommand(remoteFile);
       }
    } else if(strncmp(filename, "dccp://", 7) == 0) {
       const char* name = filename + 7;
@@ -163,20 +216,17 @@ bool TMidasFile::Open(const char* filename)
       pipe += name;
       pipe += " /dev/fd/1";
 
-      if(hasSuffix(filename, ".gz") != 0) {
-         pipe += " | gzip -dc";
-      } else if(hasSuffix(filename, ".bz2") != 0) {
-         pipe += " | bzip2 -dc";
+      if(!DecompressCommand(filename).empty()) {
+         pipe += " | " + DecompressCommand(filename);
       }
    } else if(strncmp(filename, "pipein://", 9) == 0) {
       pipe = filename + 9;
-#if 0 // read compressed files using the zlib library
-	} else if(hasSuffix(filename, ".gz")) {
-		pipe = "gzip -dc ";
-		pipe += filename;
+#ifdef HAVE_ZLIB // read .gz files using the zlib library
+   } else if(hasSuffix(filename, ".gz") != 0) {
+      // opened below and read with gzread
 #endif
-   } else if(hasSuffix(filename, ".bz2") != 0) {
-      pipe = "bzip2 -dc ";
+   } else if(!DecompressCommand(filename).empty()) {
+      pipe = DecompressCommand(filename) + " ";
       pipe += filename;
    }
    // Note: We cannot use "cat" in a similar way to offload, and must open it directly.
@@ -222,6 +272,18 @@ bool TMidasFile::Open(const char* filename)
          fLastError.assign("Do not know how to read compressed MIDAS files");
          return false;
 #endif
+      } else {
+         // if this fails (e.g. not a regular file) we just read it the normal way
+         MapFile();
+      }
+   }
+
+   // compressed regular files and pipes (or fifos) are read ahead, pipes are polled so the reading thread can be
+   // stopped, a gzread from a fifo could block indefinitely
+   struct stat fileStat;
+   if(fstat(fFile, &fileStat) == 0) {
+      if(fGzFile != nullptr ? S_ISREG(fileStat.st_mode) : S_ISFIFO(fileStat.st_mode)) {
+         StartReadAheadBuffer();
       }
    }
 
@@ -308,6 +370,24 @@ static int readpipe(int fd, char* buf, int length)
    return count;
 }
 
+static long readavailable(int fd, char* buf, size_t length)
+{
+   // Waits up to 100 ms for data and reads what is available. Returns -1 with errno set to EAGAIN if nothing arrived,
+   // so that the caller can check whether to stop.
+   struct pollfd pfd;
+   pfd.fd     = fd;
+   pfd.events = POLLIN;
+   int ready  = poll(&pfd, 1, 100);
+   if(ready < 0) {
+      return -1;
+   }
+   if(ready == 0) {
+      errno = EAGAIN;
+      return -1;
+   }
+   return read(fd, buf, length);
+}
+
 /// \param [in] midasEvent Pointer to an empty TMidasEvent
 /// \returns "true" for success, "false" for failure, see GetLastError() to see why
 ///
@@ -319,6 +399,9 @@ int TMidasFile::Read(std::shared_ptr<TRawEvent> event)
       return -1;
    }
    std::shared_ptr<TMidasEvent> midasEvent = std::static_pointer_cast<TMidasEvent>(event);
+   if(fMapping != nullptr) {
+      return ReadMapped(midasEvent);
+   }
    if(fReadBuffer.size() < sizeof(TMidas_EVENT_HEADER)) {
       ReadMoreBytes(sizeof(TMidas_EVENT_HEADER) - fReadBuffer.size());
    }
@@ -361,12 +444,123 @@ int TMidasFile::Read(std::shared_ptr<TRawEvent> event)
    return bytes_read;
 }
 
+int TMidasFile::ReadMapped(const std::shared_ptr<TMidasEvent>& midasEvent)
+{
+   /// Reads the next event from the memory-mapped input file. The event data is not copied, the event points into
+   /// the mapping and keeps it alive. Returns the number of bytes read, or 0 if there is no complete event left.
+   if(fMappedPosition + sizeof(TMidas_EVENT_HEADER) > fMappedSize) {
+      // the file might have grown since we mapped it (e.g. online sorting)
+      MapFile();
+      if(fMappedPosition + sizeof(TMidas_EVENT_HEADER) > fMappedSize) {
+         fLastErrno = 0;
+         fLastError.assign("EOF");
+         return 0;
+      }
+   }
+
+   midasEvent->Clear();
+   memcpy(reinterpret_cast<char*>(midasEvent->GetEventHeader()), fMapping.get() + fMappedPosition,
+          sizeof(TMidas_EVENT_HEADER));
+   if(fDoByteSwap) {
+      printf("Swapping bytes\n");
+      midasEvent->SwapBytesEventHeader();
+   }
+   if(!midasEvent->IsGoodSize()) {
+      fLastErrno = -1;
+      fLastError.assign("Invalid event size");
+      return 0;
+   }
+
+   size_t event_size = midasEvent->GetDataSize();
+   size_t total_size = sizeof(TMidas_EVENT_HEADER) + event_size;
+
+   if(fMappedPosition + total_size > fMappedSize) {
+      MapFile();
+      if(fMappedPosition + total_size > fMappedSize) {
+         fLastErrno = 0;
+         fLastError.assign("EOF");
+         return 0;
+      }
+   }
+
+   ReadAhead();
+   midasEvent->SetData(event_size, fMapping.get() + fMappedPosition + sizeof(TMidas_EVENT_HEADER), fMapping);
+
+   fMappedPosition += total_size;
+   fBytesRead += total_size;
+   currentEventNumber++;
+
+   return total_size;
+}
+
+bool TMidasFile::MapFile()
+{
+   /// Maps the input file into memory, or re-maps it if it has grown since it was mapped. Events that point into an
+   /// old mapping keep it alive until they are cleared. The mapping is private and writable, so byte-swapping events
+   /// in place doesn't change the file. Returns false if the file can't be mapped or hasn't changed.
+   struct stat fileStat;
+   if(fstat(fFile, &fileStat) != 0 || !S_ISREG(fileStat.st_mode) || fileStat.st_size <= 0) {
+      return false;
+   }
+   size_t size = fileStat.st_size;
+   if(fMapping != nullptr && size == fMappedSize) {
+      return false;
+   }
+
+   void* data = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fFile, 0);
+   if(data == MAP_FAILED) {
+      return false;
+   }
+   madvise(data, size, MADV_SEQUENTIAL);
+
+   fMapping           = std::shared_ptr<char>(static_cast<char*>(data), [size](char* ptr) { munmap(ptr, size); });
+   fMappedSize        = size;
+   fFileSize          = size;
+   fReadAheadPosition = fMappedPosition;
+   ReadAhead();
+
+   return true;
+}
+
+void TMidasFile::ReadAhead()
+{
+   /// Asks the kernel to read in the next kReadAheadSize bytes of the mapped file, once we've used up half of the
+   /// range requested last time.
+   if(fReadAheadPosition >= fMappedSize || fMappedPosition + kReadAheadSize / 2 < fReadAheadPosition) {
+      return;
+   }
+   // madvise needs a page aligned start
+   static const size_t pageSize = sysconf(_SC_PAGESIZE);
+   size_t              start    = fMappedPosition - fMappedPosition % pageSize;
+   size_t              end      = std::min(fMappedPosition + kReadAheadSize, fMappedSize);
+   madvise(fMapping.get() + start, end - start, MADV_WILLNEED);
+   fReadAheadPosition = end;
+}
+
+void TMidasFile::StartReadAheadBuffer()
+{
+   /// Starts the background thread that reads the compressed file or pipe, after this the file may only be read
+   /// through fReadAheadBuffer.
+   fReadAheadBuffer.reset(new TReadAheadBuffer([this](char* buffer, size_t bytes) -> long {
+#ifdef HAVE_ZLIB
+      if(fGzFile != nullptr) {
+         // a stale EAGAIN would make a failed gzread look like "try again"
+         errno = 0;
+         return gzread(*(gzFile*)fGzFile, buffer, bytes);
+      }
+#endif
+      return readavailable(fFile, buffer, bytes);
+   }));
+}
+
 void TMidasFile::ReadMoreBytes(size_t bytes)
 {
    size_t initial_size = fReadBuffer.size();
    fReadBuffer.resize(initial_size + bytes);
    size_t rd = 0;
-   if(fGzFile != nullptr) {
+   if(fReadAheadBuffer != nullptr) {
+      rd = fReadAheadBuffer->Read(fReadBuffer.data() + initial_size, bytes);
+   } else if(fGzFile != nullptr) {
 #ifdef HAVE_ZLIB
       rd = gzread(*(gzFile*)fGzFile, fReadBuffer.data() + initial_size, bytes);
 #else
@@ -382,8 +576,8 @@ void TMidasFile::ReadMoreBytes(size_t bytes)
       fLastErrno = 0;
       fLastError.assign("EOF");
    } else if(rd != bytes) {
-      fLastErrno = errno;
-      fLastError.assign(std::strerror(errno));
+      fLastErrno = (fReadAheadBuffer != nullptr) ? fReadAheadBuffer->LastErrno() : errno;
+      fLastError.assign(std::strerror(fLastErrno));
    }
 }
 
@@ -501,6 +695,8 @@ void TMidasFile::Close()
 {
    // Closes the input midas file. Use OutClose() to close the output
    // Midas File.
+   // stop reading ahead before the files are closed
+   fReadAheadBuffer.reset();
    if(fPoFile != nullptr) {
       pclose(reinterpret_cast<FILE*>(fPoFile));
    }
@@ -512,6 +708,11 @@ void TMidasFile::Close()
    if(fFile > 0) {
       close(fFile);
    }
+   // events read from the mapped file keep their part of the mapping alive
+   fMapping.reset();
+   fMappedSize        = 0;
+   fMappedPosition    = 0;
+   fReadAheadPosition = 0;
 
    fFile     = -1;
    fFilename = "";
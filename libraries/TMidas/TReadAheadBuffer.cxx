@@ -0,0 +1,134 @@
+#include "TReadAheadBuffer.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <utility>
+
+TReadAheadBuffer::TReadAheadBuffer(std::function<long(char*, size_t)> readFunction, size_t blockSize, size_t nofBlocks)
+   : fReadFunction(std::move(readFunction)), fBlockSize(blockSize), fNofBlocks(std::max(nofBlocks, static_cast<size_t>(1))),
+     fBlockPosition(0), fFinished(false), fAtEnd(false), fStop(false), fErrno(0)
+{
+   fThread = std::thread(&TReadAheadBuffer::ReadBlocks, this);
+}
+
+TReadAheadBuffer::~TReadAheadBuffer()
+{
+   {
+      std::lock_guard<std::mutex> lock(fMutex);
+      fStop = true;
+   }
+   fCanFill.notify_all();
+   // this waits for the read that is currently in progress
+   if(fThread.joinable()) {
+      fThread.join();
+   }
+}
+
+void TReadAheadBuffer::ReadBlocks()
+{
+   /// Fills blocks until reading fails or we are told to stop. A block is filled until it's full or a read returns
+   /// less than was asked for (e.g. a stream that is still being written), then it's handed over. After a read
+   /// returned 0 we wait until Read has reported this before trying again.
+   while(true) {
+      std::vector<char> block;
+      {
+         std::unique_lock<std::mutex> lock(fMutex);
+         fCanFill.wait(lock, [this] { return fStop || (!fAtEnd && fFilledBlocks.size() < fNofBlocks); });
+         if(fStop) {
+            return;
+         }
+         if(!fEmptyBlocks.empty()) {
+            block = std::move(fEmptyBlocks.back());
+            fEmptyBlocks.pop_back();
+         }
+      }
+
+      // read without holding the lock
+      block.resize(fBlockSize);
+      size_t filled = 0;
+      bool   atEnd  = false;
+      int    error  = 0;
+      while(filled < fBlockSize && !fStop) {
+         size_t requested = fBlockSize - filled;
+         long   rd        = fReadFunction(block.data() + filled, requested);
+         if(rd < 0 && (errno == EAGAIN || errno == EINTR)) {
+            // nothing available right now, hand over what we have or try again
+            if(filled > 0) {
+               break;
+            }
+            continue;
+         }
+         if(rd <= 0) {
+            atEnd = (rd == 0);
+            error = (rd < 0) ? errno : 0;
+            break;
+         }
+         filled += rd;
+         if(static_cast<size_t>(rd) < requested) {
+            break;
+         }
+      }
+      if(fStop) {
+         return;
+      }
+      block.resize(filled);
+      bool failed = !atEnd && filled == 0;
+
+      {
+         std::lock_guard<std::mutex> lock(fMutex);
+         if(!block.empty()) {
+            fFilledBlocks.push_back(std::move(block));
+         }
+         if(atEnd) {
+            fAtEnd = true;
+         } else if(failed) {
+            fFinished = true;
+            fErrno    = error;
+         }
+      }
+      fCanRead.notify_one();
+      if(failed) {
+         return;
+      }
+   }
+}
+
+size_t TReadAheadBuffer::Read(char* buffer, size_t bytes)
+{
+   /// Copies up to bytes into buffer and returns the number of bytes copied. This only returns less than bytes if the
+   /// end of the data has been reached (or reading failed).
+   size_t copied = 0;
+   while(copied < bytes) {
+      if(fBlockPosition >= fCurrentBlock.size()) {
+         std::unique_lock<std::mutex> lock(fMutex);
+         // recycle the used block
+         if(fCurrentBlock.capacity() > 0) {
+            fCurrentBlock.clear();
+            fEmptyBlocks.push_back(std::move(fCurrentBlock));
+            fCurrentBlock = std::vector<char>();
+         }
+         fCanRead.wait(lock, [this] { return fFinished || fAtEnd || !fFilledBlocks.empty(); });
+         if(fFilledBlocks.empty()) {
+            if(fAtEnd) {
+               // report the end of the data once, then let the background thread try again
+               fAtEnd = false;
+               lock.unlock();
+               fCanFill.notify_one();
+            }
+            return copied;
+         }
+         fCurrentBlock = std::move(fFilledBlocks.front());
+         fFilledBlocks.pop_front();
+         fBlockPosition = 0;
+         lock.unlock();
+         fCanFill.notify_one();
+      }
+      size_t length = std::min(bytes - copied, fCurrentBlock.size() - fBlockPosition);
+      std::memcpy(buffer + copied, fCurrentBlock.data() + fBlockPosition, length);
+      copied += length;
+      fBlockPosition += length;
+   }
+
+   return copied;
+}
@@ -0,0 +1,450 @@
+#include <iostream>
+#include <iomanip>
+#include <chrono>
+#include <random>
+#include <vector>
+#include <string>
+#include <cmath>
+#include <cstdlib>
+
+#include "TFile.h"
+#include "TTree.h"
+
+#include "TFragment.h"
+#include "TPulseAnalyzer.h"
+#include "TSiLi.h"
+
+////////////////////////////////////////////////////////////////////////////////
+///
+/// This program compares the TPulseAnalyzer fits (Cholesky solver and prefix
+/// sums) with the original ones. TPulseAnalyzerReference below replaces the
+/// linear equation solver and the line and parabola fits with a verbatim copy
+/// of the original code (Cramer's rule and a loop over each fit window). Both
+/// are timed on the same waveforms, and the t0 (fit_newT0, CsIt0, GetSiliShape)
+/// and the CsI PID have to agree within the tolerance (relative to the value,
+/// or absolute for values below one).
+///
+/// Usage: PulseAnalyzerBenchmark [number of waveforms] [tolerance] [seed]
+///        PulseAnalyzerBenchmark <root file with FragmentTree> [tolerance] [max. number of waveforms]
+///
+/// Without a root file synthetic TIP CsI and SiLi waveforms with known t0 are
+/// generated, and the mean deviation from the true t0 is printed as well. With
+/// a root file all waveforms of the fragment tree are fitted with every method.
+///
+/// Returns 1 if any result differs by more than the tolerance.
+///
+////////////////////////////////////////////////////////////////////////////////
+
+class TPulseAnalyzerReference : public TPulseAnalyzer {
+public:
+   explicit TPulseAnalyzerReference(const std::vector<Short_t>& wave) : TPulseAnalyzer(wave) {}
+
+protected:
+   int         solve_lin_eq() override;
+   int         fit_parabola(int, int, ParPar*) override;
+   int         fit_smooth_parabola(int, int, double, ParPar*) override;
+   int         fit_line(int, int, LinePar*) override;
+   long double determinant(int);
+};
+
+// The code below is copied from TPulseAnalyzer before the fits were rewritten. The only change is that fit_parabola
+// calculates the third and fourth powers of i in long double, the original int overflows for samples from 216 on
+// (undefined behaviour, which changes fit_newT0 for about a third of the synthetic CsI waveforms).
+
+int TPulseAnalyzerReference::solve_lin_eq()
+{
+   memcpy(copy_matrix, lineq_matrix, sizeof(lineq_matrix));
+   long double w = determinant(lineq_dim);
+   if(w == 0.) {
+      return 0;
+   }
+   for(int i = 0; i < lineq_dim; i++) {
+      memcpy(copy_matrix, lineq_matrix, sizeof(lineq_matrix));
+      memcpy(copy_matrix[i], lineq_vector, sizeof(lineq_vector));
+      lineq_solution[i] = determinant(lineq_dim) / w;
+   }
+   return 1;
+}
+
+// solve the determinant of the currently stored copy_matrix for dimentions m
+long double TPulseAnalyzerReference::determinant(int m)
+{
+   long double s;
+   if(m == 1) {
+      return copy_matrix[0][0];
+   }
+   if(copy_matrix[m - 1][m - 1] == 0.) {
+      int j = m - 1;
+      while(copy_matrix[m - 1][j] == 0 && j >= 0) {
+         j--;
+      }
+      if(j < 0) {
+         return 0.;
+      }
+      for(int i = 0; i < m; i++) {
+         s                     = copy_matrix[i][m - 1];
+         copy_matrix[i][m - 1] = copy_matrix[i][j];
+         copy_matrix[i][j]     = s;
+      }
+   }
+   for(int j = m - 2; j >= 0; j--) {
+      for(int i = 0; i < m; i++) {
+         copy_matrix[i][j] -= copy_matrix[i][m - 1] / copy_matrix[m - 1][m - 1] * copy_matrix[m - 1][j];
+      }
+   }
+   return copy_matrix[m - 1][m - 1] * determinant(m - 1);
+}
+
+int TPulseAnalyzerReference::fit_smooth_parabola(int low, int high, double x0, ParPar* pp)
+{
+   int    i, ndf, k;
+   double chisq;
+   double x;
+   memset(pp, 0, sizeof(ParPar));
+   memset(lineq_matrix, 0, sizeof(lineq_matrix));
+   memset(lineq_vector, 0, sizeof(lineq_vector));
+   lineq_dim = 2;
+   chisq     = 0.;
+   ndf       = 0;
+   k         = static_cast<int>(rint(x0));
+
+   for(i = low; i < k; i++) {
+      lineq_matrix[0][0] += 1;
+      lineq_vector[0] += cWavebuffer[i];
+      ndf++;
+      chisq += cWavebuffer[i] * cWavebuffer[i];
+   }
+
+   for(i = k; i < high; i++) {
+      x = (i - x0) * (i - x0);
+      lineq_matrix[0][0] += 1;
+      lineq_matrix[0][1] += x;
+      lineq_matrix[1][1] += x * x;
+      lineq_vector[0] += cWavebuffer[i];
+      lineq_vector[1] += cWavebuffer[i] * x;
+      ndf++;
+      chisq += cWavebuffer[i] * cWavebuffer[i];
+   }
+   lineq_matrix[1][0] = lineq_matrix[0][1];
+
+   if(solve_lin_eq() == 0) {
+      pp->chisq = BADCHISQ_MAT;
+      return -1;
+   }
+   chisq -= lineq_vector[0] * lineq_solution[0];
+   chisq -= lineq_vector[1] * lineq_solution[1];
+
+   pp->constant  = lineq_solution[0];
+   pp->linear    = 0.;
+   pp->quadratic = lineq_solution[1];
+   pp->chisq     = chisq;
+   pp->ndf       = ndf;
+
+   return 1;
+
+   return -1;
+}
+
+int TPulseAnalyzerReference::fit_parabola(int low, int high, ParPar* pp)
+{
+   int    i, ndf;
+   double chisq;
+   memset(pp, 0, sizeof(ParPar));
+   memset(lineq_matrix, 0, sizeof(lineq_matrix));
+   memset(lineq_vector, 0, sizeof(lineq_vector));
+   lineq_dim = 3;
+   chisq     = 0.;
+   ndf       = 0;
+   for(i = low; i < high; i++) {
+      lineq_matrix[0][0] += 1;
+      lineq_matrix[0][1] += i;
+      lineq_matrix[0][2] += i * i;
+      lineq_matrix[1][2] += static_cast<long double>(i) * i * i;
+      lineq_matrix[2][2] += static_cast<long double>(i) * i * i * i;
+      lineq_vector[0] += cWavebuffer[i];
+      lineq_vector[1] += cWavebuffer[i] * i;
+      lineq_vector[2] += cWavebuffer[i] * i * i;
+      ndf++;
+      chisq += cWavebuffer[i] * cWavebuffer[i];
+   }
+   lineq_matrix[1][0] = lineq_matrix[0][1];
+   lineq_matrix[1][1] = lineq_matrix[0][2];
+   lineq_matrix[2][0] = lineq_matrix[0][2];
+   lineq_matrix[2][1] = lineq_matrix[1][2];
+
+   if(solve_lin_eq() == 0) {
+      pp->chisq = BADCHISQ_MAT;
+      return -1;
+   }
+   chisq -= lineq_vector[0] * lineq_solution[0];
+   chisq -= lineq_vector[1] * lineq_solution[1];
+   chisq -= lineq_vector[2] * lineq_solution[2];
+   pp->constant  = lineq_solution[0];
+   pp->linear    = lineq_solution[1];
+   pp->quadratic = lineq_solution[2];
+   pp->chisq     = chisq;
+   pp->ndf       = ndf;
+   return 1;
+}
+
+int TPulseAnalyzerReference::fit_line(int low, int high, LinePar* lp)
+{
+   int    i, ndf;
+   double chisq;
+   memset(lp, 0, sizeof(LinePar));
+   memset(lineq_matrix, 0, sizeof(lineq_matrix));
+   memset(lineq_vector, 0, sizeof(lineq_vector));
+   lineq_dim = 2;
+   chisq     = 0.;
+   ndf       = 0;
+   for(i = low; i < high; i++) {
+      lineq_matrix[0][0] += 1;
+      lineq_matrix[0][1] += i;
+      lineq_matrix[1][1] += i * i;
+      lineq_vector[0] += cWavebuffer[i];
+      lineq_vector[1] += cWavebuffer[i] * i;
+      ndf++;
+      chisq += cWavebuffer[i] * cWavebuffer[i];
+   }
+   lineq_matrix[1][0] = lineq_matrix[0][1];
+
+   if(solve_lin_eq() == 0) {
+      lp->chisq = BADCHISQ_MAT;
+      return -1;
+   }
+   chisq -= lineq_vector[0] * lineq_solution[0];
+   chisq -= lineq_vector[1] * lineq_solution[1];
+   lp->slope     = lineq_solution[1];
+   lp->intercept = lineq_solution[0];
+   lp->chisq     = chisq;
+   lp->ndf       = ndf;
+   return 1;
+}
+
+struct FitResults {
+   double fT0;     ///< fit_newT0
+   double fCsIPID; ///< CsIPID
+   double fCsIt0;  ///< CsIt0 (after CsIPID, the way TTipHit::SetPID does it)
+   double fSiLiT0; ///< t0 of GetSiliShape, -1 if the fit failed
+};
+
+std::vector<Short_t> CsIWaveform(std::mt19937& rng, double t0)
+{
+   /// CsI shape used by TPulseAnalyzer::GetCsIShape with the default time constants of CsIPID,
+   /// f(t) = C + (Af+As)*exp(-(t-t0)/tRC) - Af*exp(-(t-t0)/tF') - As*exp(-(t-t0)/tS')
+   std::uniform_real_distribution<double> amplitude(2000., 8000.);
+   std::uniform_real_distribution<double> ratio(0.2, 1.);
+   std::normal_distribution<double>       noise(0., 10.);
+   double tRC      = 4510.;
+   double tF       = 64.3 * tRC / (64.3 + tRC);
+   double tS       = 380. * tRC / (380. + tRC);
+   double fast     = amplitude(rng);
+   double slow     = ratio(rng) * fast;
+   double baseline = -1000. + 100. * ratio(rng);
+
+   std::vector<Short_t> wave(1000);
+   for(size_t i = 0; i < wave.size(); ++i) {
+      double value = baseline;
+      double t     = i - t0;
+      if(t > 0.) {
+         value += (fast + slow) * std::exp(-t / tRC) - fast * std::exp(-t / tF) - slow * std::exp(-t / tS);
+      }
+      wave[i] = static_cast<Short_t>(std::lround(value + noise(rng)));
+   }
+   return wave;
+}
+
+std::vector<Short_t> SiLiWaveform(std::mt19937& rng, double t0)
+{
+   /// SiLi shape of TPulseAnalyzer::SiLiFitFunction with the default decay and rise of TSiLi
+   std::uniform_real_distribution<double> amplitude(500., 5000.);
+   std::normal_distribution<double>       noise(0., 5.);
+   double amp = amplitude(rng);
+
+   std::vector<Short_t> wave(400);
+   for(size_t i = 0; i < wave.size(); ++i) {
+      double value = TSiLi::sili_default_baseline;
+      double t     = i - t0;
+      if(t > 0.) {
+         value += amp * (1. - std::exp(-t / TSiLi::sili_default_rise)) * std::exp(-t / TSiLi::sili_default_decay);
+      }
+      wave[i] = static_cast<Short_t>(std::lround(value + noise(rng)));
+   }
+   return wave;
+}
+
+template <class Analyzer>
+double RunFits(const std::vector<std::vector<Short_t>>& waves, std::vector<FitResults>& results)
+{
+   /// Fits all waveforms, returns the time this took in seconds.
+   results.resize(waves.size());
+
+   auto start = std::chrono::steady_clock::now();
+   for(size_t i = 0; i < waves.size(); ++i) {
+      Analyzer pulse(waves[i]);
+      results[i].fT0 = pulse.fit_newT0();
+
+      Analyzer csi(waves[i]);
+      results[i].fCsIPID = csi.CsIPID();
+      results[i].fCsIt0  = csi.CsIt0();
+
+      Analyzer sili(waves[i]);
+      if(sili.GetSiliShape(TSiLi::sili_default_decay, TSiLi::sili_default_rise)) {
+         results[i].fSiLiT0 = sili.Get_wpar_T0();
+      } else {
+         results[i].fSiLiT0 = -1.;
+      }
+   }
+   auto stop = std::chrono::steady_clock::now();
+
+   return std::chrono::duration<double>(stop - start).count();
+}
+
+bool Agree(double reference, double value, double tolerance)
+{
+   if(std::isnan(reference) || std::isnan(value)) {
+      return std::isnan(reference) && std::isnan(value);
+   }
+   return std::fabs(value - reference) <= tolerance * std::max(1., std::fabs(reference));
+}
+
+int main(int argc, char** argv)
+{
+   size_t      nofWaves  = 2000;
+   double      tolerance = 1e-6;
+   unsigned    seed      = 1;
+   std::string fileName;
+   if(argc > 1) {
+      std::string arg = argv[1];
+      if(arg.size() > 5 && arg.compare(arg.size() - 5, 5, ".root") == 0) {
+         fileName = arg;
+         nofWaves = 0;
+      } else {
+         nofWaves = std::strtoul(argv[1], nullptr, 10);
+      }
+   }
+   if(argc > 2) {
+      tolerance = std::atof(argv[2]);
+   }
+   if(argc > 3) {
+      if(fileName.empty()) {
+         seed = std::strtoul(argv[3], nullptr, 10);
+      } else {
+         nofWaves = std::strtoul(argv[3], nullptr, 10);
+      }
+   }
+   if((fileName.empty() && nofWaves == 0) || tolerance <= 0.) {
+      std::cout<<"Usage: "<<argv[0]<<" [number of waveforms] [tolerance] [seed]"<<std::endl
+               <<"       "<<argv[0]<<" <root file with FragmentTree> [tolerance] [max. number of waveforms]"
+               <<std::endl;
+      return 1;
+   }
+
+   std::vector<std::vector<Short_t>> waves;
+   std::vector<double>               trueT0;
+   std::vector<bool>                 isCsI;
+   if(fileName.empty()) {
+      std::mt19937                           rng(seed);
+      std::uniform_real_distribution<double> csiT0(100., 300.);
+      std::uniform_real_distribution<double> siliT0(60., 150.);
+      for(size_t i = 0; i < nofWaves; ++i) {
+         if(i % 2 == 0) {
+            trueT0.push_back(csiT0(rng));
+            waves.push_back(CsIWaveform(rng, trueT0.back()));
+            isCsI.push_back(true);
+         } else {
+            trueT0.push_back(siliT0(rng));
+            waves.push_back(SiLiWaveform(rng, trueT0.back()));
+            isCsI.push_back(false);
+         }
+      }
+      std::cout<<"Fitting "<<waves.size()<<" synthetic CsI and SiLi waveforms (seed "<<seed<<")"<<std::endl;
+   } else {
+      TFile file(fileName.c_str());
+      if(!file.IsOpen()) {
+         std::cout<<"Failed to open "<<fileName<<std::endl;
+         return 1;
+      }
+      auto* tree = dynamic_cast<TTree*>(file.Get("FragmentTree"));
+      if(tree == nullptr) {
+         std::cout<<"Failed to find FragmentTree in "<<fileName<<std::endl;
+         return 1;
+      }
+      TFragment* fragment = nullptr;
+      tree->SetBranchAddress("TFragment", &fragment);
+      for(Long64_t entry = 0; entry < tree->GetEntries(); ++entry) {
+         tree->GetEntry(entry);
+         if(fragment->HasWave() && fragment->GetWaveform()->size() > 0) {
+            waves.push_back(*fragment->GetWaveform());
+            if(nofWaves > 0 && waves.size() >= nofWaves) {
+               break;
+            }
+         }
+      }
+      std::cout<<"Fitting "<<waves.size()<<" waveforms from "<<fileName<<std::endl;
+   }
+
+   std::vector<FitResults> reference;
+   std::vector<FitResults> results;
+   double                  referenceSeconds = RunFits<TPulseAnalyzerReference>(waves, reference);
+   double                  seconds          = RunFits<TPulseAnalyzer>(waves, results);
+
+   std::cout<<std::left<<std::setw(10)<<"reference"<<": "<<std::setw(10)<<referenceSeconds<<" s => "
+            <<1e6 * referenceSeconds / waves.size()<<" us per waveform"<<std::endl;
+   std::cout<<std::left<<std::setw(10)<<"new"<<": "<<std::setw(10)<<seconds<<" s => "
+            <<1e6 * seconds / waves.size()<<" us per waveform"<<std::endl;
+
+   std::vector<std::string> names      = {"fit_newT0", "CsIPID", "CsIt0", "SiLi t0"};
+   std::vector<size_t>      mismatches(names.size(), 0);
+   std::vector<double>      maxDiff(names.size(), 0.);
+   for(size_t i = 0; i < waves.size(); ++i) {
+      std::vector<double> ref = {reference[i].fT0, reference[i].fCsIPID, reference[i].fCsIt0, reference[i].fSiLiT0};
+      std::vector<double> val = {results[i].fT0, results[i].fCsIPID, results[i].fCsIt0, results[i].fSiLiT0};
+      for(size_t j = 0; j < names.size(); ++j) {
+         if(!Agree(ref[j], val[j], tolerance)) {
+            if(mismatches[j] < 10) {
+               std::cout<<"waveform "<<i<<": "<<names[j]<<" "<<val[j]<<" instead of "<<ref[j]<<std::endl;
+            }
+            ++mismatches[j];
+         }
+         if(!std::isnan(ref[j]) && !std::isnan(val[j])) {
+            maxDiff[j] = std::max(maxDiff[j], std::fabs(val[j] - ref[j]) / std::max(1., std::fabs(ref[j])));
+         }
+      }
+   }
+
+   size_t total = 0;
+   for(size_t j = 0; j < names.size(); ++j) {
+      std::cout<<std::left<<std::setw(10)<<names[j]<<": "<<mismatches[j]<<" mismatches, max. difference "<<maxDiff[j]
+               <<std::endl;
+      total += mismatches[j];
+   }
+
+   if(!trueT0.empty()) {
+      // deviation from the true t0 for the fits that succeeded
+      double csiSum  = 0.;
+      double siliSum = 0.;
+      size_t nofCsI  = 0;
+      size_t nofSiLi = 0;
+      for(size_t i = 0; i < waves.size(); ++i) {
+         if(isCsI[i] && results[i].fCsIt0 > 0.) {
+            csiSum += std::fabs(results[i].fCsIt0 - trueT0[i]);
+            ++nofCsI;
+         } else if(!isCsI[i] && results[i].fSiLiT0 > 0.) {
+            siliSum += std::fabs(results[i].fSiLiT0 - trueT0[i]);
+            ++nofSiLi;
+         }
+      }
+      std::cout<<"CsIt0   : "<<nofCsI<<" fits, mean deviation from true t0 "<<(nofCsI > 0 ? csiSum / nofCsI : 0.)
+               <<std::endl;
+      std::cout<<"SiLi t0 : "<<nofSiLi<<" fits, mean deviation from true t0 "
+               <<(nofSiLi > 0 ? siliSum / nofSiLi : 0.)<<std::endl;
+   }
+
+   if(total > 0) {
+      std::cout<<"Error, "<<total<<" results differ by more than "<<tolerance<<"!"<<std::endl;
+      return 1;
+   }
+
+   return 0;
+}
@@ -0,0 +1,138 @@
+#include <iostream>
+#include <iomanip>
+#include <chrono>
+#include <thread>
+#include <vector>
+#include <memory>
+#include <string>
+#include <cstdlib>
+
+#include "ThreadsafeQueue.h"
+
+////////////////////////////////////////////////////////////////////////////////
+///
+/// This program compares the throughput of the different ThreadsafeQueue
+/// backends (mutex, SPSC ring buffer, MPMC ring buffer). Shared pointers are
+/// pushed through the queue, the same way fragments are passed between loops.
+///
+/// Usage: QueueBenchmark [number of items] [number of producers] [number of consumers] [batch size]
+///
+/// With more than one producer or consumer the SPSC queue is skipped. With a
+/// batch size larger than one, items are passed using PushBatch/PopBatch.
+///
+////////////////////////////////////////////////////////////////////////////////
+
+struct BenchmarkItem {
+   long fValue;
+};
+
+double RunBenchmark(EQueueType type, size_t nofItems, int nofProducers, int nofConsumers, size_t batchSize)
+{
+   auto queue = std::make_shared<ThreadsafeQueue<std::shared_ptr<const BenchmarkItem>>>("benchmark", 50000, type);
+
+   std::vector<std::thread> producers;
+   std::vector<std::thread> consumers;
+   std::vector<long>        sums(nofConsumers, 0);
+
+   auto start = std::chrono::steady_clock::now();
+   for(int c = 0; c < nofConsumers; ++c) {
+      consumers.emplace_back([&queue, &sums, c, batchSize]() {
+         std::vector<std::shared_ptr<const BenchmarkItem>> items;
+         while(true) {
+            items.clear();
+            if(queue->PopBatch(items, batchSize, 10) < 0) {
+               if(queue->IsFinished() && queue->Size() == 0) {
+                  break;
+               }
+               continue;
+            }
+            for(const auto& item : items) {
+               sums[c] += item->fValue;
+            }
+         }
+      });
+   }
+   for(int p = 0; p < nofProducers; ++p) {
+      size_t begin = (nofItems * p) / nofProducers;
+      size_t end   = (nofItems * (p + 1)) / nofProducers;
+      producers.emplace_back([&queue, begin, end, batchSize]() {
+         std::vector<std::shared_ptr<const BenchmarkItem>> items;
+         for(size_t i = begin; i < end; ++i) {
+            auto item    = std::make_shared<BenchmarkItem>();
+            item->fValue = static_cast<long>(i);
+            if(batchSize == 1) {
+               queue->Push(item);
+               continue;
+            }
+            items.push_back(item);
+            if(items.size() >= batchSize) {
+               queue->PushBatch(items);
+            }
+         }
+         queue->PushBatch(items);
+      });
+   }
+   for(auto& producer : producers) {
+      producer.join();
+   }
+   queue->SetFinished();
+   for(auto& consumer : consumers) {
+      consumer.join();
+   }
+   auto stop = std::chrono::steady_clock::now();
+
+   // check that nothing got lost
+   long sum = 0;
+   for(auto s : sums) {
+      sum += s;
+   }
+   long expected = static_cast<long>(nofItems) * (static_cast<long>(nofItems) - 1) / 2;
+   if(sum != expected || queue->ItemsPopped() != nofItems) {
+      std::cerr<<"Error, got sum "<<sum<<" and "<<queue->ItemsPopped()<<" items, expected "<<expected<<" and "
+               <<nofItems<<" items!"<<std::endl;
+   }
+
+   return std::chrono::duration<double>(stop - start).count();
+}
+
+int main(int argc, char** argv)
+{
+   size_t nofItems     = 10000000;
+   int    nofProducers = 1;
+   int    nofConsumers = 1;
+   size_t batchSize    = 1;
+   if(argc > 1) {
+      nofItems = std::strtoul(argv[1], nullptr, 10);
+   }
+   if(argc > 2) {
+      nofProducers = std::atoi(argv[2]);
+   }
+   if(argc > 3) {
+      nofConsumers = std::atoi(argv[3]);
+   }
+   if(argc > 4) {
+      batchSize = std::strtoul(argv[4], nullptr, 10);
+   }
+   if(nofItems == 0 || nofProducers < 1 || nofConsumers < 1 || batchSize < 1) {
+      std::cout<<"Usage: "<<argv[0]<<" [number of items] [number of producers] [number of consumers] [batch size]"
+               <<std::endl;
+      return 1;
+   }
+
+   std::cout<<"Pushing "<<nofItems<<" items from "<<nofProducers<<" producer(s) to "<<nofConsumers
+            <<" consumer(s) in batches of "<<batchSize<<std::endl;
+
+   std::vector<std::pair<std::string, EQueueType>> types = {{"mutex", EQueueType::kMutex},
+                                                            {"spsc", EQueueType::kSPSC},
+                                                            {"mpmc", EQueueType::kMPMC}};
+   for(const auto& type : types) {
+      if(type.second == EQueueType::kSPSC && (nofProducers > 1 || nofConsumers > 1)) {
+         continue;
+      }
+      double seconds = RunBenchmark(type.second, nofItems, nofProducers, nofConsumers, batchSize);
+      std::cout<<std::left<<std::setw(6)<<type.first<<": "<<std::setw(10)<<seconds<<" s => "
+               <<nofItems / seconds / 1e6<<" MHz"<<std::endl;
+   }
+
+   return 0;
+}